@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include "SDRAPI.h"
 #include <string.h>
 #include <stdio.h>
@@ -6,6 +7,16 @@
 #include <iio.h>
 #include <math.h>
 #include <complex.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <stddef.h>
  
  typedef double complex cplx;
  
@@ -13,6 +24,53 @@
  	struct iio_context *m_ctx;
 	struct iio_buffer  **m_rtxBuf;
  };
+/*
+	Metrics of the hot path, they are only compiled with SDRAPI_METRICS so the normal build doesn't pay for the clock reads.
+	Every measure adds its latency to a histogram with one bin for every power of 2 of nanoseconds.
+*/
+static unsigned long long now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec*1000000000ULL + now.tv_nsec;
+}
+
+#ifdef SDRAPI_METRICS
+
+struct MetricCounters{
+	atomic_ullong m_count;
+	atomic_ullong m_totalNs;
+	atomic_ullong m_maxNs;
+	atomic_ullong m_bytes;
+	atomic_ullong m_histogram[SDRMETRICBINS];
+};
+
+static struct MetricCounters metrics[METRICCOUNT];
+
+static void metric_add(SdrMetric metric, unsigned long long begin, unsigned long long bytes)
+{
+	unsigned long long ns = now_ns() - begin;
+	int bin = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+	if(bin >= SDRMETRICBINS)
+	{
+		bin = SDRMETRICBINS-1;
+	}
+	struct MetricCounters* counters = &metrics[metric];
+	atomic_fetch_add_explicit(&counters->m_count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&counters->m_totalNs, ns, memory_order_relaxed);
+	atomic_fetch_add_explicit(&counters->m_bytes, bytes, memory_order_relaxed);
+	atomic_fetch_add_explicit(&counters->m_histogram[bin], 1, memory_order_relaxed);
+	unsigned long long max = atomic_load_explicit(&counters->m_maxNs, memory_order_relaxed);
+	while(ns > max && !atomic_compare_exchange_weak_explicit(&counters->m_maxNs, &max, ns, memory_order_relaxed, memory_order_relaxed));
+}
+
+#define METRIC_BEGIN(name) unsigned long long name = now_ns()
+#define METRIC_END(metric, name, bytes) metric_add(metric, name, bytes)
+#else
+#define METRIC_BEGIN(name)
+#define METRIC_END(metric, name, bytes)
+#endif
+
 /* check return value of attr_write function */
 static void errchk(int v, const char* what) {
 	 if (v < 0) { fprintf(stderr, "Error %d writing to channel \"%s\"\nvalue may not be supported.\n", v, what);}
@@ -21,19 +79,50 @@ static void errchk(int v, const char* what) {
 /* write attribute: long long int */
 static void wr_ch_lli(struct iio_channel *chn, const char* what, long long val)
 {
+	METRIC_BEGIN(begin);
 	errchk(iio_channel_attr_write_longlong(chn, what, val), what);
+	METRIC_END(METRICATTRIBUTE, begin, 0);
 }
 
 /* write attribute: string */
 static void wr_ch_str(struct iio_channel *chn, const char* what, const char* str)
 {
+	METRIC_BEGIN(begin);
 	errchk(iio_channel_attr_write(chn, what, str), what);
+	METRIC_END(METRICATTRIBUTE, begin, 0);
 }
 
 /*write attribute: double */
 static void wr_ch_double(struct iio_channel *chn, const char* what, double val)
 {
+	METRIC_BEGIN(begin);
 	errchk(iio_channel_attr_write_double(chn, what, val), what);
+	METRIC_END(METRICATTRIBUTE, begin, 0);
+}
+
+/* buffer operations, all of them go through here to be measured */
+static struct iio_buffer* create_buffer(struct iio_device* dev, size_t len, bool cyclic)
+{
+	METRIC_BEGIN(begin);
+	struct iio_buffer* buf = iio_device_create_buffer(dev, len, cyclic);
+	METRIC_END(METRICBUFFERCREATE, begin, 0);
+	return buf;
+}
+
+static ssize_t push_buffer(struct iio_buffer* buf)
+{
+	METRIC_BEGIN(begin);
+	ssize_t res = iio_buffer_push(buf);
+	METRIC_END(METRICPUSH, begin, res > 0 ? res : 0);
+	return res;
+}
+
+static ssize_t refill_buffer(struct iio_buffer* buf)
+{
+	METRIC_BEGIN(begin);
+	ssize_t res = iio_buffer_refill(buf);
+	METRIC_END(METRICREFILL, begin, res > 0 ? res : 0);
+	return res;
 }
 
 /* helper function generating channel names */
@@ -97,1474 +186,8398 @@ static bool get_lo_chan(ChannelType d, struct iio_channel **chn, char* tmpstr, s
 	}
 }
  
-VirtualSdrError StartSdr(struct VirtualSdr* virtual)
+/* connects to the real sdr described by the virtual one */
+static struct iio_context* create_context(struct VirtualSdr* virtual)
 {
-
-	/*
-		Improvements:
-			-Clean this mess
-			-Save the iio_context and iio_buffers in the null pointer to be cleaned in the stopSDR function
-			-Add the part where we put the ports in ON --> Question, only put ON the nodes of always? if port is just only once how do you put later the OFF, is threading an option?
-	*/	
-	
-	struct iio_context * auxContextAh;
-	if(virtual == NULL)
-	{
-		return NULLPOINTER;
-	}
-	
-	virtual->m_RealSdr = (struct AD9361 *) malloc(sizeof(struct AD9361));
-	char auxContext [40];
+	char auxContext [sizeof(virtual->m_location) + 8];
 	if(virtual->m_connectionType == USB)
 	{
 		strcpy(auxContext, "serial:");
-		strcat(auxContext, virtual->m_location);
-		auxContextAh = iio_create_context_from_uri(auxContext);
-		((struct AD9361*) virtual->m_RealSdr)->m_ctx = auxContextAh;
-		
 	}
-	if(virtual->m_connectionType == IP)
+	else if(virtual->m_connectionType == IP)
 	{
 		strcpy(auxContext, "ip:");
-		strcat(auxContext, virtual->m_location);
-		auxContextAh = iio_create_context_from_uri(auxContext);	
-		((struct AD9361*) virtual->m_RealSdr)->m_ctx = auxContextAh;
 	}
-	if(auxContextAh == NULL)
+	else
 	{
-		return REALSDRNOTFOUND;
+		return NULL;
 	}
-	
-	struct PortList* portIter = virtual->m_ports;
-	char auxStr [64];
+	strcat(auxContext, virtual->m_location);
+	METRIC_BEGIN(begin);
+	struct iio_context* ctx = iio_create_context_from_uri(auxContext);
+	METRIC_END(METRICCONTEXT, begin, 0);
+	return ctx;
+}
+
+/* writes the configuration of a port: bandwidth, sampling frecuency, gain, rf port and LO */
+static bool configure_port(struct iio_context* ctx, long fs, struct PortList* portIter, char* auxStr)
+{
 	char auxRxChannel [] = "X_BALANCED";
 	char auxTxChannel [] = "X";
-	int numberPorts = 0;
+	struct iio_channel *chn = NULL;
+	if (!get_phy_chan(portIter->m_type, portIter->m_port-1, &chn, auxStr, ctx)) 
+	{
+		return false; 
+	}
+	wr_ch_lli(chn, "rf_bandwidth", portIter->m_Bw);
+	wr_ch_lli(chn, "sampling_frequency", fs);
 	
-	while(portIter != NULL)
+	if(portIter->m_type == TX)
 	{
-		numberPorts++;
-		struct iio_channel *chn = NULL;
-		if (!get_phy_chan(portIter->m_type, portIter->m_port-1, &chn, auxStr, auxContextAh)) 
-		{
-			return REALSDRNOTFOUND; 
-		}
-		wr_ch_lli(chn, "rf_bandwidth", portIter->m_Bw);
-		wr_ch_lli(chn, "sampling_frequency", virtual->m_FS);
-		
-		if(portIter->m_type == TX)
+		wr_ch_double(chn, "hardwaregain", portIter->m_Amp);
+		auxTxChannel[0] = portIter->m_channel;
+		wr_ch_str(chn, "rf_port_select", auxTxChannel);
+	}
+	else
+	{
+		if(portIter->m_Amp >= 0)
 		{
+			wr_ch_str(chn, "gain_control_mode", "manual");
 			wr_ch_double(chn, "hardwaregain", portIter->m_Amp);
-			auxTxChannel[0] = portIter->m_channel;
-			wr_ch_str(chn, "rf_port_select", auxTxChannel);
 		}
 		else
 		{
-			if(portIter->m_Amp >= 0)
-			{
-				wr_ch_str(chn, "gain_control_mode", "manual");
-				wr_ch_double(chn, "hardwaregain", portIter->m_Amp);
-			}
-			else
-			{
-				wr_ch_str(chn, "gain_control_mode", "fast_attack");
-			}
-			auxRxChannel[0] = portIter->m_channel;
-			wr_ch_str(chn, "rf_port_select", auxRxChannel);
-			
+			wr_ch_str(chn, "gain_control_mode", "fast_attack");
 		}
-		if (!get_lo_chan(portIter->m_type, &chn, auxStr,auxContextAh )) 
-		{ 
-			return REALSDRNOTFOUND; 
-		}
-		wr_ch_lli(chn, "frequency", portIter->m_Frec);
+		auxRxChannel[0] = portIter->m_channel;
+		wr_ch_str(chn, "rf_port_select", auxRxChannel);
 		
-		portIter = portIter->m_next;
 	}
+	if (!get_lo_chan(portIter->m_type, &chn, auxStr, ctx)) 
+	{ 
+		return false; 
+	}
+	wr_ch_lli(chn, "frequency", portIter->m_Frec);
+	return true;
+}
+
+/*Processing stage of a streaming port, they are called in order with every block before the callback of the user*/
+struct StageList{
+	struct StageList* m_next;
+	SdrBlockCallback m_process;
+	void* m_data;
+};
+
+#define BURSTQUEUESIZE 32
+
+struct SdrBurst{
+	float* m_I;
+	float* m_Q;
+	int m_length;
+	unsigned long long m_sample;
+};
+
+/*State of a port which is streaming, one for each port of the virtual sdr*/
+struct SdrStream{
+	SdrBlockCallback m_callback;
+	void* m_data;
+	struct StageList* m_stages;
+	struct iio_device* m_device;
+	struct iio_buffer* m_buffer;
+	struct iio_channel* m_channelI;
+	struct iio_channel* m_channelQ;
+	float* m_I;
+	float* m_Q;
+	SdrPort m_port;
+	ChannelType m_type;
+	long m_FS;
+	int m_length;
+	atomic_bool m_running;
+	bool m_polled;
+	pthread_t m_thread;
 	
-	struct iio_device  *rtx;
-	struct iio_channel *rtx_i;
-	struct iio_channel *rtx_q;
+	/*Sample index of the first sample of the last block and of the next one, with the host time of the last block*/
+	unsigned long long m_sample;
+	unsigned long long m_nextSample;
+	unsigned long long m_time;
 	
-	struct iio_buffer  **rtxbuf;
-	rtxbuf = (struct iio_buffer**) malloc(numberPorts*sizeof(struct iio_buffer*));
-	((struct AD9361*) virtual->m_RealSdr)->m_rtxBuf = rtxbuf;
+	/*Number of times the port was started, so a stage can tell that the context and the configuration changed*/
+	int m_starts;
 	
-	portIter = virtual->m_ports;
+	/*Bursts waiting to be transmitted by a streaming TX port in order of sample, protected by m_lock*/
+	pthread_mutex_t m_lock;
+	struct SdrBurst m_bursts[BURSTQUEUESIZE];
+	int m_burstHead;
+	int m_burstCount;
+	int m_burstGap;
+	unsigned long long m_queueEnd;
+	unsigned long long m_filledSample;
+	SdrBurstCallback m_burstCallback;
+	void* m_burstData;
 	
-	char *p_dat, *p_end;
-	ptrdiff_t p_inc;
+	/*Signal statistics of a receiving port, also protected by m_lock*/
+	bool m_signalEnabled;
+	struct SdrSignalStats m_signal;
 	
-	for(int i = 0; i < numberPorts; i++)
-	{
-		int t_iter = 0;
-		switch(virtual->m_function[i])
-		{
-			case TXFILEONCE:
-			case TXONLYONCE:
-				if(!(get_ad9361_stream_dev(TX, &rtx, auxContextAh)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2+1, &rtx_q, auxStr)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				iio_channel_enable(rtx_i);
-				iio_channel_enable(rtx_q);
-				
-				rtxbuf[i] = iio_device_create_buffer(rtx, virtual->m_LengthBuffer[i], false);
-				if (!(rtxbuf[i])) {
-					return REALSDRNOTFOUND;
-				}
-				printf("%p\n",rtxbuf[i]);			
-				p_inc = iio_buffer_step(rtxbuf[i]);
-				p_end = iio_buffer_end(rtxbuf[i]);
-				for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) {
-					((int16_t*)p_dat)[0] = (int16_t) ((pow(2, 15)-1)*virtual->m_IList[i][t_iter]); // Real (I)
-					((int16_t*)p_dat)[1] = (int16_t) ((pow(2, 15)-1)*virtual->m_QList[i][t_iter]); // Imag (Q)
-					t_iter++;
-				}
-				break;
-			case RXFILE:
-			case RXONLYONCE:
-				if(!(get_ad9361_stream_dev(RX, &rtx, auxContextAh)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2+1, &rtx_q, auxStr)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				iio_channel_enable(rtx_i);
-				iio_channel_enable(rtx_q);
-				rtxbuf[i] = iio_device_create_buffer(rtx, virtual->m_LengthBuffer[i], false);
-				break;
-			case TXFILECONTINUOUSLY:
-			case TXCONTINUOUSLY:
-				if(!(get_ad9361_stream_dev(TX, &rtx, auxContextAh)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2+1, &rtx_q, auxStr)))
-				{
-					return REALSDRNOTFOUND;
-				}
-				iio_channel_enable(rtx_i);
-				iio_channel_enable(rtx_q);
-				portIter->m_state = ON;
-				rtxbuf[i] = iio_device_create_buffer(rtx, virtual->m_LengthBuffer[i], true);
-				if (!(rtxbuf[i])) {
-					return REALSDRNOTFOUND;
-				}
-				
-				p_inc = iio_buffer_step(rtxbuf[i]);
-				p_end = iio_buffer_end(rtxbuf[i]);
-				for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) {
-					((int16_t*)p_dat)[0] = (int16_t) ((pow(2, 15)-1)*virtual->m_IList[i][t_iter]); // Real (I)
-					((int16_t*)p_dat)[1] = (int16_t) ((pow(2, 15)-1)*virtual->m_QList[i][t_iter]); // Imag (Q)
-					t_iter++;
-				}
-				break;
-		}
-		portIter = portIter->m_next;
-	}
+	/*Accounting of the port, written by the thread which moves the data and read by anyone*/
+	bool m_xflowSupported;
+	unsigned long long m_lastTransfer;
+	atomic_ullong m_blocks;
+	atomic_ullong m_overflows;
+	atomic_ullong m_underflows;
+	atomic_ullong m_lostSamples;
+	atomic_ullong m_errors;
+	atomic_int m_lastError;
+	SdrXflowCallback m_xflowCallback;
+	void* m_xflowData;
 	
-	int bufferSent = 0;
-	for(int i = 0; i < numberPorts; i++)
+	/*Buffering and block length asked for the port and the kernel buffers StartSdr used, the block is resolved from them on every start*/
+	struct SdrBuffering m_buffering;
+	int m_requestedLength;
+	int m_kernelBuffers;
+	
+	/*Placement of the thread of the port, the cpu and migrations are seen from the thread itself*/
+	struct SdrThreadOptions m_options;
+	bool m_realtime;
+	atomic_int m_cpu;
+	atomic_ullong m_migrations;
+	
+	/*File served instead of the device when the connection is a replay*/
+	struct SdrReplay* m_replay;
+};
+
+/*
+	The axi cores of the AD9361 latch an overflow (adc) or underflow (dac) in their status register,
+	it's cleared writing the flag back.
+*/
+#define XFLOWREGISTER 0x80000088
+#define XFLOWOVERFLOW 0x4
+#define XFLOWUNDERFLOW 0x1
+
+/* reads and clears a flag of the status register, -1 if the register can't be read */
+static int check_xflow(struct iio_device* dev, uint32_t flag)
+{
+	uint32_t val;
+	if(iio_device_reg_read(dev, XFLOWREGISTER, &val) < 0)
 	{
-		if(virtual->m_function[i] == TXCONTINUOUSLY || virtual->m_function[i] == TXONLYONCE)
-		{
-			bufferSent = iio_buffer_push(rtxbuf[i]);
-		}
-		if(virtual->m_function[i] == RXONLYONCE)
-		{
-			bufferSent = iio_buffer_refill(rtxbuf[i]);
-		}
+		return -1;
 	}
-	
-	portIter = virtual->m_ports;
-	for(int i = 0; i < numberPorts; i++)
+	if(val & flag)
 	{
-		if(virtual->m_function[i] == RXONLYONCE)
-		{
-			int t_iter = 0;
-			p_inc = iio_buffer_step(rtxbuf[i]);
-			p_end = iio_buffer_end(rtxbuf[i]);
-			
-			if(!(get_ad9361_stream_dev(RX, &rtx, auxContextAh)))
-			{
-				return REALSDRNOTFOUND;
-			}
-			if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
-			{
-				return REALSDRNOTFOUND;
-			}
-			
-			for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) 
-			{
-				// Imag (Q) + Real (I)
-				
-				printf("%d --> %f, ",((int16_t*)p_dat)[0],virtual->m_IList[i][t_iter]);
-				printf("%d --> %f\n",((int16_t*)p_dat)[1],virtual->m_QList[i][t_iter]);
-				virtual->m_IList[i][t_iter] = (float)(((int16_t*)p_dat)[0])/(pow(2,11)-1);
-				virtual->m_QList[i][t_iter] = (float)(((int16_t*)p_dat)[1])/(pow(2,11)-1);
-				t_iter++;
-			}
-		}
-		if(virtual->m_function[i] == RXFILE)
-		{
-			p_inc = iio_buffer_step(rtxbuf[i]);
-			p_end = iio_buffer_end(rtxbuf[i]);
-			
-			if(!(get_ad9361_stream_dev(RX, &rtx, auxContextAh)))
-			{
-				return REALSDRNOTFOUND;
-			}
-			if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
-			{
-				return REALSDRNOTFOUND;
-			}
-			
-			FILE * stream = fopen(virtual->m_fileName[i], "r");
-			if(stream == NULL)
-			{
-				return FILENOTOPEN;
-			}
-			
-			for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) 
-			{
-				// Imag (Q) + Real (I)
-				fprintf(stream, "%f,%f\n",(float)((((int16_t*)p_dat)[0])>>4)/(pow(2,11)-1),(float)((((int16_t*)p_dat)[1])>>4)/(pow(2,11)-1));
-			}
-			fclose(stream);
-		}
-		portIter = portIter->m_next;
+		iio_device_reg_write(dev, XFLOWREGISTER, val);
+		return 1;
 	}
-	return OK;
+	return 0;
 }
 
-VirtualSdrError StopSdr(struct VirtualSdr* virtual)
+static void stream_status(struct SdrStream* stream, struct SdrPortStatus* status)
 {
-	free(((struct AD9361*) virtual->m_RealSdr)->m_ctx);
-	
-	struct PortList* portIter = virtual->m_ports;
-	int iterator = 0;
-	while(portIter != NULL)
+	status->m_blocks = atomic_load(&stream->m_blocks);
+	status->m_overflows = atomic_load(&stream->m_overflows);
+	status->m_underflows = atomic_load(&stream->m_underflows);
+	status->m_lostSamples = atomic_load(&stream->m_lostSamples);
+	status->m_errors = atomic_load(&stream->m_errors);
+	status->m_lastError = atomic_load(&stream->m_lastError);
+	status->m_cpu = atomic_load(&stream->m_cpu);
+	status->m_realtime = stream->m_realtime;
+	status->m_migrations = atomic_load(&stream->m_migrations);
+}
+
+static void stream_notify(struct SdrStream* stream)
+{
+	if(stream->m_xflowCallback != NULL)
 	{
-		if(virtual->m_function[iterator] == TXCONTINUOUSLY || virtual->m_function[iterator] == TXFILECONTINUOUSLY)
-		{
-			portIter->m_state = OFF;
-			free(((struct AD9361*) virtual->m_RealSdr)->m_rtxBuf[iterator]);
-		}
-		iterator++;
-		portIter = portIter->m_next;
+		struct SdrPortStatus status;
+		stream_status(stream, &status);
+		stream->m_xflowCallback(stream->m_port, stream->m_type, &status, stream->m_xflowData);
 	}
-	free(((struct AD9361*) virtual->m_RealSdr)->m_rtxBuf);
-	
-	return OK;
 }
 
-VirtualSdrError ChargeConfig(struct VirtualSdr* virtual, struct SdrConfig* configuration)
+/*Clears the flags left by a previous use of the device before the port starts*/
+static void stream_account_start(struct SdrStream* stream)
 {
-	if(virtual == NULL || configuration == NULL)
+	stream->m_xflowSupported = stream->m_device != NULL && check_xflow(stream->m_device, stream->m_type == RX ? XFLOWOVERFLOW : XFLOWUNDERFLOW) >= 0;
+	stream->m_lastTransfer = now_ns();
+}
+
+static void stream_account_error(struct SdrStream* stream, ssize_t res)
+{
+	atomic_fetch_add(&stream->m_errors, 1);
+	atomic_store(&stream->m_lastError, (int)res);
+	stream_notify(stream);
+}
+
+/*
+	Counts a block moved, checks if the device lost samples and stamps the block. The samples lost are estimated
+	with the time since the previous block minus the time the block lasts, and they are skipped in the sample
+	index so it keeps following the device. The time is the one of the first sample of the block, the sample and
+	the time are written together under m_lock so GetPortTime never reads a pair of two blocks.
+*/
+static void stream_account_block(struct SdrStream* stream)
+{
+	unsigned long long now = now_ns();
+	atomic_fetch_add(&stream->m_blocks, 1);
+	int cpu = sched_getcpu();
+	if(atomic_exchange(&stream->m_cpu, cpu) != cpu && atomic_load(&stream->m_blocks) > 1)
 	{
-		return NULLPOINTER;
+		atomic_fetch_add(&stream->m_migrations, 1);
 	}
+	if(stream->m_xflowSupported && check_xflow(stream->m_device, stream->m_type == RX ? XFLOWOVERFLOW : XFLOWUNDERFLOW) == 1)
+	{
+		double lost = (now - stream->m_lastTransfer)*1e-9*stream->m_FS - stream->m_length;
+		unsigned long long lostSamples = lost > 0 ? (unsigned long long)lost : 0;
+		atomic_fetch_add(stream->m_type == RX ? &stream->m_overflows : &stream->m_underflows, 1);
+		atomic_fetch_add(&stream->m_lostSamples, lostSamples);
+		stream->m_nextSample += lostSamples;
+		stream_notify(stream);
+	}
+	stream->m_lastTransfer = now;
+	pthread_mutex_lock(&stream->m_lock);
+	stream->m_sample = stream->m_nextSample;
+	stream->m_time = now - (stream->m_type == RX ? (unsigned long long)(stream->m_length*1e9/stream->m_FS) : 0);
+	pthread_mutex_unlock(&stream->m_lock);
+	stream->m_nextSample += stream->m_length;
+}
+
+/*
+	Buffering of a port. With a target latency the data waiting in the kernel is about the latency, so
+	the block is latency*FS over the number of kernel buffers, or the number of buffers is latency*FS over
+	the block when the block is fixed. Blocks are multiples of BUFFERINGALIGN samples. The sizes are clamped
+	in double before they are turned to int, so a long latency at a high rate can't overflow. Without any
+	setting the port takes BUFFERINGKERNELDEFAULT kernel buffers, the default of libiio.
+*/
+#define BUFFERINGKERNELDEFAULT 4
+#define BUFFERINGMINKERNEL 2
+#define BUFFERINGMAXKERNEL 64
+#define BUFFERINGMINBLOCK 256
+#define BUFFERINGMAXBLOCK (1 << 22)
+#define BUFFERINGALIGN 64
+
+static void resolve_buffering(struct SdrBuffering* buffering, long fs, int length, int* block, int* kernelBuffers)
+{
+	*block = length;
+	*kernelBuffers = buffering->m_kernelBuffers;
+	if(buffering->m_latency > 0 && buffering->m_blockLength > 0 && buffering->m_kernelBuffers <= 0)
+	{
+		double buffers = (double) buffering->m_latency*fs/buffering->m_blockLength;
+		buffers = buffers < BUFFERINGMINKERNEL ? BUFFERINGMINKERNEL : buffers;
+		buffers = buffers > BUFFERINGMAXKERNEL ? BUFFERINGMAXKERNEL : buffers;
+		*kernelBuffers = (int) buffers;
+	}
+	else if(buffering->m_latency > 0 && buffering->m_blockLength <= 0)
+	{
+		*kernelBuffers = *kernelBuffers > 0 ? *kernelBuffers : BUFFERINGKERNELDEFAULT;
+		double samples = (double) buffering->m_latency*fs/(*kernelBuffers);
+		samples = samples > BUFFERINGMAXBLOCK ? BUFFERINGMAXBLOCK : samples;
+		*block = (int) samples;
+	}
+	*kernelBuffers = *kernelBuffers > 0 ? *kernelBuffers : BUFFERINGKERNELDEFAULT;
+	if(buffering->m_blockLength > 0)
+	{
+		*block = buffering->m_blockLength;
+	}
+	else if(buffering->m_latency > 0)
+	{
+		*block = *block/BUFFERINGALIGN*BUFFERINGALIGN;
+		*block = *block < BUFFERINGMINBLOCK ? BUFFERINGMINBLOCK : *block;
+		*block = *block > BUFFERINGMAXBLOCK ? BUFFERINGMAXBLOCK : *block;
+	}
+}
+
+/*
+	Creates the buffer of a port with its buffering. Only streaming ports change their block, resolved from
+	the length asked by the user so a later start sees a new buffering, the others keep that length. The count of kernel buffers is of the device and is taken when a buffer
+	is created, so it's set again before every buffer and a port doesn't get the one of another port.
+*/
+static struct iio_buffer* create_port_buffer(struct VirtualSdr* virtual, int iter, struct iio_device* dev, bool cyclic)
+{
+	struct SdrStream* stream = &virtual->m_streams[iter];
+	int block, kernelBuffers;
+	if(virtual->m_function[iter] == RXSTREAM || virtual->m_function[iter] == TXSTREAM)
+	{
+		resolve_buffering(&stream->m_buffering, virtual->m_FS, stream->m_requestedLength, &block, &kernelBuffers);
+		virtual->m_LengthBuffer[iter] = block;
+	}
+	else
+	{
+		resolve_buffering(&stream->m_buffering, virtual->m_FS, virtual->m_LengthBuffer[iter], &block, &kernelBuffers);
+	}
+	stream->m_kernelBuffers = 0;
+	if(!cyclic && iio_device_set_kernel_buffers_count(dev, kernelBuffers) == 0)
+	{
+		stream->m_kernelBuffers = kernelBuffers;
+	}
+	return create_buffer(dev, virtual->m_LengthBuffer[iter], cyclic);
+}
+
+/*The state of a port is written by the thread which starts or stops it and read from any thread*/
+static void set_port_state(struct PortList* port, SdrPortState state)
+{
+	__atomic_store_n(&port->m_state, state, __ATOMIC_RELEASE);
+}
+
+/*Finds a port of the virtual sdr, NULL if it isn't there*/
+static struct PortList* find_port(struct VirtualSdr* virtual, ChannelType type, SdrPort port)
+{
+	struct PortList* portIter = virtual->m_ports;
+	while(portIter != NULL)
+	{
+		if(portIter->m_type == type && portIter->m_port == port)
+		{
+			return portIter;
+		}
+		portIter = portIter->m_next;
+	}
+	return NULL;
+}
+
+/*Finds the position of a port in the lists of the virtual sdr, -1 if it isn't there*/
+static int find_port_index(struct VirtualSdr* virtual, ChannelType type, SdrPort port)
+{
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	while(portIter != NULL)
+	{
+		if(portIter->m_type == type && portIter->m_port == port)
+		{
+			return iter;
+		}
+		iter++;
+		portIter = portIter->m_next;
+	}
+	return -1;
+}
+
+/*
+	Replay of a file as the device. With a REPLAY or REPLAYFAST connection every RX port reads the location from
+	its start, a file saved by ReceiveToFile (lines "I,Q") or the base name of a recording made by CreateRecorder,
+	and StartSdr serves it through the same functions as the device. REPLAY gives each block when it would have
+	been received at FS, REPLAYFAST as soon as it's read.
+*/
+#define REPLAYLINE 128
+
+struct SdrReplay{
+	FILE* m_csv;
+	struct SdrRecording* m_recording;
+	unsigned long long m_position;
+	bool m_paced;
+	long m_FS;
+	unsigned long long m_start;
+	unsigned long long m_served;
+};
+
+static bool is_replay(struct VirtualSdr* virtual)
+{
+	return virtual->m_connectionType == REPLAY || virtual->m_connectionType == REPLAYFAST;
+}
+
+static void free_replay(struct SdrReplay* replay)
+{
+	if(replay != NULL)
+	{
+		if(replay->m_csv != NULL)
+		{
+			fclose(replay->m_csv);
+		}
+		FreeRecording(replay->m_recording);
+		free(replay);
+	}
+}
+
+static VirtualSdrError create_replay(struct SdrReplay** replay, struct VirtualSdr* virtual)
+{
+	struct SdrReplay* aux = (struct SdrReplay*) calloc(1, sizeof(struct SdrReplay));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	aux->m_paced = virtual->m_connectionType == REPLAY;
+	aux->m_FS = virtual->m_FS;
 	
-	FreeVirtualSdr (virtual);
-	
-	virtual->m_connectionType = configuration->m_connectionType;
-	strcpy(virtual->m_location, configuration->m_location);
-	virtual->m_RxChannel = configuration->m_activeRxChannel;
-	virtual->m_TxChannel = configuration->m_activeTxChannel;
-	virtual->m_FS = configuration->m_FS;
+	char fileName[300];
+	snprintf(fileName, sizeof(fileName), "%s.sigmf-idx", virtual->m_location);
+	if(access(fileName, R_OK) == 0)
+	{
+		VirtualSdrError error = OpenRecording(&aux->m_recording, virtual->m_location);
+		if(error != OK)
+		{
+			free_replay(aux);
+			return error;
+		}
+	}
+	else
+	{
+		aux->m_csv = fopen(virtual->m_location, "r");
+		if(aux->m_csv == NULL)
+		{
+			free_replay(aux);
+			return FILENOTOPEN;
+		}
+	}
+	*replay = aux;
+	return OK;
+}
+
+/*
+	Reads the next len samples of the file, returns the samples read, -ENODATA at its end or -EAGAIN when a
+	paced replay which can't wait isn't due yet.
+*/
+static ssize_t replay_read(struct SdrReplay* replay, float* I_rx, float* Q_rx, int len, bool wait)
+{
+	if(replay->m_paced)
+	{
+		if(replay->m_start == 0)
+		{
+			replay->m_start = now_ns();
+		}
+		unsigned long long due = replay->m_start + (unsigned long long)((replay->m_served + len)*1e9/replay->m_FS);
+		if(!wait && now_ns() < due)
+		{
+			return -EAGAIN;
+		}
+		struct timespec until = {due/1000000000ULL, due%1000000000ULL};
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+	}
 	
-	virtual->m_ports = NULL;
-	struct PortList * portIter = configuration->m_ports;
+	int got = 0;
+	if(replay->m_recording != NULL)
+	{
+		if(ReadRecordingSamples(replay->m_recording, replay->m_position, len, I_rx, Q_rx, &got) != OK)
+		{
+			return -EIO;
+		}
+		replay->m_position += got;
+	}
+	else
+	{
+		char line[REPLAYLINE];
+		while(got < len && fgets(line, sizeof(line), replay->m_csv) != NULL)
+		{
+			char* end;
+			I_rx[got] = strtof(line, &end);
+			if(*end == ',')
+			{
+				Q_rx[got] = strtof(end + 1, NULL);
+				got++;
+			}
+		}
+	}
+	replay->m_served += got;
+	return got > 0 ? got : -ENODATA;
+}
+
+/*Refills one block of a receiving port and gives it to the stages and then to the user, negative code of the refill if it fails*/
+static ssize_t stream_rx_step(struct SdrStream* stream)
+{
+	ssize_t res;
+	if(stream->m_replay != NULL)
+	{
+		res = replay_read(stream->m_replay, stream->m_I, stream->m_Q, stream->m_length, !stream->m_polled);
+	}
+	else
+	{
+		res = refill_buffer(stream->m_buffer);
+	}
+	if(res < 0)
+	{
+		return res;
+	}
+	stream_account_block(stream);
 	
-	int bufferNeeded = 0;
-	while(portIter != NULL && virtual->m_ports == NULL)
+	struct SdrBlock block;
+	block.m_port = stream->m_port;
+	block.m_I = stream->m_I;
+	block.m_Q = stream->m_Q;
+	block.m_sample = stream->m_sample;
+	block.m_time = stream->m_time;
+	block.m_length = res;
+	
+	if(stream->m_replay == NULL)
 	{
-		if((portIter->m_channel == virtual->m_RxChannel && portIter->m_type == RX)||(portIter->m_channel == virtual->m_TxChannel && portIter->m_type == TX))
+		METRIC_BEGIN(conversion);
+		int t_iter = 0;
+		ptrdiff_t p_inc = iio_buffer_step(stream->m_buffer);
+		char* p_end = iio_buffer_end(stream->m_buffer);
+		for (char* p_dat = (char *)iio_buffer_first(stream->m_buffer, stream->m_channelI); p_dat < p_end; p_dat += p_inc)
 		{
-			virtual->m_ports = (struct PortList*) malloc(sizeof(struct PortList));
-			memcpy(virtual->m_ports,portIter,sizeof(struct PortList));
-			virtual->m_ports->m_state = OFF;
-			virtual->m_ports->m_next = NULL;
-			bufferNeeded++;
+			stream->m_I[t_iter] = (float)(((int16_t*)p_dat)[0])/(pow(2,11)-1);
+			stream->m_Q[t_iter] = (float)(((int16_t*)p_dat)[1])/(pow(2,11)-1);
+			t_iter++;
 		}
-		portIter = portIter->m_next;
+		block.m_length = t_iter;
+		METRIC_END(METRICCONVERSION, conversion, t_iter*2*sizeof(int16_t));
 	}
 	
-	struct PortList * virtualPortIter = virtual->m_ports;
+	struct StageList* stage = stream->m_stages;
+	while(stage != NULL)
+	{
+		METRIC_BEGIN(begin);
+		stage->m_process(&block, stage->m_data);
+		METRIC_END(METRICSTAGE, begin, block.m_length*2*sizeof(float));
+		stage = stage->m_next;
+	}
+	if(stream->m_callback != NULL)
+	{
+		METRIC_BEGIN(begin);
+		stream->m_callback(&block, stream->m_data);
+		METRIC_END(METRICSTAGE, begin, block.m_length*2*sizeof(float));
+	}
+	return res;
+}
+
+/*
+	Pushes one block to a transmitting port, negative code of the push if it fails. The block is zeros except
+	where the bursts of the queue fall. A burst leaves the queue once the block with its last sample is pushed,
+	so a failed push is filled again with the same bursts.
+*/
+static ssize_t stream_tx_step(struct SdrStream* stream)
+{
+	unsigned long long completed[BURSTQUEUESIZE];
+	
+	METRIC_BEGIN(conversion);
+	unsigned long long first = stream->m_nextSample;
+	unsigned long long last = first + stream->m_length;
+	int nCompleted = 0;
+	memset(stream->m_I, 0, 2*stream->m_length*sizeof(float));
+	
+	pthread_mutex_lock(&stream->m_lock);
+	for(int iter = 0; iter < stream->m_burstCount; iter++)
+	{
+		struct SdrBurst* burst = &stream->m_bursts[(stream->m_burstHead + iter)%BURSTQUEUESIZE];
+		if(burst->m_sample >= last)
+		{
+			break;
+		}
+		unsigned long long burstEnd = burst->m_sample + burst->m_length;
+		unsigned long long begin = burst->m_sample > first ? burst->m_sample : first;
+		unsigned long long end = burstEnd < last ? burstEnd : last;
+		for(unsigned long long sample = begin; sample < end; sample++)
+		{
+			stream->m_I[sample - first] = burst->m_I[sample - burst->m_sample];
+			stream->m_Q[sample - first] = burst->m_Q[sample - burst->m_sample];
+		}
+		if(burstEnd <= last)
+		{
+			completed[nCompleted] = burst->m_sample;
+			nCompleted++;
+		}
+	}
+	stream->m_filledSample = last;
+	pthread_mutex_unlock(&stream->m_lock);
+	
+	struct SdrBlock block;
+	block.m_port = stream->m_port;
+	block.m_I = stream->m_I;
+	block.m_Q = stream->m_Q;
+	block.m_sample = first;
+	block.m_time = now_ns();
+	block.m_length = stream->m_length;
+	struct StageList* stage = stream->m_stages;
+	while(stage != NULL)
+	{
+		METRIC_BEGIN(begin);
+		stage->m_process(&block, stage->m_data);
+		METRIC_END(METRICSTAGE, begin, block.m_length*2*sizeof(float));
+		stage = stage->m_next;
+	}
+	
+	int t_iter = 0;
+	ptrdiff_t p_inc = iio_buffer_step(stream->m_buffer);
+	char* p_end = iio_buffer_end(stream->m_buffer);
+	for (char* p_dat = (char *)iio_buffer_first(stream->m_buffer, stream->m_channelI); p_dat < p_end; p_dat += p_inc)
+	{
+		((int16_t*)p_dat)[0] = (int16_t) ((pow(2, 15)-1)*stream->m_I[t_iter]); // Real (I)
+		((int16_t*)p_dat)[1] = (int16_t) ((pow(2, 15)-1)*stream->m_Q[t_iter]); // Imag (Q)
+		t_iter++;
+	}
+	METRIC_END(METRICCONVERSION, conversion, t_iter*2*sizeof(int16_t));
+	
+	ssize_t res = push_buffer(stream->m_buffer);
+	if(res < 0)
+	{
+		return res;
+	}
+	stream_account_block(stream);
+	
+	if(nCompleted > 0)
+	{
+		pthread_mutex_lock(&stream->m_lock);
+		stream->m_burstHead = (stream->m_burstHead + nCompleted)%BURSTQUEUESIZE;
+		stream->m_burstCount -= nCompleted;
+		pthread_mutex_unlock(&stream->m_lock);
+		if(stream->m_burstCallback != NULL)
+		{
+			for(int iter = 0; iter < nCompleted; iter++)
+			{
+				stream->m_burstCallback(stream->m_port, completed[iter], stream->m_burstData);
+			}
+		}
+	}
+	return res;
+}
+
+/*
+	Allocates the samples of a streaming port and touches them, so the pages are placed in the NUMA node of the
+	thread which calls it.
+*/
+static bool stream_alloc(struct SdrStream* stream)
+{
+	stream->m_I = (float*) malloc(2*stream->m_length*sizeof(float));
+	if(stream->m_I == NULL)
+	{
+		return false;
+	}
+	memset(stream->m_I, 0, 2*stream->m_length*sizeof(float));
+	stream->m_Q = stream->m_I + stream->m_length;
+	return true;
+}
+
+/*Pins the calling thread and raises its priority as the options of the port say, failures only leave it as it was*/
+static void stream_place(struct SdrStream* stream)
+{
+	if(stream->m_options.m_cpu >= 0)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(stream->m_options.m_cpu, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+	}
+	stream->m_realtime = false;
+	if(stream->m_options.m_priority > 0)
+	{
+		struct sched_param param;
+		param.sched_priority = stream->m_options.m_priority;
+		stream->m_realtime = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+	}
+	atomic_store(&stream->m_cpu, sched_getcpu());
+}
+
+/*Moves blocks of a streaming port until it's stopped, timeouts are counted and retried*/
+static void* stream_thread(void* arg)
+{
+	struct SdrStream* stream = (struct SdrStream*) arg;
 	
+	stream_place(stream);
+	if(!stream_alloc(stream))
+	{
+		stream_account_error(stream, -ENOMEM);
+		atomic_store(&stream->m_running, false);
+		return NULL;
+	}
+	stream_account_start(stream);
+	while(atomic_load(&stream->m_running))
+	{
+		ssize_t res = stream->m_type == RX ? stream_rx_step(stream) : stream_tx_step(stream);
+		if(res < 0)
+		{
+			if(!atomic_load(&stream->m_running) || res == -ENODATA)
+			{
+				/*Stopped, or the file replayed has ended*/
+				break;
+			}
+			stream_account_error(stream, res);
+			if(res == -ETIMEDOUT || res == -EAGAIN)
+			{
+				continue;
+			}
+			break;
+		}
+	}
+	atomic_store(&stream->m_running, false);
+	return NULL;
+}
+
+static void stream_stop(struct SdrStream* stream)
+{
+	if(stream->m_buffer != NULL || stream->m_replay != NULL)
+	{
+		atomic_store(&stream->m_running, false);
+		if(!stream->m_polled)
+		{
+			if(stream->m_buffer != NULL)
+			{
+				iio_buffer_cancel(stream->m_buffer);
+			}
+			pthread_join(stream->m_thread, NULL);
+		}
+		if(stream->m_buffer != NULL)
+		{
+			iio_buffer_destroy(stream->m_buffer);
+			stream->m_buffer = NULL;
+		}
+		free_replay(stream->m_replay);
+		stream->m_replay = NULL;
+	}
+	free(stream->m_I);
+	stream->m_I = NULL;
+	stream->m_Q = NULL;
+}
+
+/*
+	StartSdr of a replay. Only the RX functions are served, the samples missing at the end of the file for
+	Receive and ReceiveToFile are zeros.
+*/
+static VirtualSdrError start_replay(struct VirtualSdr* virtual)
+{
+	virtual->m_RealSdr = calloc(1, sizeof(struct AD9361));
+	if(virtual->m_RealSdr == NULL)
+	{
+		return NOMEMORY;
+	}
+	struct PortList* portIter = virtual->m_ports;
+	int i = 0;
 	while(portIter != NULL)
 	{
-		if((portIter->m_channel == virtual->m_RxChannel && portIter->m_type == RX)||(portIter->m_channel == virtual->m_TxChannel && portIter->m_type == TX))
+		struct SdrStream* stream = &virtual->m_streams[i];
+		SdrFunction function = virtual->m_function[i];
+		if(function != NOFUNCTION)
 		{
-			virtualPortIter->m_next = (struct PortList*) malloc(sizeof(struct PortList));
-			memcpy(virtualPortIter->m_next ,portIter,sizeof(struct PortList));
-			virtualPortIter = virtualPortIter->m_next;
-			virtualPortIter->m_next = NULL;
-			virtualPortIter->m_state = OFF;
-			bufferNeeded++;
+			if(function != RXONLYONCE && function != RXFILE && function != RXSTREAM)
+			{
+				return NOTIMPLEMENTED;
+			}
+			stream->m_port = portIter->m_port;
+			stream->m_type = portIter->m_type;
+			stream->m_FS = virtual->m_FS;
+			stream->m_nextSample = 0;
+			stream->m_starts++;
+			stream->m_device = NULL;
+			stream->m_buffer = NULL;
+			VirtualSdrError error = create_replay(&stream->m_replay, virtual);
+			if(error != OK)
+			{
+				return error;
+			}
+		}
+		if(function == RXONLYONCE || function == RXFILE)
+		{
+			stream->m_length = virtual->m_LengthBuffer[i];
+			stream_account_start(stream);
+			ssize_t got = replay_read(stream->m_replay, virtual->m_IList[i], virtual->m_QList[i], stream->m_length, true);
+			got = got > 0 ? got : 0;
+			memset(virtual->m_IList[i] + got, 0, (stream->m_length - got)*sizeof(float));
+			memset(virtual->m_QList[i] + got, 0, (stream->m_length - got)*sizeof(float));
+			stream_account_block(stream);
+			free_replay(stream->m_replay);
+			stream->m_replay = NULL;
+		}
+		if(function == RXFILE)
+		{
+			FILE* file = fopen(virtual->m_fileName[i], "w");
+			if(file == NULL)
+			{
+				return FILENOTOPEN;
+			}
+			METRIC_BEGIN(fileWrite);
+			for(int t_iter = 0; t_iter < stream->m_length; t_iter++)
+			{
+				fprintf(file, "%f,%f\n", virtual->m_IList[i][t_iter], virtual->m_QList[i][t_iter]);
+			}
+			fclose(file);
+			METRIC_END(METRICFILE, fileWrite, stream->m_length*2*sizeof(float));
+		}
+		if(function == RXSTREAM)
+		{
+			resolve_buffering(&stream->m_buffering, virtual->m_FS, stream->m_requestedLength, &virtual->m_LengthBuffer[i], &stream->m_kernelBuffers);
+			stream->m_kernelBuffers = 0;
+			stream->m_length = virtual->m_LengthBuffer[i];
+			stream->m_I = NULL;
+			stream->m_Q = NULL;
+			if(stream->m_polled)
+			{
+				if(!stream_alloc(stream))
+				{
+					return NOMEMORY;
+				}
+				stream_account_start(stream);
+			}
+			atomic_store(&stream->m_running, true);
+			if(!stream->m_polled && pthread_create(&stream->m_thread, NULL, stream_thread, stream) != 0)
+			{
+				atomic_store(&stream->m_running, false);
+				return NOMEMORY;
+			}
+			set_port_state(portIter, ON);
 		}
+		i++;
 		portIter = portIter->m_next;
 	}
+	return OK;
+}
+
+VirtualSdrError StartSdr(struct VirtualSdr* virtual)
+{
+
+	/*
+		Improvements:
+			-Clean this mess
+			-Save the iio_context and iio_buffers in the null pointer to be cleaned in the stopSDR function
+			-Add the part where we put the ports in ON --> Question, only put ON the nodes of always? if port is just only once how do you put later the OFF, is threading an option?
+	*/	
 	
-	virtual->m_IList = (float**)malloc(bufferNeeded*sizeof(float*));
-	virtual->m_QList = (float**)malloc(bufferNeeded*sizeof(float*));
-	virtual->m_LengthBuffer = (int*)malloc(bufferNeeded*sizeof(int));
-	virtual->m_fileName = (char**)malloc(bufferNeeded*sizeof(char*));
-	virtual->m_function = (SdrFunction*)malloc(bufferNeeded*sizeof(SdrFunction));
+	struct iio_context * auxContextAh;
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(is_replay(virtual))
+	{
+		return start_replay(virtual);
+	}
 	
-	for(int i = 0; i < bufferNeeded; i++)
+	virtual->m_RealSdr = (struct AD9361 *) malloc(sizeof(struct AD9361));
+	auxContextAh = create_context(virtual);
+	((struct AD9361*) virtual->m_RealSdr)->m_ctx = auxContextAh;
+	if(auxContextAh == NULL)
+	{
+		return REALSDRNOTFOUND;
+	}
+	
+	struct PortList* portIter = virtual->m_ports;
+	char auxStr [64];
+	int numberPorts = 0;
+	
+	while(portIter != NULL)
+	{
+		numberPorts++;
+		if(!configure_port(auxContextAh, virtual->m_FS, portIter, auxStr))
+		{
+			return REALSDRNOTFOUND;
+		}
+		portIter = portIter->m_next;
+	}
+	
+	struct iio_device  *rtx = NULL;
+	struct iio_channel *rtx_i;
+	struct iio_channel *rtx_q;
+	
+	struct iio_buffer  **rtxbuf;
+	rtxbuf = (struct iio_buffer**) malloc(numberPorts*sizeof(struct iio_buffer*));
+	((struct AD9361*) virtual->m_RealSdr)->m_rtxBuf = rtxbuf;
+	
+	portIter = virtual->m_ports;
+	
+	char *p_dat, *p_end;
+	ptrdiff_t p_inc;
+	
+	for(int i = 0; i < numberPorts; i++)
+	{
+		int t_iter = 0;
+		virtual->m_streams[i].m_port = portIter->m_port;
+		virtual->m_streams[i].m_type = portIter->m_type;
+		virtual->m_streams[i].m_FS = virtual->m_FS;
+		virtual->m_streams[i].m_nextSample = 0;
+		virtual->m_streams[i].m_starts++;
+		virtual->m_streams[i].m_filledSample = 0;
+		virtual->m_streams[i].m_queueEnd = 0;
+		virtual->m_streams[i].m_burstHead = 0;
+		virtual->m_streams[i].m_burstCount = 0;
+		switch(virtual->m_function[i])
+		{
+			case TXFILEONCE:
+			case TXONLYONCE:
+				if(!(get_ad9361_stream_dev(TX, &rtx, auxContextAh)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2+1, &rtx_q, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				iio_channel_enable(rtx_i);
+				iio_channel_enable(rtx_q);
+				
+				rtxbuf[i] = create_port_buffer(virtual, i, rtx, false);
+				if (!(rtxbuf[i])) {
+					return REALSDRNOTFOUND;
+				}
+				METRIC_BEGIN(conversionOnce);
+				p_inc = iio_buffer_step(rtxbuf[i]);
+				p_end = iio_buffer_end(rtxbuf[i]);
+				for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) {
+					((int16_t*)p_dat)[0] = (int16_t) ((pow(2, 15)-1)*virtual->m_IList[i][t_iter]); // Real (I)
+					((int16_t*)p_dat)[1] = (int16_t) ((pow(2, 15)-1)*virtual->m_QList[i][t_iter]); // Imag (Q)
+					t_iter++;
+				}
+				METRIC_END(METRICCONVERSION, conversionOnce, t_iter*2*sizeof(int16_t));
+				break;
+			case RXFILE:
+			case RXONLYONCE:
+				if(!(get_ad9361_stream_dev(RX, &rtx, auxContextAh)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2+1, &rtx_q, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				iio_channel_enable(rtx_i);
+				iio_channel_enable(rtx_q);
+				rtxbuf[i] = create_port_buffer(virtual, i, rtx, false);
+				break;
+			case RXSTREAM:
+			case TXSTREAM:
+				if(!(get_ad9361_stream_dev(portIter->m_type, &rtx, auxContextAh)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(portIter->m_type, rtx, portIter->m_port*2, &rtx_i, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(portIter->m_type, rtx, portIter->m_port*2+1, &rtx_q, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				iio_channel_enable(rtx_i);
+				iio_channel_enable(rtx_q);
+				rtxbuf[i] = create_port_buffer(virtual, i, rtx, false);
+				if (!(rtxbuf[i])) {
+					return REALSDRNOTFOUND;
+				}
+				virtual->m_streams[i].m_buffer = rtxbuf[i];
+				virtual->m_streams[i].m_channelI = rtx_i;
+				virtual->m_streams[i].m_channelQ = rtx_q;
+				virtual->m_streams[i].m_length = virtual->m_LengthBuffer[i];
+				virtual->m_streams[i].m_I = NULL;
+				virtual->m_streams[i].m_Q = NULL;
+				if(virtual->m_streams[i].m_polled && !stream_alloc(&virtual->m_streams[i]))
+				{
+					return NOMEMORY;
+				}
+				break;
+			case TXFILECONTINUOUSLY:
+			case TXCONTINUOUSLY:
+				if(!(get_ad9361_stream_dev(TX, &rtx, auxContextAh)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				if(!(get_ad9361_stream_ch(TX, rtx, portIter->m_port*2+1, &rtx_q, auxStr)))
+				{
+					return REALSDRNOTFOUND;
+				}
+				iio_channel_enable(rtx_i);
+				iio_channel_enable(rtx_q);
+				set_port_state(portIter, ON);
+				rtxbuf[i] = create_port_buffer(virtual, i, rtx, true);
+				if (!(rtxbuf[i])) {
+					return REALSDRNOTFOUND;
+				}
+				METRIC_BEGIN(conversionAlways);
+				p_inc = iio_buffer_step(rtxbuf[i]);
+				p_end = iio_buffer_end(rtxbuf[i]);
+				for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) {
+					((int16_t*)p_dat)[0] = (int16_t) ((pow(2, 15)-1)*virtual->m_IList[i][t_iter]); // Real (I)
+					((int16_t*)p_dat)[1] = (int16_t) ((pow(2, 15)-1)*virtual->m_QList[i][t_iter]); // Imag (Q)
+					t_iter++;
+				}
+				METRIC_END(METRICCONVERSION, conversionAlways, t_iter*2*sizeof(int16_t));
+				break;
+		}
+		if(virtual->m_function[i] != NOFUNCTION)
+		{
+			virtual->m_streams[i].m_device = rtx;
+			virtual->m_streams[i].m_length = virtual->m_LengthBuffer[i];
+		}
+		portIter = portIter->m_next;
+	}
+	
+	ssize_t bufferSent = 0;
+	for(int i = 0; i < numberPorts; i++)
+	{
+		if(virtual->m_function[i] != NOFUNCTION && virtual->m_function[i] != RXSTREAM && virtual->m_function[i] != TXSTREAM)
+		{
+			stream_account_start(&virtual->m_streams[i]);
+		}
+		if(virtual->m_function[i] == TXCONTINUOUSLY || virtual->m_function[i] == TXONLYONCE)
+		{
+			bufferSent = push_buffer(rtxbuf[i]);
+		}
+		else if(virtual->m_function[i] == RXONLYONCE || virtual->m_function[i] == RXFILE)
+		{
+			bufferSent = refill_buffer(rtxbuf[i]);
+		}
+		else
+		{
+			continue;
+		}
+		if(bufferSent < 0)
+		{
+			stream_account_error(&virtual->m_streams[i], bufferSent);
+			return BUFFERERROR;
+		}
+		stream_account_block(&virtual->m_streams[i]);
+	}
+	
+	portIter = virtual->m_ports;
+	for(int i = 0; i < numberPorts; i++)
+	{
+		if(virtual->m_function[i] == RXONLYONCE)
+		{
+			int t_iter = 0;
+			p_inc = iio_buffer_step(rtxbuf[i]);
+			p_end = iio_buffer_end(rtxbuf[i]);
+			
+			if(!(get_ad9361_stream_dev(RX, &rtx, auxContextAh)))
+			{
+				return REALSDRNOTFOUND;
+			}
+			if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
+			{
+				return REALSDRNOTFOUND;
+			}
+			
+			METRIC_BEGIN(conversion);
+			for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) 
+			{
+				// Imag (Q) + Real (I)
+				virtual->m_IList[i][t_iter] = (float)(((int16_t*)p_dat)[0])/(pow(2,11)-1);
+				virtual->m_QList[i][t_iter] = (float)(((int16_t*)p_dat)[1])/(pow(2,11)-1);
+				t_iter++;
+			}
+			METRIC_END(METRICCONVERSION, conversion, t_iter*2*sizeof(int16_t));
+		}
+		if(virtual->m_function[i] == RXFILE)
+		{
+			p_inc = iio_buffer_step(rtxbuf[i]);
+			p_end = iio_buffer_end(rtxbuf[i]);
+			
+			if(!(get_ad9361_stream_dev(RX, &rtx, auxContextAh)))
+			{
+				return REALSDRNOTFOUND;
+			}
+			if(!(get_ad9361_stream_ch(RX, rtx, portIter->m_port*2, &rtx_i, auxStr)))
+			{
+				return REALSDRNOTFOUND;
+			}
+			
+			FILE * stream = fopen(virtual->m_fileName[i], "w");
+			if(stream == NULL)
+			{
+				return FILENOTOPEN;
+			}
+			
+			METRIC_BEGIN(fileWrite);
+			for (p_dat = (char *)iio_buffer_first(rtxbuf[i], rtx_i); p_dat < p_end; p_dat += p_inc) 
+			{
+				// Imag (Q) + Real (I), same scale as RXONLYONCE so a replay of the file matches the stream
+				fprintf(stream, "%f,%f\n",(float)(((int16_t*)p_dat)[0])/(pow(2,11)-1),(float)(((int16_t*)p_dat)[1])/(pow(2,11)-1));
+			}
+			fclose(stream);
+			METRIC_END(METRICFILE, fileWrite, (p_end - (char*)iio_buffer_start(rtxbuf[i])));
+		}
+		if((virtual->m_function[i] == RXSTREAM || virtual->m_function[i] == TXSTREAM) && virtual->m_streams[i].m_polled)
+		{
+			iio_buffer_set_blocking_mode(rtxbuf[i], false);
+			stream_account_start(&virtual->m_streams[i]);
+			atomic_store(&virtual->m_streams[i].m_running, true);
+			set_port_state(portIter, ON);
+		}
+		else if(virtual->m_function[i] == RXSTREAM || virtual->m_function[i] == TXSTREAM)
+		{
+			atomic_store(&virtual->m_streams[i].m_running, true);
+			if(pthread_create(&virtual->m_streams[i].m_thread, NULL, stream_thread, &virtual->m_streams[i]) != 0)
+			{
+				atomic_store(&virtual->m_streams[i].m_running, false);
+				return NOMEMORY;
+			}
+			set_port_state(portIter, ON);
+		}
+		portIter = portIter->m_next;
+	}
+	return OK;
+}
+
+VirtualSdrError StopSdr(struct VirtualSdr* virtual)
+{
+	struct PortList* portIter = virtual->m_ports;
+	int iterator = 0;
+	while(portIter != NULL)
+	{
+		if(virtual->m_function[iterator] == RXSTREAM || virtual->m_function[iterator] == TXSTREAM)
+		{
+			stream_stop(&virtual->m_streams[iterator]);
+			set_port_state(portIter, OFF);
+		}
+		iterator++;
+		portIter = portIter->m_next;
+	}
+	
+	free(((struct AD9361*) virtual->m_RealSdr)->m_ctx);
+	
+	portIter = virtual->m_ports;
+	iterator = 0;
+	while(portIter != NULL)
+	{
+		if(virtual->m_function[iterator] == TXCONTINUOUSLY || virtual->m_function[iterator] == TXFILECONTINUOUSLY)
+		{
+			set_port_state(portIter, OFF);
+			free(((struct AD9361*) virtual->m_RealSdr)->m_rtxBuf[iterator]);
+		}
+		iterator++;
+		portIter = portIter->m_next;
+	}
+	free(((struct AD9361*) virtual->m_RealSdr)->m_rtxBuf);
+	
+	return OK;
+}
+
+VirtualSdrError ChargeConfig(struct VirtualSdr* virtual, struct SdrConfig* configuration)
+{
+	if(virtual == NULL || configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	
+	FreeVirtualSdr (virtual);
+	
+	virtual->m_connectionType = configuration->m_connectionType;
+	strcpy(virtual->m_location, configuration->m_location);
+	virtual->m_RxChannel = configuration->m_activeRxChannel;
+	virtual->m_TxChannel = configuration->m_activeTxChannel;
+	virtual->m_FS = configuration->m_FS;
+	
+	virtual->m_ports = NULL;
+	struct PortList * portIter = configuration->m_ports;
+	
+	int bufferNeeded = 0;
+	while(portIter != NULL && virtual->m_ports == NULL)
+	{
+		if((portIter->m_channel == virtual->m_RxChannel && portIter->m_type == RX)||(portIter->m_channel == virtual->m_TxChannel && portIter->m_type == TX))
+		{
+			virtual->m_ports = (struct PortList*) malloc(sizeof(struct PortList));
+			memcpy(virtual->m_ports,portIter,sizeof(struct PortList));
+			set_port_state(virtual->m_ports, OFF);
+			virtual->m_ports->m_next = NULL;
+			bufferNeeded++;
+		}
+		portIter = portIter->m_next;
+	}
+	
+	struct PortList * virtualPortIter = virtual->m_ports;
+	
+	while(portIter != NULL)
+	{
+		if((portIter->m_channel == virtual->m_RxChannel && portIter->m_type == RX)||(portIter->m_channel == virtual->m_TxChannel && portIter->m_type == TX))
+		{
+			virtualPortIter->m_next = (struct PortList*) malloc(sizeof(struct PortList));
+			memcpy(virtualPortIter->m_next ,portIter,sizeof(struct PortList));
+			virtualPortIter = virtualPortIter->m_next;
+			virtualPortIter->m_next = NULL;
+			set_port_state(virtualPortIter, OFF);
+			bufferNeeded++;
+		}
+		portIter = portIter->m_next;
+	}
+	
+	virtual->m_IList = (float**)malloc(bufferNeeded*sizeof(float*));
+	virtual->m_QList = (float**)malloc(bufferNeeded*sizeof(float*));
+	virtual->m_LengthBuffer = (int*)malloc(bufferNeeded*sizeof(int));
+	virtual->m_fileName = (char**)malloc(bufferNeeded*sizeof(char*));
+	virtual->m_function = (SdrFunction*)malloc(bufferNeeded*sizeof(SdrFunction));
+	virtual->m_streams = (struct SdrStream*)calloc(bufferNeeded, sizeof(struct SdrStream));
+	
+	for(int i = 0; i < bufferNeeded; i++)
 	{
 		virtual->m_IList[i] = NULL;
 		virtual->m_QList[i] = NULL;
 		virtual->m_LengthBuffer[i] = 0;
 		virtual->m_function[i] = NOFUNCTION;
-		virtual->m_fileName = NULL;
+		virtual->m_fileName[i] = NULL;
+		pthread_mutex_init(&virtual->m_streams[i].m_lock, NULL);
+		DefaultThreadOptions(&virtual->m_streams[i].m_options);
+		atomic_init(&virtual->m_streams[i].m_cpu, -1);
+	}
+	
+	return 1;
+}
+
+VirtualSdrError SetConnection(struct SdrConfig* configuration, SdrConnectionType type, char* location)
+{
+	if(location == NULL || configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(strlen(location) >= sizeof(configuration->m_location))
+	{
+		return INVALIDVALUE;
+	}
+	configuration->m_connectionType = type;
+	strcpy(configuration->m_location,location);
+	return OK;
+}
+
+VirtualSdrError GetConnection(struct SdrConfig* configuration, SdrConnectionType* type, char* location)
+{
+	if(location == NULL || type == NULL || configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	*type = configuration->m_connectionType;
+	strcpy(location,configuration->m_location);
+	return OK;
+}
+
+VirtualSdrError ChangeRxChannel(struct SdrConfig* configuration, SdrChannel channel)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	bool found = false;
+	struct ChannelList* iterator = configuration->m_channels;
+	while(!found && iterator != NULL)
+	{
+		if(iterator->m_type == RX && iterator->m_channel == channel)
+		{
+			found = true;
+		}
+		else
+		{
+			iterator = iterator->m_next;
+		}
+	}
+	if(!found)
+	{
+		return NOCHANNEL;
+	}
+	configuration->m_activeRxChannel = channel;
+	return OK;
+}
+
+VirtualSdrError GetRxChannel(struct SdrConfig* configuration, SdrChannel* buffer)
+{
+	if(configuration == NULL || buffer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	buffer = & configuration->m_activeRxChannel;
+	return OK;
+}
+
+VirtualSdrError ChangeTxChannel(struct SdrConfig* configuration, SdrChannel channel)
+{
+		if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	bool found = false;
+	struct ChannelList* iterator = configuration->m_channels;
+	while(!found && iterator != NULL)
+	{
+		if(iterator->m_type == TX && iterator->m_channel == channel)
+		{
+			found = true;
+		}
+		else
+		{
+			iterator = iterator->m_next;
+		}
+	}
+	if(!found)
+	{
+		return NOCHANNEL;
+	}
+	configuration->m_activeTxChannel = channel;
+	return OK;
+}
+
+VirtualSdrError GetTxChannel(struct SdrConfig* configuration, SdrChannel* buffer)
+{
+	if(configuration == NULL || buffer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	buffer = & configuration->m_activeTxChannel;
+	return OK;
+}
+
+VirtualSdrError SetRxFrec(struct SdrConfig* configuration, SdrPort port, long f)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeRxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+		struct ChannelList* iterChannelList = configuration->m_channels;
+	while (iterChannelList != NULL)
+	{
+		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		{
+			struct PortList * aux = configuration->m_ports;
+			while(aux != NULL)
+			{
+				if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+				{
+					if(f > iterChannelList->m_maxFrec)
+					{
+						aux->m_Frec = iterChannelList->m_maxFrec;
+						return VALUEAPROXMAX;
+					}
+					if(f < iterChannelList->m_minFrec)
+					{
+						aux->m_Frec = iterChannelList->m_minFrec;
+						return VALUEAPROXMIN;
+					}
+					aux->m_Frec = f;
+					return OK;
+				}
+				aux = aux->m_next;
+			}
+			return NOPORT;
+		}
+		iterChannelList = iterChannelList->m_next;
+	}
+	return CHANNELNOTDEFINED;
+}
+
+VirtualSdrError GetRxFrec(struct SdrConfig* configuration, SdrPort port, long* f)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeRxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct PortList * aux = configuration->m_ports;
+	while(aux != NULL)
+	{
+		if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+		{
+			f[0] = aux->m_Frec;
+			return OK;
+		}
+		aux = aux->m_next;
+	}
+	f[0] = -1;
+	return NOPORT;
+}
+
+VirtualSdrError SetTxFrec(struct SdrConfig* configuration, SdrPort port, long f)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeTxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct ChannelList* iterChannelList = configuration->m_channels;
+	while (iterChannelList != NULL)
+	{
+		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		{
+			struct PortList * aux = configuration->m_ports;
+			while(aux != NULL)
+			{
+				if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+				{
+					if(f > iterChannelList->m_maxFrec)
+					{
+						aux->m_Frec = iterChannelList->m_maxFrec;
+						return VALUEAPROXMAX;
+					}
+					if(f < iterChannelList->m_minFrec)
+					{
+						aux->m_Frec = iterChannelList->m_minFrec;
+						return VALUEAPROXMIN;
+					}
+					aux->m_Frec = f;
+					return OK;
+				}
+				aux = aux->m_next;
+			}
+			return NOPORT;
+		}
+		iterChannelList = iterChannelList->m_next;
+	}
+	return CHANNELNOTDEFINED;
+}
+
+VirtualSdrError GetTxFrec(struct SdrConfig* configuration, SdrPort port, long* f)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeTxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct PortList * aux = configuration->m_ports;
+	while(aux != NULL)
+	{
+		if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+		{
+			f[0] = aux->m_Frec;
+			return OK;
+		}
+		aux = aux->m_next;
+	}
+	f[0] = -1;
+	return NOPORT;
+}
+
+VirtualSdrError SetRxBw(struct SdrConfig* configuration, SdrPort port, int bw) 
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeRxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+		struct ChannelList* iterChannelList = configuration->m_channels;
+	while (iterChannelList != NULL)
+	{
+		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		{
+			struct PortList * aux = configuration->m_ports;
+			while(aux != NULL)
+			{
+				if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+				{
+					if(bw > iterChannelList->m_maxBw)
+					{
+						aux->m_Bw = iterChannelList->m_maxBw;
+						return VALUEAPROXMAX;
+					}
+					if(bw < iterChannelList->m_minBw)
+					{
+						aux->m_Bw = iterChannelList->m_minBw;
+						return VALUEAPROXMIN;
+					}
+					aux->m_Bw = bw;
+					return OK;
+				}
+				aux = aux->m_next;
+			}
+			return NOPORT;
+		}
+		iterChannelList = iterChannelList->m_next;
+	}
+	return CHANNELNOTDEFINED;
+}
+
+VirtualSdrError GetRxBw(struct SdrConfig* configuration, SdrPort port, int* bw)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeRxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct PortList * aux = configuration->m_ports;
+	while(aux != NULL)
+	{
+		if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+		{
+			bw[0] = aux->m_Bw;
+			return OK;
+		}
+		aux = aux->m_next;
+	}
+	bw[0] = -1;
+	return NOPORT;
+}
+
+VirtualSdrError SetTxBw(struct SdrConfig* configuration, SdrPort port, int bw)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeTxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct ChannelList* iterChannelList = configuration->m_channels;
+	while (iterChannelList != NULL)
+	{
+		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		{
+			struct PortList * aux = configuration->m_ports;
+			while(aux != NULL)
+			{
+				if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+				{
+					if(bw > iterChannelList->m_maxBw)
+					{
+						aux->m_Bw = iterChannelList->m_maxBw;
+						return VALUEAPROXMAX;
+					}
+					if(bw < iterChannelList->m_minBw)
+					{
+						aux->m_Bw = iterChannelList->m_minBw;
+						return VALUEAPROXMIN;
+					}
+					aux->m_Bw = bw;
+					return OK;
+				}
+				aux = aux->m_next;
+			}
+			return NOPORT;
+		}
+		iterChannelList = iterChannelList->m_next;
+	}
+	return CHANNELNOTDEFINED;
+}
+
+VirtualSdrError GetTxBw(struct SdrConfig* configuration, SdrPort port, int* bw)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeTxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct PortList * aux = configuration->m_ports;
+	while(aux != NULL)
+	{
+		if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+		{
+			bw[0] = aux->m_Bw;
+			return OK;
+		}
+		aux = aux->m_next;
+	}
+	bw[0] = -1;
+	return NOPORT;
+}
+VirtualSdrError SetGain(struct SdrConfig* configuration, SdrPort port, float* gain)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeRxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+		struct ChannelList* iterChannelList = configuration->m_channels;
+	while (iterChannelList != NULL)
+	{
+		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		{
+			struct PortList * aux = configuration->m_ports;
+			while(aux != NULL)
+			{
+				if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+				{
+					if(gain[0] > iterChannelList->m_maxAmp)
+					{
+						aux->m_Amp = iterChannelList->m_maxAmp;
+						return VALUEAPROXMAX;
+					}
+					if(gain[0] < iterChannelList->m_minAmp)
+					{
+						aux->m_Amp = iterChannelList->m_minAmp;
+						return VALUEAPROXMIN;
+					}
+					aux->m_Amp = gain[0];
+					return OK;
+				}
+				aux = aux->m_next;
+			}
+			return NOPORT;
+		}
+		iterChannelList = iterChannelList->m_next;
+	}
+	return CHANNELNOTDEFINED;
+}
+
+VirtualSdrError GetGain(struct SdrConfig* configuration, SdrPort port, float* gain)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeRxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct PortList * aux = configuration->m_ports;
+	while(aux != NULL)
+	{
+		if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+		{
+			gain[0] = aux->m_Amp;
+			return OK;
+		}
+		aux = aux->m_next;
+	}
+	gain[0] = -1;
+	return NOPORT;
+}
+
+VirtualSdrError SetAttenuation(struct SdrConfig* configuration, SdrPort port, float* Att)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeTxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+		struct ChannelList* iterChannelList = configuration->m_channels;
+	while (iterChannelList != NULL)
+	{
+		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		{
+			struct PortList * aux = configuration->m_ports;
+			while(aux != NULL)
+			{
+				if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+				{
+					if(Att[0] > iterChannelList->m_maxAmp)
+					{
+						aux->m_Amp = iterChannelList->m_maxAmp;
+						return VALUEAPROXMAX;
+					}
+					if(Att[0] < iterChannelList->m_minAmp)
+					{
+						aux->m_Amp = iterChannelList->m_minAmp;
+						return VALUEAPROXMIN;
+					}
+					aux->m_Amp = Att[0];
+					return OK;
+				}
+				aux = aux->m_next;
+			}
+			return NOPORT;
+		}
+		iterChannelList = iterChannelList->m_next;
+	}
+	return CHANNELNOTDEFINED;
+}
+ 
+VirtualSdrError GetAttenuation(struct SdrConfig* configuration, SdrPort port, float* Att)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_activeTxChannel == 0)
+	{
+		return CHANNELNOTDEFINED;
+	}
+	struct PortList * aux = configuration->m_ports;
+	while(aux != NULL)
+	{
+		if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+		{
+			Att[0] = aux->m_Amp;
+			return OK;
+		}
+		aux = aux->m_next;
+	}
+	Att[0] = -1;
+	return NOPORT;
+}
+
+VirtualSdrError SetFS(struct SdrConfig* configuration, int desiredValue)
+{
+	if(configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(configuration->m_minFS > desiredValue)
+	{
+		configuration->m_FS = configuration->m_minFS;
+		return VALUEAPROXMIN;
+	}
+	else
+	{
+		if(configuration->m_maxFS < desiredValue)
+		{
+			configuration->m_FS = configuration->m_maxFS;
+			return VALUEAPROXMAX;
+		}
+		else
+		{
+			configuration->m_FS = desiredValue;
+		}
+	}
+	return OK;
+}
+
+VirtualSdrError GetFS(struct SdrConfig* configuration, int* buffer)
+{
+	if(configuration == NULL || buffer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	buffer[0] = configuration->m_FS;
+	return OK;
+}
+
+VirtualSdrError TransmitOnce(struct VirtualSdr* virtual, SdrPort port, int len, float* I_tx, float*Q_tx)
+{
+	if(virtual == NULL || I_tx == NULL || Q_tx == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	while(portIter != NULL){
+		if(portIter->m_type == TX && portIter->m_port == port)
+		{
+			virtual->m_IList[iter] = I_tx;
+			virtual->m_QList[iter] = Q_tx;
+			virtual->m_LengthBuffer[iter] = len;
+			virtual->m_function[iter] = TXONLYONCE;
+			return OK;
+		}
+		iter++;
+		portIter = portIter->m_next;
+	}
+	return NOPORT;
+}
+
+VirtualSdrError TransmitAlways(struct VirtualSdr* virtual, SdrPort port, int len, float* I_tx, float* Q_tx)
+{
+	if(virtual == NULL || I_tx == NULL || Q_tx == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	while(portIter != NULL){
+		if(portIter->m_type == TX && portIter->m_port == port)
+		{
+			virtual->m_IList[iter] = I_tx;
+			virtual->m_QList[iter] = Q_tx;
+			virtual->m_LengthBuffer[iter] = len;
+			virtual->m_function[iter] = TXCONTINUOUSLY;
+			return OK;
+		}
+		iter++;
+		portIter = portIter->m_next;
+	}
+	return NOPORT;
+}
+
+VirtualSdrError Receive(struct VirtualSdr* virtual, SdrPort port, int len, float* I_rx, float* Q_rx)
+{
+	if(virtual == NULL || I_rx == NULL || Q_rx == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	while(portIter != NULL){
+		if(portIter->m_type == RX && portIter->m_port == port)
+		{
+			virtual->m_IList[iter] = I_rx;
+			virtual->m_QList[iter] = Q_rx;
+			virtual->m_LengthBuffer[iter] = len;
+			virtual->m_function[iter] = RXONLYONCE;
+			return OK;
+		}
+		iter++;
+		portIter = portIter->m_next;
+	}
+	return NOPORT;
+}
+
+VirtualSdrError ReceiveStream(struct VirtualSdr* virtual, SdrPort port, int len, SdrBlockCallback callback, void* data)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	int iter = find_port_index(virtual, RX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	virtual->m_LengthBuffer[iter] = len;
+	virtual->m_streams[iter].m_requestedLength = len;
+	virtual->m_function[iter] = RXSTREAM;
+	virtual->m_streams[iter].m_callback = callback;
+	virtual->m_streams[iter].m_data = data;
+	return OK;
+}
+
+VirtualSdrError TransmitStream(struct VirtualSdr* virtual, SdrPort port, int len)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	int iter = find_port_index(virtual, TX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	virtual->m_LengthBuffer[iter] = len;
+	virtual->m_streams[iter].m_requestedLength = len;
+	virtual->m_function[iter] = TXSTREAM;
+	return OK;
+}
+
+/*Adds a burst to the queue of a streaming TX port, sample 0 puts it after the last one with the gap of the port*/
+static VirtualSdrError queue_burst(struct VirtualSdr* virtual, SdrPort port, int len, float* I_tx, float* Q_tx, unsigned long long sample, bool timed)
+{
+	if(virtual == NULL || I_tx == NULL || Q_tx == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	int iter = find_port_index(virtual, TX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	struct SdrStream* stream = &virtual->m_streams[iter];
+	if(virtual->m_function[iter] != TXSTREAM || !atomic_load(&stream->m_running))
+	{
+		return NOTSTREAMING;
+	}
+	
+	VirtualSdrError error = OK;
+	pthread_mutex_lock(&stream->m_lock);
+	if(!timed)
+	{
+		sample = stream->m_burstCount > 0 ? stream->m_queueEnd + stream->m_burstGap : stream->m_filledSample;
+		if(sample < stream->m_filledSample)
+		{
+			sample = stream->m_filledSample;
+		}
+	}
+	if(stream->m_burstCount == BURSTQUEUESIZE)
+	{
+		error = PORTBUSY;
+	}
+	else if(sample < stream->m_filledSample || (stream->m_burstCount > 0 && sample < stream->m_queueEnd))
+	{
+		error = INVALIDVALUE;
+	}
+	else
+	{
+		struct SdrBurst* burst = &stream->m_bursts[(stream->m_burstHead + stream->m_burstCount)%BURSTQUEUESIZE];
+		burst->m_I = I_tx;
+		burst->m_Q = Q_tx;
+		burst->m_length = len;
+		burst->m_sample = sample;
+		stream->m_queueEnd = sample + len;
+		stream->m_burstCount++;
+	}
+	pthread_mutex_unlock(&stream->m_lock);
+	return error;
+}
+
+VirtualSdrError TransmitAt(struct VirtualSdr* virtual, SdrPort port, int len, float* I_tx, float* Q_tx, unsigned long long sample)
+{
+	return queue_burst(virtual, port, len, I_tx, Q_tx, sample, true);
+}
+
+VirtualSdrError QueueBurst(struct VirtualSdr* virtual, SdrPort port, int len, float* I_tx, float* Q_tx)
+{
+	return queue_burst(virtual, port, len, I_tx, Q_tx, 0, false);
+}
+
+VirtualSdrError SetBurstGap(struct VirtualSdr* virtual, SdrPort port, int gap)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(gap < 0)
+	{
+		return INVALIDVALUE;
+	}
+	int iter = find_port_index(virtual, TX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	pthread_mutex_lock(&virtual->m_streams[iter].m_lock);
+	virtual->m_streams[iter].m_burstGap = gap;
+	pthread_mutex_unlock(&virtual->m_streams[iter].m_lock);
+	return OK;
+}
+
+VirtualSdrError SetBurstCallback(struct VirtualSdr* virtual, SdrPort port, SdrBurstCallback callback, void* data)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, TX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	virtual->m_streams[iter].m_burstCallback = callback;
+	virtual->m_streams[iter].m_burstData = data;
+	return OK;
+}
+
+VirtualSdrError GetBurstQueue(struct VirtualSdr* virtual, SdrPort port, int* pending)
+{
+	if(virtual == NULL || pending == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, TX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	pthread_mutex_lock(&virtual->m_streams[iter].m_lock);
+	*pending = virtual->m_streams[iter].m_burstCount;
+	pthread_mutex_unlock(&virtual->m_streams[iter].m_lock);
+	return OK;
+}
+
+VirtualSdrError SetPortPolled(struct VirtualSdr* virtual, SdrPort port, ChannelType type, int polled)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	virtual->m_streams[iter].m_polled = polled != 0;
+	return OK;
+}
+
+/*Finds a streaming port driven by the user which is running*/
+static struct SdrStream* find_polled_stream(struct VirtualSdr* virtual, SdrPort port, ChannelType type)
+{
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0 || !virtual->m_streams[iter].m_polled || !atomic_load(&virtual->m_streams[iter].m_running))
+	{
+		return NULL;
+	}
+	return &virtual->m_streams[iter];
+}
+
+VirtualSdrError GetPortPollFd(struct VirtualSdr* virtual, SdrPort port, ChannelType type, int* fd)
+{
+	if(virtual == NULL || fd == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct SdrStream* stream = find_polled_stream(virtual, port, type);
+	if(stream == NULL)
+	{
+		return NOTSTREAMING;
+	}
+	*fd = stream->m_buffer != NULL ? iio_buffer_get_poll_fd(stream->m_buffer) : -1;
+	if(*fd < 0)
+	{
+		return NOTIMPLEMENTED;
+	}
+	return OK;
+}
+
+/*Moves a block of a port driven by the user without blocking, PORTBUSY if the device isn't ready*/
+static VirtualSdrError stream_service(struct SdrStream* stream)
+{
+	ssize_t res = stream->m_type == RX ? stream_rx_step(stream) : stream_tx_step(stream);
+	if(res == -EAGAIN)
+	{
+		return PORTBUSY;
+	}
+	if(res == -ENODATA)
+	{
+		atomic_store(&stream->m_running, false);
+		return NOTSTREAMING;
+	}
+	if(res < 0)
+	{
+		stream_account_error(stream, res);
+		return BUFFERERROR;
+	}
+	return OK;
+}
+
+VirtualSdrError ServicePort(struct VirtualSdr* virtual, SdrPort port, ChannelType type)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct SdrStream* stream = find_polled_stream(virtual, port, type);
+	if(stream == NULL)
+	{
+		return NOTSTREAMING;
+	}
+	return stream_service(stream);
+}
+
+VirtualSdrError DefaultThreadOptions(struct SdrThreadOptions* options)
+{
+	if(options == NULL)
+	{
+		return NULLPOINTER;
+	}
+	options->m_cpu = -1;
+	options->m_priority = 0;
+	return OK;
+}
+
+VirtualSdrError SetThreadOptions(struct VirtualSdr* virtual, SdrPort port, ChannelType type, struct SdrThreadOptions* options)
+{
+	if(virtual == NULL || options == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(options->m_cpu >= CPU_SETSIZE || options->m_priority < 0 || options->m_priority > sched_get_priority_max(SCHED_FIFO))
+	{
+		return INVALIDVALUE;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	virtual->m_streams[iter].m_options = *options;
+	return OK;
+}
+
+VirtualSdrError DefaultBuffering(struct SdrBuffering* buffering)
+{
+	if(buffering == NULL)
+	{
+		return NULLPOINTER;
+	}
+	buffering->m_blockLength = 0;
+	buffering->m_kernelBuffers = 0;
+	buffering->m_latency = 0;
+	return OK;
+}
+
+VirtualSdrError SetBuffering(struct VirtualSdr* virtual, SdrPort port, ChannelType type, struct SdrBuffering* buffering)
+{
+	if(virtual == NULL || buffering == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(buffering->m_blockLength < 0 || buffering->m_kernelBuffers < 0 || buffering->m_kernelBuffers > BUFFERINGMAXKERNEL || buffering->m_latency < 0)
+	{
+		return INVALIDVALUE;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	virtual->m_streams[iter].m_buffering = *buffering;
+	return OK;
+}
+
+VirtualSdrError GetBuffering(struct VirtualSdr* virtual, SdrPort port, ChannelType type, int* blockLength, int* kernelBuffers)
+{
+	if(virtual == NULL || blockLength == NULL || kernelBuffers == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	struct SdrStream* stream = &virtual->m_streams[iter];
+	if(stream->m_buffer != NULL || (virtual->m_function[iter] != RXSTREAM && virtual->m_function[iter] != TXSTREAM))
+	{
+		*blockLength = virtual->m_LengthBuffer[iter];
+		*kernelBuffers = stream->m_kernelBuffers;
+	}
+	else
+	{
+		resolve_buffering(&stream->m_buffering, virtual->m_FS, stream->m_requestedLength, blockLength, kernelBuffers);
+	}
+	return OK;
+}
+
+VirtualSdrError GetPortTime(struct VirtualSdr* virtual, SdrPort port, ChannelType type, unsigned long long* sample, unsigned long long* time)
+{
+	if(virtual == NULL || sample == NULL || time == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	pthread_mutex_lock(&virtual->m_streams[iter].m_lock);
+	*sample = virtual->m_streams[iter].m_sample;
+	*time = virtual->m_streams[iter].m_time;
+	pthread_mutex_unlock(&virtual->m_streams[iter].m_lock);
+	return OK;
+}
+
+/*Appends a stage to the list of a port*/
+static VirtualSdrError stream_add_stage(struct VirtualSdr* virtual, ChannelType type, SdrPort port, SdrBlockCallback process, void* data)
+{
+	if(virtual == NULL || process == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	struct StageList* stage = (struct StageList*) malloc(sizeof(struct StageList));
+	if(stage == NULL)
+	{
+		return NOMEMORY;
+	}
+	stage->m_process = process;
+	stage->m_data = data;
+	stage->m_next = NULL;
+	
+	struct StageList** iterStage = &virtual->m_streams[iter].m_stages;
+	while(*iterStage != NULL)
+	{
+		iterStage = &(*iterStage)->m_next;
+	}
+	*iterStage = stage;
+	return OK;
+}
+
+/*Removes a stage from the list of a port, which can't be streaming because its thread walks the list without a lock*/
+static VirtualSdrError stream_remove_stage(struct VirtualSdr* virtual, ChannelType type, SdrPort port, SdrBlockCallback process, void* data)
+{
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	if(atomic_load(&virtual->m_streams[iter].m_running))
+	{
+		return PORTBUSY;
+	}
+	struct StageList** iterStage = &virtual->m_streams[iter].m_stages;
+	while(*iterStage != NULL && ((*iterStage)->m_process != process || (*iterStage)->m_data != data))
+	{
+		iterStage = &(*iterStage)->m_next;
+	}
+	if(*iterStage == NULL)
+	{
+		return NOPORT;
+	}
+	struct StageList* stage = *iterStage;
+	*iterStage = stage->m_next;
+	free(stage);
+	return OK;
+}
+
+VirtualSdrError AddRxStage(struct VirtualSdr* virtual, SdrPort port, SdrBlockCallback process, void* data)
+{
+	return stream_add_stage(virtual, RX, port, process, data);
+}
+
+VirtualSdrError AddTxStage(struct VirtualSdr* virtual, SdrPort port, SdrBlockCallback process, void* data)
+{
+	return stream_add_stage(virtual, TX, port, process, data);
+}
+
+VirtualSdrError GetPortStatus(struct VirtualSdr* virtual, SdrPort port, ChannelType type, struct SdrPortStatus* status)
+{
+	if(virtual == NULL || status == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	stream_status(&virtual->m_streams[iter], status);
+	return OK;
+}
+
+VirtualSdrError SetXflowCallback(struct VirtualSdr* virtual, SdrPort port, ChannelType type, SdrXflowCallback callback, void* data)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, type, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	virtual->m_streams[iter].m_xflowCallback = callback;
+	virtual->m_streams[iter].m_xflowData = data;
+	return OK;
+}
+
+/*
+	Signal statistics of a port. signal_measure sums a block in four lanes so the loop is vectorized without
+	reordering a single sum, the trigger also uses it for the energy of its windows. A sample is near the full scale when I or Q reaches SIGNALCLIP of the 12 bit range.
+*/
+#define SIGNALCLIP (2040.0f/2047.0f)
+
+struct SignalMeasure{
+	double m_sumI;
+	double m_sumQ;
+	double m_power;
+	float m_peak;
+	int m_clipped;
+};
+
+static void signal_measure(struct SdrBlock* block, struct SignalMeasure* measure)
+{
+	double sumI[4] = {0, 0, 0, 0};
+	double sumQ[4] = {0, 0, 0, 0};
+	double power[4] = {0, 0, 0, 0};
+	float peak[4] = {0, 0, 0, 0};
+	int clipped[4] = {0, 0, 0, 0};
+	int len = block->m_length;
+	
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		for(int k = 0; k < 4; k++)
+		{
+			float x = block->m_I[i+k];
+			float y = block->m_Q[i+k];
+			float p = x*x + y*y;
+			sumI[k] += x;
+			sumQ[k] += y;
+			power[k] += p;
+			peak[k] = p > peak[k] ? p : peak[k];
+			clipped[k] += (fabsf(x) >= SIGNALCLIP) | (fabsf(y) >= SIGNALCLIP);
+		}
+	}
+	for(; i < len; i++)
+	{
+		float x = block->m_I[i];
+		float y = block->m_Q[i];
+		float p = x*x + y*y;
+		sumI[0] += x;
+		sumQ[0] += y;
+		power[0] += p;
+		peak[0] = p > peak[0] ? p : peak[0];
+		clipped[0] += (fabsf(x) >= SIGNALCLIP) | (fabsf(y) >= SIGNALCLIP);
+	}
+	for(int k = 1; k < 4; k++)
+	{
+		sumI[0] += sumI[k];
+		sumQ[0] += sumQ[k];
+		power[0] += power[k];
+		peak[0] = peak[k] > peak[0] ? peak[k] : peak[0];
+		clipped[0] += clipped[k];
+	}
+	measure->m_sumI = sumI[0];
+	measure->m_sumQ = sumQ[0];
+	measure->m_power = power[0];
+	measure->m_peak = peak[0];
+	measure->m_clipped = clipped[0];
+}
+
+static void signal_stage(struct SdrBlock* block, void* data)
+{
+	struct SdrStream* stream = (struct SdrStream*) data;
+	struct SignalMeasure measure;
+	int len = block->m_length;
+	if(len <= 0)
+	{
+		return;
+	}
+	signal_measure(block, &measure);
+	
+	float rms = 10*log10f(measure.m_power/len + 1e-20f);
+	float peakDb = 10*log10f(measure.m_peak + 1e-20f);
+	pthread_mutex_lock(&stream->m_lock);
+	struct SdrSignalStats* stats = &stream->m_signal;
+	stats->m_dcI = measure.m_sumI/len;
+	stats->m_dcQ = measure.m_sumQ/len;
+	stats->m_rms = rms;
+	stats->m_peak = peakDb;
+	stats->m_crest = peakDb - rms;
+	stats->m_clipped = measure.m_clipped;
+	stats->m_maxPeak = stats->m_blocks == 0 || peakDb > stats->m_maxPeak ? peakDb : stats->m_maxPeak;
+	stats->m_blocks++;
+	stats->m_totalClipped += measure.m_clipped;
+	pthread_mutex_unlock(&stream->m_lock);
+}
+
+VirtualSdrError EnableSignalStats(struct VirtualSdr* virtual, SdrPort port)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, RX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	struct SdrStream* stream = &virtual->m_streams[iter];
+	if(stream->m_signalEnabled)
+	{
+		return OK;
+	}
+	VirtualSdrError error = AddRxStage(virtual, port, signal_stage, stream);
+	if(error == OK)
+	{
+		pthread_mutex_lock(&stream->m_lock);
+		memset(&stream->m_signal, 0, sizeof(struct SdrSignalStats));
+		stream->m_signalEnabled = true;
+		pthread_mutex_unlock(&stream->m_lock);
+	}
+	return error;
+}
+
+VirtualSdrError GetSignalStats(struct VirtualSdr* virtual, SdrPort port, struct SdrSignalStats* stats)
+{
+	if(virtual == NULL || stats == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int iter = find_port_index(virtual, RX, port);
+	if(iter < 0)
+	{
+		return NOPORT;
+	}
+	struct SdrStream* stream = &virtual->m_streams[iter];
+	if(!stream->m_signalEnabled)
+	{
+		return NOTSTREAMING;
+	}
+	pthread_mutex_lock(&stream->m_lock);
+	*stats = stream->m_signal;
+	pthread_mutex_unlock(&stream->m_lock);
+	return OK;
+}
+
+/*
+	Software AGC of a receiving port. It averages the power of m_average blocks and writes the hardwaregain when
+	the level leaves the hysteresis around the target, rounded to 1dB so a change of less than a step doesn't
+	write anything. The blocks already waiting in the kernel were received with the old gain, so after a change
+	the measures are ignored until the first sample which is sure to have the new one. A block near the full
+	scale lowers the gain at once without waiting for the average. Every start of the port has a new context
+	and configures the gain mode again, so the channel, the mode and the gain are read again from the phy.
+*/
+struct SdrAgc{
+	struct AgcOptions m_options;
+	SdrGainCallback m_callback;
+	void* m_data;
+	pthread_mutex_t m_lock;
+	
+	/*Port controlled, set by AttachAgc and cleared by DetachAgc*/
+	struct VirtualSdr* m_virtual;
+	struct SdrStream* m_stream;
+	SdrPort m_port;
+	
+	/*Only used by the thread of the port, the channel and the mode are the ones of the start m_starts*/
+	int m_starts;
+	bool m_manual;
+	struct iio_channel* m_channel;
+	double m_power;
+	long long m_samples;
+	int m_blocks;
+	unsigned long long m_settled;
+	
+	/*State, protected by m_lock*/
+	float m_gain;
+	float m_level;
+	unsigned long long m_changes;
+	unsigned long long m_writes;
+	unsigned long long m_errors;
+};
+
+/*Writes the gain to the phy of the port, a replay has no device and only keeps the gain*/
+static bool agc_write(struct SdrAgc* agc, float gain)
+{
+	struct AD9361* real = (struct AD9361*) agc->m_virtual->m_RealSdr;
+	if(real == NULL || real->m_ctx == NULL)
+	{
+		return true;
+	}
+	if(agc->m_channel == NULL)
+	{
+		return false;
+	}
+	METRIC_BEGIN(begin);
+	bool done = true;
+	if(!agc->m_manual)
+	{
+		done = iio_channel_attr_write(agc->m_channel, "gain_control_mode", "manual") >= 0;
+		agc->m_manual = done;
+	}
+	done = done && iio_channel_attr_write_double(agc->m_channel, "hardwaregain", gain) >= 0;
+	METRIC_END(METRICATTRIBUTE, begin, 0);
+	return done;
+}
+
+/*Takes the channel, the gain mode and the gain of a new start of the port, a replay keeps the gain it had*/
+static void agc_sync(struct SdrAgc* agc)
+{
+	struct AD9361* real = (struct AD9361*) agc->m_virtual->m_RealSdr;
+	struct PortList* rxPort = find_port(agc->m_virtual, RX, agc->m_port);
+	agc->m_starts = agc->m_stream->m_starts;
+	agc->m_manual = rxPort != NULL && rxPort->m_Amp >= 0;
+	agc->m_channel = NULL;
+	agc->m_settled = 0;
+	agc->m_power = 0;
+	agc->m_samples = 0;
+	agc->m_blocks = 0;
+	char auxStr[64];
+	if(real == NULL || real->m_ctx == NULL || !get_phy_chan(RX, agc->m_port - 1, &agc->m_channel, auxStr, real->m_ctx))
+	{
+		return;
+	}
+	char mode[32];
+	if(iio_channel_attr_read(agc->m_channel, "gain_control_mode", mode, sizeof(mode)) > 0)
+	{
+		agc->m_manual = strncmp(mode, "manual", strlen("manual")) == 0;
+	}
+	double gain;
+	if(iio_channel_attr_read_double(agc->m_channel, "hardwaregain", &gain) == 0)
+	{
+		pthread_mutex_lock(&agc->m_lock);
+		agc->m_gain = roundf(gain);
+		pthread_mutex_unlock(&agc->m_lock);
+	}
+}
+
+static void agc_stage(struct SdrBlock* block, void* data)
+{
+	struct SdrAgc* agc = (struct SdrAgc*) data;
+	struct SdrStream* stream = agc->m_stream;
+	if(agc->m_starts != stream->m_starts)
+	{
+		agc_sync(agc);
+	}
+	if(block->m_length <= 0 || block->m_sample < agc->m_settled)
+	{
+		return;
+	}
+	struct SignalMeasure measure;
+	signal_measure(block, &measure);
+	agc->m_power += measure.m_power;
+	agc->m_samples += block->m_length;
+	agc->m_blocks++;
+	if(measure.m_clipped == 0 && agc->m_blocks < agc->m_options.m_average)
+	{
+		return;
+	}
+	
+	float level = 10*log10f(agc->m_power/agc->m_samples + 1e-20f);
+	agc->m_power = 0;
+	agc->m_samples = 0;
+	agc->m_blocks = 0;
+	pthread_mutex_lock(&agc->m_lock);
+	agc->m_level = level;
+	float previous = agc->m_gain;
+	pthread_mutex_unlock(&agc->m_lock);
+	
+	float step = agc->m_options.m_target - level;
+	if(measure.m_clipped > 0)
+	{
+		step = -agc->m_options.m_maxStep;
+	}
+	else if(fabsf(step) <= agc->m_options.m_hysteresis)
+	{
+		return;
+	}
+	step = step > agc->m_options.m_maxStep ? agc->m_options.m_maxStep : step;
+	step = step < -agc->m_options.m_maxStep ? -agc->m_options.m_maxStep : step;
+	float gain = roundf(previous + step);
+	gain = gain > agc->m_options.m_maxGain ? agc->m_options.m_maxGain : gain;
+	gain = gain < agc->m_options.m_minGain ? agc->m_options.m_minGain : gain;
+	if(gain == previous)
+	{
+		return;
+	}
+	
+	bool written = agc_write(agc, gain);
+	pthread_mutex_lock(&agc->m_lock);
+	agc->m_writes++;
+	if(!written)
+	{
+		agc->m_errors++;
+		pthread_mutex_unlock(&agc->m_lock);
+		return;
+	}
+	agc->m_gain = gain;
+	agc->m_changes++;
+	pthread_mutex_unlock(&agc->m_lock);
+	
+	/*The next block may have the new gain, the ones already in the kernel buffers may not*/
+	int kernelBuffers = stream->m_kernelBuffers > 0 ? stream->m_kernelBuffers : BUFFERINGKERNELDEFAULT;
+	struct SdrGainChange change;
+	change.m_sample = block->m_sample + block->m_length;
+	change.m_settled = change.m_sample + (unsigned long long) kernelBuffers*stream->m_length;
+	change.m_previous = previous;
+	change.m_gain = gain;
+	agc->m_settled = change.m_settled;
+	if(agc->m_callback != NULL)
+	{
+		agc->m_callback(agc->m_port, &change, agc->m_data);
+	}
+}
+
+VirtualSdrError DefaultAgcOptions(struct AgcOptions* options)
+{
+	if(options == NULL)
+	{
+		return NULLPOINTER;
+	}
+	options->m_target = -20;
+	options->m_hysteresis = 3;
+	options->m_minGain = 0;
+	options->m_maxGain = 71;
+	options->m_maxStep = 6;
+	options->m_average = 4;
+	return OK;
+}
+
+VirtualSdrError CreateAgc(struct SdrAgc** agc, struct AgcOptions* options, SdrGainCallback callback, void* data)
+{
+	if(agc == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct AgcOptions defaults;
+	if(options == NULL)
+	{
+		DefaultAgcOptions(&defaults);
+		options = &defaults;
+	}
+	if(options->m_hysteresis < 0 || options->m_maxStep < 1 || options->m_minGain > options->m_maxGain || options->m_average <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	struct SdrAgc* aux = (struct SdrAgc*) calloc(1, sizeof(struct SdrAgc));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	aux->m_options = *options;
+	aux->m_callback = callback;
+	aux->m_data = data;
+	aux->m_gain = roundf((options->m_minGain + options->m_maxGain)/2);
+	pthread_mutex_init(&aux->m_lock, NULL);
+	*agc = aux;
+	return OK;
+}
+
+VirtualSdrError AttachAgc(struct VirtualSdr* virtual, SdrPort port, struct SdrAgc* agc)
+{
+	if(agc == NULL || virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(agc->m_virtual != NULL)
+	{
+		return PORTBUSY;
+	}
+	int iter = find_port_index(virtual, RX, port);
+	struct PortList* rxPort = find_port(virtual, RX, port);
+	if(iter < 0 || rxPort == NULL)
+	{
+		return NOPORT;
+	}
+	VirtualSdrError error = AddRxStage(virtual, port, agc_stage, agc);
+	if(error != OK)
+	{
+		return error;
+	}
+	agc->m_virtual = virtual;
+	agc->m_stream = &virtual->m_streams[iter];
+	agc->m_port = port;
+	agc->m_starts = -1;
+	if(rxPort->m_Amp >= 0)
+	{
+		agc->m_gain = rxPort->m_Amp;
+	}
+	return OK;
+}
+
+VirtualSdrError DetachAgc(struct SdrAgc* agc)
+{
+	if(agc == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(agc->m_virtual == NULL)
+	{
+		return OK;
+	}
+	VirtualSdrError error = stream_remove_stage(agc->m_virtual, RX, agc->m_port, agc_stage, agc);
+	if(error != OK && error != NOPORT)
+	{
+		return error;
+	}
+	agc->m_virtual = NULL;
+	agc->m_stream = NULL;
+	return OK;
+}
+
+VirtualSdrError GetAgcStatus(struct SdrAgc* agc, struct AgcStatus* status)
+{
+	if(agc == NULL || status == NULL)
+	{
+		return NULLPOINTER;
+	}
+	pthread_mutex_lock(&agc->m_lock);
+	status->m_gain = agc->m_gain;
+	status->m_level = agc->m_level;
+	status->m_changes = agc->m_changes;
+	status->m_writes = agc->m_writes;
+	status->m_errors = agc->m_errors;
+	pthread_mutex_unlock(&agc->m_lock);
+	return OK;
+}
+
+void FreeAgc(struct SdrAgc* agc)
+{
+	if(agc != NULL)
+	{
+		DetachAgc(agc);
+		pthread_mutex_destroy(&agc->m_lock);
+		free(agc);
+	}
+}
+
+/*
+	Correction of the DC offset and the I/Q imbalance. The imbalance is modelled as I = x + dcI and
+	Q = g*(cos(p)*y + sin(p)*x) + dcQ, so the signal is x = I - dcI and y = ((Q - dcQ)/g - sin(p)*x)/cos(p).
+	Predistorting a TX block with the same formula gives the wanted signal after the imbalance of the port.
+	A receiving port measures the moments of the raw samples in the same pass that corrects them and moves
+	the coefficients towards the ones of the block, so the correction of a block uses the previous estimate.
+*/
+#define IQMAXSIN 0.70710678
+
+struct SdrIqCorrection{
+	struct IqCorrectionOptions m_options;
+	pthread_mutex_t m_lock;
+	bool m_track;
+	
+	/*Port corrected, set by AttachIqCorrection and cleared by DetachIqCorrection*/
+	struct VirtualSdr* m_virtual;
+	SdrPort m_port;
+	ChannelType m_type;
+	
+	/*Imbalance with linear gain and sine of the phase, protected by m_lock*/
+	float m_dcI;
+	float m_dcQ;
+	float m_gain;
+	float m_sin;
+};
+
+/*Sums of the raw samples of a block*/
+struct IqMoments{
+	double m_sumI;
+	double m_sumQ;
+	double m_sumII;
+	double m_sumQQ;
+	double m_sumIQ;
+};
+
+/*Corrects a block in place and sums its raw samples, the output is limited to +-limit*/
+static void iq_correct(struct SdrBlock* block, float dcI, float dcQ, float c1, float c2, float limit, struct IqMoments* moments)
+{
+	double sumI[4] = {0, 0, 0, 0};
+	double sumQ[4] = {0, 0, 0, 0};
+	double sumII[4] = {0, 0, 0, 0};
+	double sumQQ[4] = {0, 0, 0, 0};
+	double sumIQ[4] = {0, 0, 0, 0};
+	int len = block->m_length;
+	
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		for(int k = 0; k < 4; k++)
+		{
+			float x = block->m_I[i+k];
+			float y = block->m_Q[i+k];
+			sumI[k] += x;
+			sumQ[k] += y;
+			sumII[k] += x*x;
+			sumQQ[k] += y*y;
+			sumIQ[k] += x*y;
+			x -= dcI;
+			y = c1*x + c2*(y - dcQ);
+			block->m_I[i+k] = x > limit ? limit : (x < -limit ? -limit : x);
+			block->m_Q[i+k] = y > limit ? limit : (y < -limit ? -limit : y);
+		}
+	}
+	for(; i < len; i++)
+	{
+		float x = block->m_I[i];
+		float y = block->m_Q[i];
+		sumI[0] += x;
+		sumQ[0] += y;
+		sumII[0] += x*x;
+		sumQQ[0] += y*y;
+		sumIQ[0] += x*y;
+		x -= dcI;
+		y = c1*x + c2*(y - dcQ);
+		block->m_I[i] = x > limit ? limit : (x < -limit ? -limit : x);
+		block->m_Q[i] = y > limit ? limit : (y < -limit ? -limit : y);
+	}
+	for(int k = 1; k < 4; k++)
+	{
+		sumI[0] += sumI[k];
+		sumQ[0] += sumQ[k];
+		sumII[0] += sumII[k];
+		sumQQ[0] += sumQQ[k];
+		sumIQ[0] += sumIQ[k];
+	}
+	moments->m_sumI = sumI[0];
+	moments->m_sumQ = sumQ[0];
+	moments->m_sumII = sumII[0];
+	moments->m_sumQQ = sumQQ[0];
+	moments->m_sumIQ = sumIQ[0];
+}
+
+/*Moves the estimate towards the imbalance of a block of len raw samples*/
+static void iq_track(struct SdrIqCorrection* correction, struct IqMoments* moments, int len)
+{
+	float rate = correction->m_options.m_rate;
+	double meanI = moments->m_sumI/len;
+	double meanQ = moments->m_sumQ/len;
+	double varI = moments->m_sumII/len - meanI*meanI;
+	double varQ = moments->m_sumQQ/len - meanQ*meanQ;
+	double cov = moments->m_sumIQ/len - meanI*meanQ;
+	
+	pthread_mutex_lock(&correction->m_lock);
+	if(correction->m_options.m_dc)
+	{
+		correction->m_dcI += rate*(meanI - correction->m_dcI);
+		correction->m_dcQ += rate*(meanQ - correction->m_dcQ);
+	}
+	if(correction->m_options.m_imbalance && varI > 1e-12 && varQ > 1e-12)
+	{
+		double sine = cov/sqrt(varI*varQ);
+		sine = sine > IQMAXSIN ? IQMAXSIN : (sine < -IQMAXSIN ? -IQMAXSIN : sine);
+		correction->m_gain += rate*(sqrt(varQ/varI) - correction->m_gain);
+		correction->m_sin += rate*(sine - correction->m_sin);
+	}
+	pthread_mutex_unlock(&correction->m_lock);
+}
+
+static void iq_stage(struct SdrBlock* block, void* data)
+{
+	struct SdrIqCorrection* correction = (struct SdrIqCorrection*) data;
+	if(block->m_length <= 0)
+	{
+		return;
+	}
+	pthread_mutex_lock(&correction->m_lock);
+	float dcI = correction->m_dcI;
+	float dcQ = correction->m_dcQ;
+	float cosine = sqrtf(1 - correction->m_sin*correction->m_sin);
+	float c1 = -correction->m_sin/cosine;
+	float c2 = 1/(correction->m_gain*cosine);
+	pthread_mutex_unlock(&correction->m_lock);
+	
+	struct IqMoments moments;
+	iq_correct(block, dcI, dcQ, c1, c2, correction->m_track ? INFINITY : 1.0f, &moments);
+	if(correction->m_track)
+	{
+		iq_track(correction, &moments, block->m_length);
+	}
+}
+
+VirtualSdrError DefaultIqCorrectionOptions(struct IqCorrectionOptions* options)
+{
+	if(options == NULL)
+	{
+		return NULLPOINTER;
+	}
+	options->m_rate = 0.05f;
+	options->m_dc = 1;
+	options->m_imbalance = 1;
+	return OK;
+}
+
+VirtualSdrError CreateIqCorrection(struct SdrIqCorrection** correction, struct IqCorrectionOptions* options)
+{
+	if(correction == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct IqCorrectionOptions defaults;
+	if(options == NULL)
+	{
+		DefaultIqCorrectionOptions(&defaults);
+		options = &defaults;
+	}
+	if(options->m_rate <= 0 || options->m_rate > 1)
+	{
+		return INVALIDVALUE;
+	}
+	struct SdrIqCorrection* aux = (struct SdrIqCorrection*) calloc(1, sizeof(struct SdrIqCorrection));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	aux->m_options = *options;
+	aux->m_gain = 1;
+	pthread_mutex_init(&aux->m_lock, NULL);
+	*correction = aux;
+	return OK;
+}
+
+VirtualSdrError AttachIqCorrection(struct VirtualSdr* virtual, SdrPort port, ChannelType type, struct SdrIqCorrection* correction)
+{
+	if(virtual == NULL || correction == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(correction->m_virtual != NULL)
+	{
+		return PORTBUSY;
+	}
+	VirtualSdrError error = type == RX ? AddRxStage(virtual, port, iq_stage, correction) : AddTxStage(virtual, port, iq_stage, correction);
+	if(error != OK)
+	{
+		return error;
+	}
+	correction->m_track = type == RX;
+	correction->m_virtual = virtual;
+	correction->m_port = port;
+	correction->m_type = type;
+	return OK;
+}
+
+VirtualSdrError DetachIqCorrection(struct SdrIqCorrection* correction)
+{
+	if(correction == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(correction->m_virtual == NULL)
+	{
+		return OK;
+	}
+	VirtualSdrError error = stream_remove_stage(correction->m_virtual, correction->m_type, correction->m_port, iq_stage, correction);
+	if(error != OK && error != NOPORT)
+	{
+		return error;
+	}
+	correction->m_virtual = NULL;
+	return OK;
+}
+
+VirtualSdrError SetIqCoefficients(struct SdrIqCorrection* correction, struct SdrIqCoefficients* coefficients)
+{
+	if(correction == NULL || coefficients == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(fabsf(coefficients->m_phase) > 45)
+	{
+		return INVALIDVALUE;
+	}
+	pthread_mutex_lock(&correction->m_lock);
+	correction->m_dcI = coefficients->m_dcI;
+	correction->m_dcQ = coefficients->m_dcQ;
+	correction->m_gain = powf(10, coefficients->m_gain/20);
+	correction->m_sin = sinf(coefficients->m_phase*M_PI/180);
+	pthread_mutex_unlock(&correction->m_lock);
+	return OK;
+}
+
+VirtualSdrError GetIqCoefficients(struct SdrIqCorrection* correction, struct SdrIqCoefficients* coefficients)
+{
+	if(correction == NULL || coefficients == NULL)
+	{
+		return NULLPOINTER;
+	}
+	pthread_mutex_lock(&correction->m_lock);
+	coefficients->m_dcI = correction->m_dcI;
+	coefficients->m_dcQ = correction->m_dcQ;
+	coefficients->m_gain = 20*log10f(correction->m_gain);
+	coefficients->m_phase = asinf(correction->m_sin)*180/M_PI;
+	pthread_mutex_unlock(&correction->m_lock);
+	return OK;
+}
+
+void FreeIqCorrection(struct SdrIqCorrection* correction)
+{
+	if(correction != NULL)
+	{
+		DetachIqCorrection(correction);
+		pthread_mutex_destroy(&correction->m_lock);
+		free(correction);
+	}
+}
+
+#define REACTOREVENTS 64
+
+struct SdrReactor{
+	int m_epoll;
+};
+
+VirtualSdrError CreateReactor(struct SdrReactor** reactor)
+{
+	if(reactor == NULL)
+	{
+		return NULLPOINTER;
+	}
+	*reactor = (struct SdrReactor*) malloc(sizeof(struct SdrReactor));
+	if(*reactor == NULL)
+	{
+		return NOMEMORY;
+	}
+	(*reactor)->m_epoll = epoll_create1(EPOLL_CLOEXEC);
+	if((*reactor)->m_epoll < 0)
+	{
+		free(*reactor);
+		*reactor = NULL;
+		return NOMEMORY;
+	}
+	return OK;
+}
+
+/*Takes out of the reactor the ports added of the first count ones of a Virtual SDR*/
+static void reactor_remove(struct SdrReactor* reactor, struct VirtualSdr* virtual, int count)
+{
+	for(int iter = 0; iter < count; iter++)
+	{
+		struct SdrStream* stream = &virtual->m_streams[iter];
+		if(stream->m_polled && atomic_load(&stream->m_running) && stream->m_buffer != NULL)
+		{
+			int fd = iio_buffer_get_poll_fd(stream->m_buffer);
+			if(fd >= 0)
+			{
+				epoll_ctl(reactor->m_epoll, EPOLL_CTL_DEL, fd, NULL);
+			}
+		}
+	}
+}
+
+VirtualSdrError ReactorAdd(struct SdrReactor* reactor, struct VirtualSdr* virtual)
+{
+	if(reactor == NULL || virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	VirtualSdrError err = OK;
+	while(portIter != NULL && err == OK)
+	{
+		struct SdrStream* stream = &virtual->m_streams[iter];
+		if(stream->m_polled && atomic_load(&stream->m_running))
+		{
+			struct epoll_event event;
+			event.events = stream->m_type == RX ? EPOLLIN : EPOLLOUT;
+			event.data.ptr = stream;
+			/*A replay has no buffer to wait on*/
+			int fd = stream->m_buffer != NULL ? iio_buffer_get_poll_fd(stream->m_buffer) : -1;
+			if(fd < 0)
+			{
+				err = NOTIMPLEMENTED;
+			}
+			else if(epoll_ctl(reactor->m_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+			{
+				err = INVALIDVALUE;
+			}
+		}
+		if(err == OK)
+		{
+			iter++;
+			portIter = portIter->m_next;
+		}
+	}
+	if(err != OK)
+	{
+		/*Either all the ports are added or none*/
+		reactor_remove(reactor, virtual, iter);
+	}
+	return err;
+}
+
+VirtualSdrError ReactorRun(struct SdrReactor* reactor, int timeout, int* serviced)
+{
+	if(reactor == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct epoll_event events[REACTOREVENTS];
+	int nEvents;
+	do
+	{
+		nEvents = epoll_wait(reactor->m_epoll, events, REACTOREVENTS, timeout);
+	}
+	while(nEvents < 0 && errno == EINTR);
+	int done = 0;
+	VirtualSdrError error = nEvents < 0 ? INVALIDVALUE : OK;
+	for(int iter = 0; iter < nEvents; iter++)
+	{
+		struct SdrStream* stream = (struct SdrStream*) events[iter].data.ptr;
+		VirtualSdrError res = stream_service(stream);
+		if(res == OK)
+		{
+			done++;
+		}
+		else if(res != PORTBUSY)
+		{
+			error = res;
+		}
+	}
+	if(serviced != NULL)
+	{
+		*serviced = done;
+	}
+	return error;
+}
+
+void FreeReactor(struct SdrReactor* reactor)
+{
+	if(reactor != NULL)
+	{
+		close(reactor->m_epoll);
+		free(reactor);
+	}
+}
+
+/*
+	The manager keeps the Virtual SDRs of a rack and a pool of workers. The workers take tasks in order from a
+	list, StartSdr and StopSdr of every device are tasks too so the devices connect in parallel.
+*/
+struct TaskList{
+	struct TaskList* m_next;
+	SdrTask m_function;
+	void* m_data;
+	int* m_group;
+};
+
+struct DeviceList{
+	struct DeviceList* m_next;
+	struct VirtualSdr* m_virtual;
+	VirtualSdrError m_error;
+};
+
+struct SdrManager{
+	struct DeviceList* m_devices;
+	int m_nDevices;
+	pthread_t* m_workers;
+	int m_nWorkers;
+	pthread_mutex_t m_lock;
+	pthread_cond_t m_work;
+	pthread_cond_t m_done;
+	struct TaskList* m_first;
+	struct TaskList* m_last;
+	int m_pending;
+	bool m_stop;
+};
+
+static void* manager_worker(void* arg)
+{
+	struct SdrManager* manager = (struct SdrManager*) arg;
+	
+	pthread_mutex_lock(&manager->m_lock);
+	while(true)
+	{
+		while(manager->m_first == NULL && !manager->m_stop)
+		{
+			pthread_cond_wait(&manager->m_work, &manager->m_lock);
+		}
+		if(manager->m_first == NULL)
+		{
+			break;
+		}
+		struct TaskList* task = manager->m_first;
+		manager->m_first = task->m_next;
+		if(manager->m_first == NULL)
+		{
+			manager->m_last = NULL;
+		}
+		pthread_mutex_unlock(&manager->m_lock);
+		
+		task->m_function(task->m_data);
+		
+		pthread_mutex_lock(&manager->m_lock);
+		manager->m_pending--;
+		if(task->m_group != NULL)
+		{
+			(*task->m_group)--;
+		}
+		pthread_cond_broadcast(&manager->m_done);
+		free(task);
+	}
+	pthread_mutex_unlock(&manager->m_lock);
+	return NULL;
+}
+
+static VirtualSdrError manager_submit(struct SdrManager* manager, SdrTask function, void* data, int* group)
+{
+	struct TaskList* task = (struct TaskList*) malloc(sizeof(struct TaskList));
+	if(task == NULL)
+	{
+		return NOMEMORY;
+	}
+	task->m_next = NULL;
+	task->m_function = function;
+	task->m_data = data;
+	task->m_group = group;
+	
+	pthread_mutex_lock(&manager->m_lock);
+	if(manager->m_last == NULL)
+	{
+		manager->m_first = task;
+	}
+	else
+	{
+		manager->m_last->m_next = task;
+	}
+	manager->m_last = task;
+	manager->m_pending++;
+	if(group != NULL)
+	{
+		(*group)++;
+	}
+	pthread_cond_signal(&manager->m_work);
+	pthread_mutex_unlock(&manager->m_lock);
+	return OK;
+}
+
+static void manager_start_task(void* data)
+{
+	struct DeviceList* device = (struct DeviceList*) data;
+	device->m_error = StartSdr(device->m_virtual);
+}
+
+static void manager_stop_task(void* data)
+{
+	struct DeviceList* device = (struct DeviceList*) data;
+	device->m_error = StopSdr(device->m_virtual);
+}
+
+/*Runs a task for every device in the pool and waits for all of them, the results are in the order the devices were added*/
+static VirtualSdrError manager_run_devices(struct SdrManager* manager, SdrTask function, VirtualSdrError* errors)
+{
+	int group = 0;
+	VirtualSdrError error = OK;
+	struct DeviceList* device = manager->m_devices;
+	while(device != NULL)
+	{
+		device->m_error = OK;
+		if(manager_submit(manager, function, device, &group) != OK)
+		{
+			device->m_error = NOMEMORY;
+		}
+		device = device->m_next;
+	}
+	
+	pthread_mutex_lock(&manager->m_lock);
+	while(group > 0)
+	{
+		pthread_cond_wait(&manager->m_done, &manager->m_lock);
+	}
+	pthread_mutex_unlock(&manager->m_lock);
+	
+	int iter = 0;
+	device = manager->m_devices;
+	while(device != NULL)
+	{
+		if(errors != NULL)
+		{
+			errors[iter] = device->m_error;
+		}
+		if(error == OK)
+		{
+			error = device->m_error;
+		}
+		iter++;
+		device = device->m_next;
+	}
+	return error;
+}
+
+VirtualSdrError CreateSdrManager(struct SdrManager** manager, int workers)
+{
+	if(manager == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(workers <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	*manager = (struct SdrManager*) calloc(1, sizeof(struct SdrManager));
+	if(*manager == NULL)
+	{
+		return NOMEMORY;
+	}
+	pthread_mutex_init(&(*manager)->m_lock, NULL);
+	pthread_cond_init(&(*manager)->m_work, NULL);
+	pthread_cond_init(&(*manager)->m_done, NULL);
+	(*manager)->m_workers = (pthread_t*) malloc(workers*sizeof(pthread_t));
+	if((*manager)->m_workers == NULL)
+	{
+		FreeSdrManager(*manager);
+		*manager = NULL;
+		return NOMEMORY;
+	}
+	for(int i = 0; i < workers; i++)
+	{
+		if(pthread_create(&(*manager)->m_workers[i], NULL, manager_worker, *manager) != 0)
+		{
+			FreeSdrManager(*manager);
+			*manager = NULL;
+			return NOMEMORY;
+		}
+		(*manager)->m_nWorkers++;
+	}
+	return OK;
+}
+
+VirtualSdrError ManagerAdd(struct SdrManager* manager, struct VirtualSdr* virtual)
+{
+	if(manager == NULL || virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct DeviceList* device = (struct DeviceList*) malloc(sizeof(struct DeviceList));
+	if(device == NULL)
+	{
+		return NOMEMORY;
+	}
+	device->m_next = NULL;
+	device->m_virtual = virtual;
+	device->m_error = OK;
+	
+	struct DeviceList** iterDevice = &manager->m_devices;
+	while(*iterDevice != NULL)
+	{
+		iterDevice = &(*iterDevice)->m_next;
+	}
+	*iterDevice = device;
+	manager->m_nDevices++;
+	return OK;
+}
+
+VirtualSdrError ManagerStart(struct SdrManager* manager, VirtualSdrError* errors)
+{
+	if(manager == NULL)
+	{
+		return NULLPOINTER;
+	}
+	return manager_run_devices(manager, manager_start_task, errors);
+}
+
+VirtualSdrError ManagerStop(struct SdrManager* manager, VirtualSdrError* errors)
+{
+	if(manager == NULL)
+	{
+		return NULLPOINTER;
+	}
+	return manager_run_devices(manager, manager_stop_task, errors);
+}
+
+VirtualSdrError ManagerSubmit(struct SdrManager* manager, SdrTask task, void* data)
+{
+	if(manager == NULL || task == NULL)
+	{
+		return NULLPOINTER;
+	}
+	return manager_submit(manager, task, data, NULL);
+}
+
+VirtualSdrError ManagerWait(struct SdrManager* manager)
+{
+	if(manager == NULL)
+	{
+		return NULLPOINTER;
+	}
+	pthread_mutex_lock(&manager->m_lock);
+	while(manager->m_pending > 0)
+	{
+		pthread_cond_wait(&manager->m_done, &manager->m_lock);
+	}
+	pthread_mutex_unlock(&manager->m_lock);
+	return OK;
+}
+
+void FreeSdrManager(struct SdrManager* manager)
+{
+	if(manager != NULL)
+	{
+		pthread_mutex_lock(&manager->m_lock);
+		manager->m_stop = true;
+		pthread_cond_broadcast(&manager->m_work);
+		pthread_mutex_unlock(&manager->m_lock);
+		for(int i = 0; i < manager->m_nWorkers; i++)
+		{
+			pthread_join(manager->m_workers[i], NULL);
+		}
+		free(manager->m_workers);
+		
+		struct DeviceList* auxDevice;
+		while(manager->m_devices != NULL)
+		{
+			auxDevice = manager->m_devices;
+			manager->m_devices = auxDevice->m_next;
+			free(auxDevice);
+		}
+		pthread_cond_destroy(&manager->m_work);
+		pthread_cond_destroy(&manager->m_done);
+		pthread_mutex_destroy(&manager->m_lock);
+		free(manager);
+	}
+}
+
+VirtualSdrError SendSin(struct VirtualSdr* virtual, float amp, SdrPort port)
+{
+	float I_tx[2048];
+	float Q_tx[2048];
+  
+	for(int i = 0; i < 2048; i++)
+	{
+	 	I_tx[i] = amp*sin(2*3.14159265359*i/2048);
+		Q_tx[i] = amp*cos(2*3.14159265359*i/2048);
+	}
+
+	return TransmitAlways(virtual, port, 2048, I_tx, Q_tx);
+}
+
+/*Fast fourier transform (we need this to measure the received signal)*/
+void _fft(cplx buf[], cplx out[], int n, int step)
+{
+	if (step < n) {
+		_fft(out, buf, n, step * 2);
+		_fft(out + step, buf + step, n, step * 2);
+ 
+		for (int i = 0; i < n; i += 2 * step) {
+			cplx t = cexp(-I * M_PI * i / n) * out[i + step];
+			buf[i / 2]     = out[i] + t;
+			buf[(i + n)/2] = out[i] - t;
+		}
+	}
+}
+ 
+void fft(cplx out[], cplx buf[], int n)
+{
+	//for (int i = 0; i < n; i++) out[i] = buf[i];
+	_fft(buf, out, n, 1);
+}
+
+/*Functions to apply a window before doing the fft*/
+float hann_offset()
+{
+	return 1.77f;
+}
+
+float hann_window(int n, int l)
+{
+	return 0.5f*(1.0f-cos(2*M_PI*n/l));
+}
+
+/*Power in dBFS of one bin of a hann windowed transform of n points, same scale the measurement functions always used*/
+static float bin_power_dbfs(double re, double im, int n)
+{
+	return hann_offset()+20*log10(2.0/pow(2,11))+10*log10((re*re+im*im)/pow(n/2.0,2));
+}
+
+VirtualSdrError MeasureTonePower(float* I_rx, float* Q_rx, int len, long fs, double* tones, int nTones, float* result)
+{
+	if(I_rx == NULL || Q_rx == NULL || tones == NULL || result == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0 || nTones <= 0 || fs <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	
+	/*One goertzel filter per tone, the state is kept in separated arrays so the inner loop over the tones can be vectorized*/
+	double* coeff = (double*) malloc(7*nTones*sizeof(double));
+	if(coeff == NULL)
+	{
+		return NOMEMORY;
+	}
+	double* cosW = coeff + nTones;
+	double* sinW = coeff + 2*nTones;
+	double* s1r = coeff + 3*nTones;
+	double* s1i = coeff + 4*nTones;
+	double* s2r = coeff + 5*nTones;
+	double* s2i = coeff + 6*nTones;
+	
+	for(int t = 0; t < nTones; t++)
+	{
+		double w = 2*M_PI*tones[t]/fs;
+		cosW[t] = cos(w);
+		sinW[t] = sin(w);
+		coeff[t] = 2*cosW[t];
+		s1r[t] = 0;
+		s1i[t] = 0;
+		s2r[t] = 0;
+		s2i[t] = 0;
+	}
+	
+	METRIC_BEGIN(begin);
+	/*The hann window is generated with a rotation instead of calling cos for every sample*/
+	double winCos = 1, winSin = 0;
+	double stepCos = cos(2*M_PI/len), stepSin = sin(2*M_PI/len);
+	for(int n = 0; n < len; n++)
+	{
+		double win = 0.5*(1.0-winCos);
+		double xr = win*I_rx[n];
+		double xi = win*Q_rx[n];
+		for(int t = 0; t < nTones; t++)
+		{
+			double sr = xr + coeff[t]*s1r[t] - s2r[t];
+			double si = xi + coeff[t]*s1i[t] - s2i[t];
+			s2r[t] = s1r[t];
+			s2i[t] = s1i[t];
+			s1r[t] = sr;
+			s1i[t] = si;
+		}
+		double auxCos = winCos*stepCos - winSin*stepSin;
+		winSin = winSin*stepCos + winCos*stepSin;
+		winCos = auxCos;
+	}
+	
+	for(int t = 0; t < nTones; t++)
+	{
+		// y = s1 - e^(-jw)*s2, its module is the one of the DFT at the tone frecuency
+		double yr = s1r[t] - cosW[t]*s2r[t] - sinW[t]*s2i[t];
+		double yi = s1i[t] - cosW[t]*s2i[t] + sinW[t]*s2r[t];
+		result[t] = bin_power_dbfs(yr, yi, len);
+	}
+	METRIC_END(METRICANALYSIS, begin, len*2*sizeof(float));
+	free(coeff);
+	return OK;
+}
+
+
+/*
+	Precomputed radix 2 fft used by the streaming functions, the tables are computed once
+	so every transform only does the butterflies.
+*/
+typedef float complex cplxf;
+
+struct FftPlan{
+	int m_size;
+	cplxf* m_twiddles;
+	int* m_reverse;
+};
+
+static void fft_plan_free(struct FftPlan* plan)
+{
+	free(plan->m_twiddles);
+	free(plan->m_reverse);
+	plan->m_twiddles = NULL;
+	plan->m_reverse = NULL;
+}
+
+static VirtualSdrError fft_plan_init(struct FftPlan* plan, int n)
+{
+	int bits = 0;
+	if(n < 2 || (n & (n-1)) != 0)
+	{
+		return INVALIDVALUE;
+	}
+	while((1 << bits) < n)
+	{
+		bits++;
+	}
+	plan->m_size = n;
+	plan->m_twiddles = (cplxf*) malloc(n/2*sizeof(cplxf));
+	plan->m_reverse = (int*) malloc(n*sizeof(int));
+	if(plan->m_twiddles == NULL || plan->m_reverse == NULL)
+	{
+		fft_plan_free(plan);
+		return NOMEMORY;
+	}
+	for(int i = 0; i < n/2; i++)
+	{
+		plan->m_twiddles[i] = cexp(-I*2*M_PI*i/n);
+	}
+	for(int i = 0; i < n; i++)
+	{
+		int reversed = 0;
+		for(int b = 0; b < bits; b++)
+		{
+			reversed |= ((i >> b) & 1) << (bits-1-b);
+		}
+		plan->m_reverse[i] = reversed;
+	}
+	return OK;
+}
+
+/*Forward transform of in to out, the window is applied while the data is reordered, it can be NULL*/
+static void fft_plan_run(struct FftPlan* plan, cplxf* in, float* window, cplxf* out)
+{
+	int n = plan->m_size;
+	if(window != NULL)
+	{
+		for(int i = 0; i < n; i++)
+		{
+			out[plan->m_reverse[i]] = window[i]*in[i];
+		}
+	}
+	else
+	{
+		for(int i = 0; i < n; i++)
+		{
+			out[plan->m_reverse[i]] = in[i];
+		}
+	}
+	for(int len = 2; len <= n; len <<= 1)
+	{
+		int half = len >> 1;
+		int step = n/len;
+		for(int i = 0; i < n; i += len)
+		{
+			for(int j = 0; j < half; j++)
+			{
+				cplxf t = plan->m_twiddles[j*step]*out[i+j+half];
+				out[i+j+half] = out[i+j] - t;
+				out[i+j] = out[i+j] + t;
+			}
+		}
+	}
+}
+
+/*
+	Welch spectrum analyzer. The samples are kept until there is enough for a transform, after it
+	only the overlap is kept. The power is accumulated in linear and only converted to dB when it's read.
+*/
+struct SpectrumAnalyzer{
+	struct FftPlan m_plan;
+	int m_overlap;
+	SpectrumAveraging m_averaging;
+	float m_alpha;
+	float* m_window;
+	float m_scale;
+	cplxf* m_pending;
+	cplxf* m_work;
+	int m_filled;
+	float* m_power;
+	float* m_maxHold;
+	long m_count;
+	pthread_mutex_t m_lock;
+	
+	/*Port analyzed, set by AttachSpectrumAnalyzer and cleared by DetachSpectrumAnalyzer*/
+	struct VirtualSdr* m_virtual;
+	SdrPort m_port;
+};
+
+VirtualSdrError CreateSpectrumAnalyzer(struct SpectrumAnalyzer** analyzer, int size, int overlap, SpectrumAveraging averaging, float alpha)
+{
+	if(analyzer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(overlap < 0 || overlap >= size || (averaging == AVERAGEEXPONENTIAL && (alpha <= 0 || alpha > 1)))
+	{
+		return INVALIDVALUE;
+	}
+	struct SpectrumAnalyzer* aux = (struct SpectrumAnalyzer*) calloc(1, sizeof(struct SpectrumAnalyzer));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	pthread_mutex_init(&aux->m_lock, NULL);
+	VirtualSdrError funcRes = fft_plan_init(&aux->m_plan, size);
+	if(funcRes != OK)
+	{
+		FreeSpectrumAnalyzer(aux);
+		return funcRes;
+	}
+	aux->m_overlap = overlap;
+	aux->m_averaging = averaging;
+	aux->m_alpha = alpha;
+	aux->m_window = (float*) malloc(3*size*sizeof(float));
+	aux->m_pending = (cplxf*) malloc(2*size*sizeof(cplxf));
+	if(aux->m_window == NULL || aux->m_pending == NULL)
+	{
+		FreeSpectrumAnalyzer(aux);
+		return NOMEMORY;
+	}
+	aux->m_power = aux->m_window + size;
+	aux->m_maxHold = aux->m_window + 2*size;
+	aux->m_work = aux->m_pending + size;
+	
+	/*A full scale tone must read 0dBFS, so the power is divided by the coherent gain of the window*/
+	float windowSum = 0;
+	for(int i = 0; i < size; i++)
+	{
+		aux->m_window[i] = hann_window(i, size);
+		windowSum += aux->m_window[i];
+	}
+	aux->m_scale = 1.0f/(windowSum*windowSum);
+	ResetSpectrum(aux);
+	analyzer[0] = aux;
+	return OK;
+}
+
+VirtualSdrError SpectrumAnalyzerPush(struct SpectrumAnalyzer* analyzer, float* I_rx, float* Q_rx, int len)
+{
+	if(analyzer == NULL || I_rx == NULL || Q_rx == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int size = analyzer->m_plan.m_size;
+	int half = size/2;
+	int read = 0;
+	while(read < len)
+	{
+		int n = size - analyzer->m_filled;
+		if(n > len - read)
+		{
+			n = len - read;
+		}
+		cplxf* pending = analyzer->m_pending + analyzer->m_filled;
+		for(int i = 0; i < n; i++)
+		{
+			pending[i] = I_rx[read+i] + I*Q_rx[read+i];
+		}
+		analyzer->m_filled += n;
+		read += n;
+		if(analyzer->m_filled < size)
+		{
+			break;
+		}
+		
+		METRIC_BEGIN(begin);
+		fft_plan_run(&analyzer->m_plan, analyzer->m_pending, analyzer->m_window, analyzer->m_work);
+		
+		/*The spectrum is stored from -FS/2 to FS/2*/
+		pthread_mutex_lock(&analyzer->m_lock);
+		float weight = analyzer->m_averaging == AVERAGEEXPONENTIAL && analyzer->m_count > 0 ? analyzer->m_alpha : 1.0f;
+		for(int k = 0; k < size; k++)
+		{
+			int bin = k < half ? k + half : k - half;
+			float power = (crealf(analyzer->m_work[k])*crealf(analyzer->m_work[k]) + cimagf(analyzer->m_work[k])*cimagf(analyzer->m_work[k]))*analyzer->m_scale;
+			if(analyzer->m_averaging == AVERAGEEXPONENTIAL)
+			{
+				analyzer->m_power[bin] += weight*(power - analyzer->m_power[bin]);
+			}
+			else
+			{
+				analyzer->m_power[bin] += power;
+			}
+			if(power > analyzer->m_maxHold[bin])
+			{
+				analyzer->m_maxHold[bin] = power;
+			}
+		}
+		analyzer->m_count++;
+		pthread_mutex_unlock(&analyzer->m_lock);
+		METRIC_END(METRICANALYSIS, begin, size*sizeof(cplxf));
+		
+		memmove(analyzer->m_pending, analyzer->m_pending + size - analyzer->m_overlap, analyzer->m_overlap*sizeof(cplxf));
+		analyzer->m_filled = analyzer->m_overlap;
+	}
+	return OK;
+}
+
+/*Stage of a streaming port*/
+static void spectrum_stage(struct SdrBlock* block, void* data)
+{
+	SpectrumAnalyzerPush((struct SpectrumAnalyzer*) data, block->m_I, block->m_Q, block->m_length);
+}
+
+VirtualSdrError AttachSpectrumAnalyzer(struct VirtualSdr* virtual, SdrPort port, struct SpectrumAnalyzer* analyzer)
+{
+	if(analyzer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(analyzer->m_virtual != NULL)
+	{
+		return PORTBUSY;
+	}
+	VirtualSdrError error = AddRxStage(virtual, port, spectrum_stage, analyzer);
+	if(error != OK)
+	{
+		return error;
+	}
+	analyzer->m_virtual = virtual;
+	analyzer->m_port = port;
+	return OK;
+}
+
+VirtualSdrError DetachSpectrumAnalyzer(struct SpectrumAnalyzer* analyzer)
+{
+	if(analyzer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(analyzer->m_virtual == NULL)
+	{
+		return OK;
+	}
+	VirtualSdrError error = stream_remove_stage(analyzer->m_virtual, RX, analyzer->m_port, spectrum_stage, analyzer);
+	if(error != OK && error != NOPORT)
+	{
+		return error;
+	}
+	analyzer->m_virtual = NULL;
+	return OK;
+}
+
+VirtualSdrError GetSpectrum(struct SpectrumAnalyzer* analyzer, float* power, float* maxHold, long* count)
+{
+	if(analyzer == NULL || power == NULL)
+	{
+		return NULLPOINTER;
+	}
+	int size = analyzer->m_plan.m_size;
+	pthread_mutex_lock(&analyzer->m_lock);
+	float divisor = analyzer->m_averaging == AVERAGELINEAR && analyzer->m_count > 0 ? analyzer->m_count : 1;
+	for(int k = 0; k < size; k++)
+	{
+		power[k] = 10*log10f(analyzer->m_power[k]/divisor + 1e-20f);
+		if(maxHold != NULL)
+		{
+			maxHold[k] = 10*log10f(analyzer->m_maxHold[k] + 1e-20f);
+		}
+	}
+	if(count != NULL)
+	{
+		count[0] = analyzer->m_count;
+	}
+	pthread_mutex_unlock(&analyzer->m_lock);
+	return OK;
+}
+
+VirtualSdrError ResetSpectrum(struct SpectrumAnalyzer* analyzer)
+{
+	if(analyzer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	pthread_mutex_lock(&analyzer->m_lock);
+	for(int k = 0; k < analyzer->m_plan.m_size; k++)
+	{
+		analyzer->m_power[k] = 0;
+		analyzer->m_maxHold[k] = 0;
+	}
+	analyzer->m_count = 0;
+	pthread_mutex_unlock(&analyzer->m_lock);
+	return OK;
+}
+
+void FreeSpectrumAnalyzer(struct SpectrumAnalyzer* analyzer)
+{
+	if(analyzer != NULL)
+	{
+		DetachSpectrumAnalyzer(analyzer);
+		pthread_mutex_destroy(&analyzer->m_lock);
+		fft_plan_free(&analyzer->m_plan);
+		free(analyzer->m_window);
+		free(analyzer->m_pending);
+		free(analyzer);
+	}
+}
+
+/*
+	Wideband scanner. It keeps its own connection with every handle it needs, the port is configured once
+	and after that only the LO frecuency is written. The next LO is written before the current segment is
+	processed, so the PLL settles and the DMA fills the next buffer while the fft is done.
+*/
+#define SCANKERNELBUFFERS 2
+#define SCANFLUSHBLOCKS 1
+
+struct SpectrumScanner{
+	struct iio_context* m_ctx;
+	struct iio_channel* m_lo;
+	struct iio_buffer* m_buffer;
+	struct iio_channel* m_channelI;
+	struct FftPlan m_plan;
+	float* m_window;
+	float m_scale;
+	cplxf* m_samples;
+	cplxf* m_work;
+	float* m_segment;
+	long m_start;
+	long m_FS;
+	int m_usable;
+	int m_averages;
+	int m_segments;
+	long long m_lastLo;
+	double m_rate;
+};
+
+/*Writes the LO only if it changes*/
+static void scanner_tune(struct SpectrumScanner* scanner, long long lo)
+{
+	if(lo != scanner->m_lastLo)
+	{
+		wr_ch_lli(scanner->m_lo, "frequency", lo);
+		scanner->m_lastLo = lo;
+	}
+}
+
+static long long scanner_lo(struct SpectrumScanner* scanner, int segment)
+{
+	double binWidth = (double)scanner->m_FS/scanner->m_plan.m_size;
+	return scanner->m_start + (long long)((segment + 0.5)*scanner->m_usable*binWidth);
+}
+
+VirtualSdrError CreateScanner(struct SpectrumScanner** scanner, struct VirtualSdr* virtual, SdrPort port, long start, long stop, int size, float usable, int averages)
+{
+	if(scanner == NULL || virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(stop <= start || usable <= 0 || usable > 1 || averages < 1)
+	{
+		return INVALIDVALUE;
+	}
+	struct PortList* rxPort = find_port(virtual, RX, port);
+	if(rxPort == NULL)
+	{
+		return NOPORT;
+	}
+	struct SpectrumScanner* aux = (struct SpectrumScanner*) calloc(1, sizeof(struct SpectrumScanner));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	VirtualSdrError funcRes = fft_plan_init(&aux->m_plan, size);
+	if(funcRes != OK)
+	{
+		free(aux);
+		return funcRes;
+	}
+	
+	/*Only an even number of bins from the center of every segment is kept*/
+	aux->m_usable = ((int)(usable*size)) & ~1;
+	if(aux->m_usable < 2)
+	{
+		FreeScanner(aux);
+		return INVALIDVALUE;
+	}
+	aux->m_start = start;
+	aux->m_FS = virtual->m_FS;
+	aux->m_averages = averages;
+	aux->m_segments = (int)ceil((double)(stop - start)/(aux->m_usable*((double)virtual->m_FS/size)));
+	aux->m_lastLo = -1;
+	aux->m_window = (float*) malloc(2*size*sizeof(float));
+	aux->m_work = (cplxf*) malloc(2*size*sizeof(cplxf));
+	if(aux->m_window == NULL || aux->m_work == NULL)
+	{
+		FreeScanner(aux);
+		return NOMEMORY;
+	}
+	aux->m_segment = aux->m_window + size;
+	aux->m_samples = aux->m_work + size;
+	float windowSum = 0;
+	for(int i = 0; i < size; i++)
+	{
+		aux->m_window[i] = hann_window(i, size);
+		windowSum += aux->m_window[i];
+	}
+	aux->m_scale = 1.0f/(windowSum*windowSum*averages);
+	
+	char auxStr [64];
+	struct iio_device* rx;
+	struct iio_channel* rx_q;
+	aux->m_ctx = create_context(virtual);
+	if(aux->m_ctx == NULL || !configure_port(aux->m_ctx, virtual->m_FS, rxPort, auxStr) || !get_lo_chan(RX, &aux->m_lo, auxStr, aux->m_ctx) || !get_ad9361_stream_dev(RX, &rx, aux->m_ctx) || !get_ad9361_stream_ch(RX, rx, rxPort->m_port*2, &aux->m_channelI, auxStr) || !get_ad9361_stream_ch(RX, rx, rxPort->m_port*2+1, &rx_q, auxStr))
+	{
+		FreeScanner(aux);
+		return REALSDRNOTFOUND;
+	}
+	aux->m_lastLo = rxPort->m_Frec;
+	iio_channel_enable(aux->m_channelI);
+	iio_channel_enable(rx_q);
+	
+	/*Few kernel buffers so the data after a retune isn't behind old blocks*/
+	iio_device_set_kernel_buffers_count(rx, SCANKERNELBUFFERS);
+	aux->m_buffer = create_buffer(rx, size*averages, false);
+	if(aux->m_buffer == NULL)
+	{
+		FreeScanner(aux);
+		return REALSDRNOTFOUND;
+	}
+	scanner[0] = aux;
+	return OK;
+}
+
+VirtualSdrError GetScanLength(struct SpectrumScanner* scanner, int* bins, double* firstFrec, double* binWidth)
+{
+	if(scanner == NULL || bins == NULL)
+	{
+		return NULLPOINTER;
+	}
+	bins[0] = scanner->m_segments*scanner->m_usable;
+	if(firstFrec != NULL)
+	{
+		firstFrec[0] = scanner->m_start;
+	}
+	if(binWidth != NULL)
+	{
+		binWidth[0] = (double)scanner->m_FS/scanner->m_plan.m_size;
+	}
+	return OK;
+}
+
+/*Averages the ffts of the last block and keeps the center of the spectrum*/
+static void scanner_process(struct SpectrumScanner* scanner, float* power)
+{
+	int size = scanner->m_plan.m_size;
+	int half = size/2;
+	ptrdiff_t p_inc = iio_buffer_step(scanner->m_buffer);
+	char* p_dat = (char *)iio_buffer_first(scanner->m_buffer, scanner->m_channelI);
+	
+	for(int k = 0; k < size; k++)
+	{
+		scanner->m_segment[k] = 0;
+	}
+	for(int a = 0; a < scanner->m_averages; a++)
+	{
+		for(int i = 0; i < size; i++)
+		{
+			scanner->m_work[i] = (((int16_t*)p_dat)[0] + I*((int16_t*)p_dat)[1])/(float)(pow(2,11)-1);
+			p_dat += p_inc;
+		}
+		fft_plan_run(&scanner->m_plan, scanner->m_work, scanner->m_window, scanner->m_samples);
+		for(int k = 0; k < size; k++)
+		{
+			int bin = k < half ? k + half : k - half;
+			scanner->m_segment[bin] += crealf(scanner->m_samples[k])*crealf(scanner->m_samples[k]) + cimagf(scanner->m_samples[k])*cimagf(scanner->m_samples[k]);
+		}
+	}
+	/*The bin of the LO has its leakage, it's replaced by its neighbours*/
+	scanner->m_segment[half] = (scanner->m_segment[half-1] + scanner->m_segment[half+1])/2;
+	
+	int first = half - scanner->m_usable/2;
+	for(int k = 0; k < scanner->m_usable; k++)
+	{
+		power[k] = 10*log10f(scanner->m_segment[first+k]*scanner->m_scale + 1e-20f);
+	}
+}
+
+VirtualSdrError RunScan(struct SpectrumScanner* scanner, float* power, double* rate)
+{
+	struct timespec begin, end;
+	if(scanner == NULL || power == NULL)
+	{
+		return NULLPOINTER;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	
+	scanner_tune(scanner, scanner_lo(scanner, 0));
+	for(int segment = 0; segment < scanner->m_segments; segment++)
+	{
+		/*The blocks captured while the PLL was moving are thrown away*/
+		for(int f = 0; f < SCANFLUSHBLOCKS + 1; f++)
+		{
+			if(refill_buffer(scanner->m_buffer) < 0)
+			{
+				return REALSDRNOTFOUND;
+			}
+		}
+		if(segment + 1 < scanner->m_segments)
+		{
+			scanner_tune(scanner, scanner_lo(scanner, segment + 1));
+		}
+		METRIC_BEGIN(analysis);
+		scanner_process(scanner, power + segment*scanner->m_usable);
+		METRIC_END(METRICANALYSIS, analysis, scanner->m_averages*scanner->m_plan.m_size*2*sizeof(int16_t));
+	}
+	
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	scanner->m_rate = (double)scanner->m_segments*scanner->m_usable*scanner->m_FS/scanner->m_plan.m_size/1e9/((end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec)/1e9);
+	if(rate != NULL)
+	{
+		rate[0] = scanner->m_rate;
+	}
+	return OK;
+}
+
+void FreeScanner(struct SpectrumScanner* scanner)
+{
+	if(scanner != NULL)
+	{
+		if(scanner->m_buffer != NULL)
+		{
+			iio_buffer_destroy(scanner->m_buffer);
+		}
+		if(scanner->m_ctx != NULL)
+		{
+			iio_context_destroy(scanner->m_ctx);
+		}
+		fft_plan_free(&scanner->m_plan);
+		free(scanner->m_window);
+		free(scanner->m_work);
+		free(scanner);
+	}
+}
+
+/*
+	Polyphase channelizer, critically sampled. The prototype filter has M*taps coefficients and branch k keeps
+	the ones k, k+M, k+2M... For every M input samples the branches give M values and a fft of them gives one
+	sample of every channel, so each channel costs the taps plus log2(M) operations per sample. The input of
+	a block is kept after the last taps*M-1 samples of the previous one, so every output only depends on the
+	buffer and the outputs of a block are split in slices between the threads.
+*/
+struct ChannelizerWorker{
+	struct SdrChannelizer* m_channelizer;
+	pthread_t m_thread;
+	cplxf* m_branches;
+	cplxf* m_spectrum;
+	int m_first;
+	int m_last;
+};
+
+struct SdrChannelizer{
+	struct ChannelizerOptions m_options;
+	SdrChannelCallback m_callback;
+	void* m_data;
+	struct FftPlan m_plan;
+	float* m_filter;
+	int m_length;
+	
+	/*Port filtered, set by AttachChannelizer and cleared by DetachChannelizer*/
+	struct VirtualSdr* m_virtual;
+	SdrPort m_port;
+	
+	/*History of length-1 samples followed by the block*/
+	cplxf* m_buffer;
+	int m_capacity;
+	unsigned long long m_next;
+	bool m_started;
+	
+	/*Output of every channel, one after the other with m_outCapacity samples each*/
+	float* m_outI;
+	float* m_outQ;
+	int m_outCapacity;
+	int m_offset;
+	
+	/*Workers, the one of index 0 is the thread which gives the block and m_running the threads started*/
+	struct ChannelizerWorker* m_workers;
+	int m_running;
+	pthread_mutex_t m_lock;
+	pthread_cond_t m_work;
+	pthread_cond_t m_finished;
+	unsigned long long m_generation;
+	int m_pending;
+	bool m_stop;
+};
+
+/*Computes the outputs of a slice, output n uses the input m_offset + n*M of the block*/
+static void channelizer_slice(struct ChannelizerWorker* worker)
+{
+	struct SdrChannelizer* channelizer = worker->m_channelizer;
+	int channels = channelizer->m_options.m_channels;
+	int taps = channelizer->m_options.m_taps;
+	int stride = channelizer->m_outCapacity;
+	for(int n = worker->m_first; n < worker->m_last; n++)
+	{
+		cplxf* newest = channelizer->m_buffer + channelizer->m_length - 1 + channelizer->m_offset + n*channels;
+		for(int k = 0; k < channels; k++)
+		{
+			cplxf sum = 0;
+			const float* h = channelizer->m_filter + k;
+			const cplxf* x = newest - k;
+			for(int m = 0; m < taps; m++)
+			{
+				sum += h[m*channels]*x[-m*channels];
+			}
+			worker->m_branches[k] = sum;
+		}
+		fft_plan_run(&channelizer->m_plan, worker->m_branches, NULL, worker->m_spectrum);
+		for(int c = 0; c < channels; c++)
+		{
+			cplxf y = worker->m_spectrum[(channels - c)%channels];
+			channelizer->m_outI[c*stride + n] = crealf(y);
+			channelizer->m_outQ[c*stride + n] = cimagf(y);
+		}
+	}
+}
+
+static void* channelizer_worker(void* arg)
+{
+	struct ChannelizerWorker* worker = (struct ChannelizerWorker*) arg;
+	struct SdrChannelizer* channelizer = worker->m_channelizer;
+	unsigned long long generation = 0;
+	
+	pthread_mutex_lock(&channelizer->m_lock);
+	while(true)
+	{
+		while(channelizer->m_generation == generation && !channelizer->m_stop)
+		{
+			pthread_cond_wait(&channelizer->m_work, &channelizer->m_lock);
+		}
+		if(channelizer->m_stop)
+		{
+			break;
+		}
+		generation = channelizer->m_generation;
+		pthread_mutex_unlock(&channelizer->m_lock);
+		
+		channelizer_slice(worker);
+		
+		pthread_mutex_lock(&channelizer->m_lock);
+		channelizer->m_pending--;
+		if(channelizer->m_pending == 0)
+		{
+			pthread_cond_signal(&channelizer->m_finished);
+		}
+	}
+	pthread_mutex_unlock(&channelizer->m_lock);
+	return NULL;
+}
+
+/*Makes room for a block of len samples, the history is kept*/
+static bool channelizer_reserve(struct SdrChannelizer* channelizer, int len)
+{
+	if(len <= channelizer->m_capacity)
+	{
+		return true;
+	}
+	cplxf* buffer = (cplxf*) realloc(channelizer->m_buffer, (channelizer->m_length - 1 + len)*sizeof(cplxf));
+	if(buffer == NULL)
+	{
+		return false;
+	}
+	channelizer->m_buffer = buffer;
+	channelizer->m_capacity = len;
+	
+	int outputs = len/channelizer->m_options.m_channels + 1;
+	free(channelizer->m_outI);
+	channelizer->m_outI = (float*) malloc(2*channelizer->m_options.m_channels*outputs*sizeof(float));
+	if(channelizer->m_outI == NULL)
+	{
+		channelizer->m_capacity = 0;
+		return false;
+	}
+	channelizer->m_outQ = channelizer->m_outI + channelizer->m_options.m_channels*outputs;
+	channelizer->m_outCapacity = outputs;
+	return true;
+}
+
+static void channelizer_stage(struct SdrBlock* block, void* data)
+{
+	struct SdrChannelizer* channelizer = (struct SdrChannelizer*) data;
+	int channels = channelizer->m_options.m_channels;
+	int history = channelizer->m_length - 1;
+	int len = block->m_length;
+	if(len <= 0 || !channelizer_reserve(channelizer, len))
+	{
+		return;
+	}
+	METRIC_BEGIN(begin);
+	if(!channelizer->m_started || block->m_sample != channelizer->m_next)
+	{
+		memset(channelizer->m_buffer, 0, history*sizeof(cplxf));
+		channelizer->m_started = true;
+	}
+	channelizer->m_next = block->m_sample + len;
+	for(int i = 0; i < len; i++)
+	{
+		channelizer->m_buffer[history + i] = block->m_I[i] + I*block->m_Q[i];
+	}
+	
+	/*Outputs are at the samples which are a multiple of M*/
+	int offset = (channels - block->m_sample%channels)%channels;
+	int outputs = offset < len ? (len - offset - 1)/channels + 1 : 0;
+	channelizer->m_offset = offset;
+	int nWorkers = channelizer->m_options.m_threads + 1;
+	for(int w = 0; w < nWorkers; w++)
+	{
+		channelizer->m_workers[w].m_first = (long long)outputs*w/nWorkers;
+		channelizer->m_workers[w].m_last = (long long)outputs*(w+1)/nWorkers;
+	}
+	if(nWorkers > 1)
+	{
+		pthread_mutex_lock(&channelizer->m_lock);
+		channelizer->m_pending = nWorkers - 1;
+		channelizer->m_generation++;
+		pthread_cond_broadcast(&channelizer->m_work);
+		pthread_mutex_unlock(&channelizer->m_lock);
+	}
+	channelizer_slice(&channelizer->m_workers[0]);
+	if(nWorkers > 1)
+	{
+		pthread_mutex_lock(&channelizer->m_lock);
+		while(channelizer->m_pending > 0)
+		{
+			pthread_cond_wait(&channelizer->m_finished, &channelizer->m_lock);
+		}
+		pthread_mutex_unlock(&channelizer->m_lock);
+	}
+	memmove(channelizer->m_buffer, channelizer->m_buffer + len, history*sizeof(cplxf));
+	METRIC_END(METRICANALYSIS, begin, len*2*sizeof(float));
+	
+	if(outputs == 0 || channelizer->m_callback == NULL)
+	{
+		return;
+	}
+	struct SdrBlock channel;
+	channel.m_port = block->m_port;
+	channel.m_length = outputs;
+	channel.m_sample = (block->m_sample + offset)/channels;
+	channel.m_time = block->m_time;
+	for(int c = 0; c < channels; c++)
+	{
+		channel.m_I = channelizer->m_outI + c*channelizer->m_outCapacity;
+		channel.m_Q = channelizer->m_outQ + c*channelizer->m_outCapacity;
+		channelizer->m_callback(c, &channel, channelizer->m_data);
+	}
+}
+
+VirtualSdrError DefaultChannelizerOptions(struct ChannelizerOptions* options)
+{
+	if(options == NULL)
+	{
+		return NULLPOINTER;
+	}
+	options->m_channels = 16;
+	options->m_taps = 12;
+	options->m_threads = 0;
+	return OK;
+}
+
+/*Frees what is created, the workers must be already stopped*/
+static void channelizer_free(struct SdrChannelizer* channelizer)
+{
+	if(channelizer->m_workers != NULL)
+	{
+		for(int w = 0; w <= channelizer->m_options.m_threads; w++)
+		{
+			free(channelizer->m_workers[w].m_branches);
+			free(channelizer->m_workers[w].m_spectrum);
+		}
+	}
+	fft_plan_free(&channelizer->m_plan);
+	pthread_mutex_destroy(&channelizer->m_lock);
+	pthread_cond_destroy(&channelizer->m_work);
+	pthread_cond_destroy(&channelizer->m_finished);
+	free(channelizer->m_workers);
+	free(channelizer->m_filter);
+	free(channelizer->m_buffer);
+	free(channelizer->m_outI);
+	free(channelizer);
+}
+
+VirtualSdrError CreateChannelizer(struct SdrChannelizer** channelizer, struct ChannelizerOptions* options, SdrChannelCallback callback, void* data)
+{
+	if(channelizer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct ChannelizerOptions defaults;
+	if(options == NULL)
+	{
+		DefaultChannelizerOptions(&defaults);
+		options = &defaults;
+	}
+	if(options->m_taps <= 0 || options->m_threads < 0)
+	{
+		return INVALIDVALUE;
+	}
+	struct SdrChannelizer* aux = (struct SdrChannelizer*) calloc(1, sizeof(struct SdrChannelizer));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	VirtualSdrError err = fft_plan_init(&aux->m_plan, options->m_channels);
+	if(err != OK)
+	{
+		free(aux);
+		return err;
+	}
+	aux->m_options = *options;
+	aux->m_callback = callback;
+	aux->m_data = data;
+	aux->m_length = options->m_channels*options->m_taps;
+	pthread_mutex_init(&aux->m_lock, NULL);
+	pthread_cond_init(&aux->m_work, NULL);
+	pthread_cond_init(&aux->m_finished, NULL);
+	
+	/*Hann windowed sinc with the cut at the edge of the channel and a gain of 1*/
+	aux->m_filter = (float*) malloc(aux->m_length*sizeof(float));
+	aux->m_workers = (struct ChannelizerWorker*) calloc(options->m_threads + 1, sizeof(struct ChannelizerWorker));
+	if(aux->m_filter == NULL || aux->m_workers == NULL)
+	{
+		channelizer_free(aux);
+		return NOMEMORY;
+	}
+	double sum = 0;
+	for(int i = 0; i < aux->m_length; i++)
+	{
+		double x = (i - (aux->m_length - 1)/2.0)/options->m_channels;
+		aux->m_filter[i] = (x == 0 ? 1 : sin(M_PI*x)/(M_PI*x))*hann_window(i + 1, aux->m_length + 1);
+		sum += aux->m_filter[i];
+	}
+	for(int i = 0; i < aux->m_length; i++)
+	{
+		aux->m_filter[i] /= sum;
+	}
+	
+	for(int w = 0; w <= options->m_threads; w++)
+	{
+		aux->m_workers[w].m_channelizer = aux;
+		aux->m_workers[w].m_branches = (cplxf*) malloc(options->m_channels*sizeof(cplxf));
+		aux->m_workers[w].m_spectrum = (cplxf*) malloc(options->m_channels*sizeof(cplxf));
+		if(aux->m_workers[w].m_branches == NULL || aux->m_workers[w].m_spectrum == NULL)
+		{
+			channelizer_free(aux);
+			return NOMEMORY;
+		}
+	}
+	while(aux->m_running < options->m_threads)
+	{
+		if(pthread_create(&aux->m_workers[aux->m_running + 1].m_thread, NULL, channelizer_worker, &aux->m_workers[aux->m_running + 1]) != 0)
+		{
+			FreeChannelizer(aux);
+			return NOMEMORY;
+		}
+		aux->m_running++;
+	}
+	*channelizer = aux;
+	return OK;
+}
+
+VirtualSdrError ChannelizerPush(struct SdrChannelizer* channelizer, float* I_rx, float* Q_rx, int len)
+{
+	if(channelizer == NULL || I_rx == NULL || Q_rx == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	struct SdrBlock block;
+	block.m_port = first;
+	block.m_length = len;
+	block.m_I = I_rx;
+	block.m_Q = Q_rx;
+	block.m_sample = channelizer->m_next;
+	block.m_time = now_ns();
+	channelizer_stage(&block, channelizer);
+	return OK;
+}
+
+VirtualSdrError AttachChannelizer(struct VirtualSdr* virtual, SdrPort port, struct SdrChannelizer* channelizer)
+{
+	if(channelizer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(channelizer->m_virtual != NULL)
+	{
+		return PORTBUSY;
+	}
+	VirtualSdrError error = AddRxStage(virtual, port, channelizer_stage, channelizer);
+	if(error != OK)
+	{
+		return error;
+	}
+	channelizer->m_virtual = virtual;
+	channelizer->m_port = port;
+	return OK;
+}
+
+VirtualSdrError DetachChannelizer(struct SdrChannelizer* channelizer)
+{
+	if(channelizer == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(channelizer->m_virtual == NULL)
+	{
+		return OK;
+	}
+	VirtualSdrError error = stream_remove_stage(channelizer->m_virtual, RX, channelizer->m_port, channelizer_stage, channelizer);
+	if(error != OK && error != NOPORT)
+	{
+		return error;
+	}
+	channelizer->m_virtual = NULL;
+	return OK;
+}
+
+void FreeChannelizer(struct SdrChannelizer* channelizer)
+{
+	if(channelizer != NULL)
+	{
+		DetachChannelizer(channelizer);
+		pthread_mutex_lock(&channelizer->m_lock);
+		channelizer->m_stop = true;
+		pthread_cond_broadcast(&channelizer->m_work);
+		pthread_mutex_unlock(&channelizer->m_lock);
+		for(int w = 1; w <= channelizer->m_running; w++)
+		{
+			pthread_join(channelizer->m_workers[w].m_thread, NULL);
+		}
+		channelizer_free(channelizer);
+	}
+}
+
+/*
+	Cross correlation of two signals. The segments are padded with zeros to twice their length, so the
+	product of the conjugated spectrum of the first one and the spectrum of the second one is the correlation
+	without wrapping for any delay shorter than a segment. The peak is refined with a parabola over its
+	neighbours and its phase is the one of the second signal against the first one.
+*/
+#define CORRELATORSLOTS 8
+
+/*Pads len samples to the size of the plan and transforms them, returns their energy*/
+static double correlator_spectrum(struct FftPlan* plan, float* I_in, float* Q_in, int len, cplxf* padded, cplxf* out)
+{
+	double energy = 0;
+	for(int i = 0; i < len; i++)
+	{
+		padded[i] = I_in[i] + I*Q_in[i];
+		energy += I_in[i]*I_in[i] + Q_in[i]*Q_in[i];
+	}
+	memset(padded + len, 0, (plan->m_size - len)*sizeof(cplxf));
+	fft_plan_run(plan, padded, NULL, out);
+	return energy;
+}
+
+/*Finds the peak of the correlation of a cross spectrum, maxLag is the largest delay looked for*/
+static void correlator_peak(struct FftPlan* plan, cplxf* cross, cplxf* work, cplxf* corr, double energy, int maxLag, struct SdrDelay* result)
+{
+	int n = plan->m_size;
+	
+	/*Inverse transform done with the forward one over the conjugates, the scale is removed with the energy*/
+	for(int i = 0; i < n; i++)
+	{
+		work[i] = conjf(cross[i]);
+	}
+	fft_plan_run(plan, work, NULL, corr);
+	
+	int best = 0;
+	float bestPower = -1;
+	for(int i = 0; i < n; i++)
+	{
+		int lag = i < n/2 ? i : i - n;
+		float power = crealf(corr[i])*crealf(corr[i]) + cimagf(corr[i])*cimagf(corr[i]);
+		if(lag <= maxLag && lag >= -maxLag && power > bestPower)
+		{
+			best = i;
+			bestPower = power;
+		}
+	}
+	float y1 = cabsf(corr[(best + n - 1)%n]);
+	float y2 = cabsf(corr[best]);
+	float y3 = cabsf(corr[(best + 1)%n]);
+	
+	/*Parabola over the logarithms, a gaussian fits the main lobe better than a parabola over the magnitude*/
+	float delta = 0;
+	if(y1 > 0 && y3 > 0)
+	{
+		float l1 = logf(y1);
+		float l2 = logf(y2);
+		float l3 = logf(y3);
+		float den = l1 - 2*l2 + l3;
+		delta = den < 0 ? 0.5f*(l1 - l3)/den : 0;
+	}
+	
+	result->m_delay = (best < n/2 ? best : best - n) + delta;
+	result->m_phase = -cargf(corr[best])*180/M_PI;
+	result->m_peak = energy > 0 ? y2/(n*energy) : 0;
+}
+
+VirtualSdrError MeasureDelay(float* I_a, float* Q_a, float* I_b, float* Q_b, int len, struct SdrDelay* result)
+{
+	if(I_a == NULL || Q_a == NULL || I_b == NULL || Q_b == NULL || result == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	int n = 2;
+	while(n < 2*len)
+	{
+		n <<= 1;
+	}
+	struct FftPlan plan;
+	VirtualSdrError err = fft_plan_init(&plan, n);
+	if(err != OK)
+	{
+		return err;
+	}
+	cplxf* buffers = (cplxf*) malloc(4*n*sizeof(cplxf));
+	if(buffers == NULL)
+	{
+		fft_plan_free(&plan);
+		return NOMEMORY;
+	}
+	cplxf* spectrumA = buffers;
+	cplxf* spectrumB = buffers + n;
+	cplxf* work = buffers + 2*n;
+	cplxf* corr = buffers + 3*n;
+	
+	METRIC_BEGIN(begin);
+	double energyA = correlator_spectrum(&plan, I_a, Q_a, len, work, spectrumA);
+	double energyB = correlator_spectrum(&plan, I_b, Q_b, len, work, spectrumB);
+	for(int i = 0; i < n; i++)
+	{
+		spectrumA[i] = conjf(spectrumA[i])*spectrumB[i];
+	}
+	correlator_peak(&plan, spectrumA, work, corr, sqrt(energyA*energyB), len - 1, result);
+	METRIC_END(METRICANALYSIS, begin, 2*len*2*sizeof(float));
+	result->m_sample = 0;
+	result->m_segments = 1;
+	
+	free(buffers);
+	fft_plan_free(&plan);
+	return OK;
+}
+
+/*Segment of both signals, each side is filled by the thread of its port*/
+struct CorrelatorSlot{
+	float* m_I[2];
+	float* m_Q[2];
+	long long m_segment[2];
+	bool m_complete[2];
+	bool m_busy;
+};
+
+/*Side of the correlator, the second one is the stage of the attached port*/
+struct CorrelatorSide{
+	struct SdrCorrelator* m_correlator;
+	int m_side;
+	long long m_segment;
+	int m_filled;
+	unsigned long long m_next;
+};
+
+/*Buffers of a thread of the correlator*/
+struct CorrelatorWorker{
+	struct SdrCorrelator* m_correlator;
+	pthread_t m_thread;
+	cplxf* m_padded;
+	cplxf* m_spectrum;
+	cplxf* m_cross;
+	cplxf* m_corr;
+};
+
+struct SdrCorrelator{
+	struct CorrelatorOptions m_options;
+	SdrDelayCallback m_callback;
+	void* m_data;
+	struct FftPlan m_plan;
+	
+	/*Port of the second side, set by AttachCorrelator and cleared by DetachCorrelator*/
+	struct VirtualSdr* m_virtual;
+	SdrPort m_port;
+	
+	/*Conjugated spectrum of the reference, NULL if the first side is given with CorrelatorPush*/
+	cplxf* m_reference;
+	double m_referenceEnergy;
+	
+	struct CorrelatorSide m_sides[2];
+	struct CorrelatorSlot m_slots[CORRELATORSLOTS];
+	struct CorrelatorWorker* m_workers;
+	int m_running;
+	
+	/*Queue of complete slots and the average, protected by m_lock*/
+	pthread_mutex_t m_lock;
+	pthread_cond_t m_work;
+	int m_queue[CORRELATORSLOTS];
+	int m_queueHead;
+	int m_queueCount;
+	bool m_stop;
+	cplxf* m_average;
+	double m_energy[2];
+	int m_averaged;
+	unsigned long long m_sample;
+	struct SdrDelay m_last;
+	bool m_valid;
+	unsigned long long m_dropped;
+};
+
+/*Correlates one slot and adds it to the average, the result is given when enough segments are averaged*/
+static void correlator_process(struct CorrelatorWorker* worker, struct CorrelatorSlot* slot)
+{
+	struct SdrCorrelator* correlator = worker->m_correlator;
+	int size = correlator->m_options.m_size;
+	int n = correlator->m_plan.m_size;
+	
+	METRIC_BEGIN(begin);
+	double energyA = correlator->m_referenceEnergy;
+	if(correlator->m_reference == NULL)
+	{
+		energyA = correlator_spectrum(&correlator->m_plan, slot->m_I[0], slot->m_Q[0], size, worker->m_padded, worker->m_cross);
+		for(int i = 0; i < n; i++)
+		{
+			worker->m_cross[i] = conjf(worker->m_cross[i]);
+		}
+	}
+	else
+	{
+		memcpy(worker->m_cross, correlator->m_reference, n*sizeof(cplxf));
+	}
+	double energyB = correlator_spectrum(&correlator->m_plan, slot->m_I[1], slot->m_Q[1], size, worker->m_padded, worker->m_spectrum);
+	for(int i = 0; i < n; i++)
+	{
+		worker->m_cross[i] *= worker->m_spectrum[i];
+	}
+	unsigned long long sample = (unsigned long long) slot->m_segment[1]*size;
+	
+	struct SdrDelay result;
+	bool done = false;
+	pthread_mutex_lock(&correlator->m_lock);
+	for(int i = 0; i < n; i++)
+	{
+		correlator->m_average[i] += worker->m_cross[i];
+	}
+	if(correlator->m_averaged == 0 || sample < correlator->m_sample)
+	{
+		correlator->m_sample = sample;
+	}
+	correlator->m_energy[0] += energyA;
+	correlator->m_energy[1] += energyB;
+	correlator->m_averaged++;
+	slot->m_busy = false;
+	slot->m_complete[0] = false;
+	slot->m_complete[1] = false;
+	if(correlator->m_averaged == correlator->m_options.m_average)
+	{
+		memcpy(worker->m_cross, correlator->m_average, n*sizeof(cplxf));
+		memset(correlator->m_average, 0, n*sizeof(cplxf));
+		result.m_sample = correlator->m_sample;
+		result.m_segments = correlator->m_averaged;
+		double energy = sqrt(correlator->m_energy[0]*correlator->m_energy[1]);
+		correlator->m_energy[0] = 0;
+		correlator->m_energy[1] = 0;
+		correlator->m_averaged = 0;
+		pthread_mutex_unlock(&correlator->m_lock);
+		
+		correlator_peak(&correlator->m_plan, worker->m_cross, worker->m_padded, worker->m_corr, energy, size - 1, &result);
+		done = true;
+		pthread_mutex_lock(&correlator->m_lock);
+		correlator->m_last = result;
+		correlator->m_valid = true;
+	}
+	pthread_mutex_unlock(&correlator->m_lock);
+	METRIC_END(METRICANALYSIS, begin, 2*size*2*sizeof(float));
+	
+	if(done && correlator->m_callback != NULL)
+	{
+		correlator->m_callback(&result, correlator->m_data);
+	}
+}
+
+static void* correlator_worker(void* arg)
+{
+	struct CorrelatorWorker* worker = (struct CorrelatorWorker*) arg;
+	struct SdrCorrelator* correlator = worker->m_correlator;
+	
+	pthread_mutex_lock(&correlator->m_lock);
+	while(true)
+	{
+		while(correlator->m_queueCount == 0 && !correlator->m_stop)
+		{
+			pthread_cond_wait(&correlator->m_work, &correlator->m_lock);
+		}
+		if(correlator->m_stop)
+		{
+			break;
+		}
+		struct CorrelatorSlot* slot = &correlator->m_slots[correlator->m_queue[correlator->m_queueHead]];
+		correlator->m_queueHead = (correlator->m_queueHead + 1)%CORRELATORSLOTS;
+		correlator->m_queueCount--;
+		pthread_mutex_unlock(&correlator->m_lock);
+		
+		correlator_process(worker, slot);
+		
+		pthread_mutex_lock(&correlator->m_lock);
+	}
+	pthread_mutex_unlock(&correlator->m_lock);
+	return NULL;
+}
+
+/*Marks the side of a slot as complete and queues it if the other side is there too, called with m_lock*/
+static void correlator_complete(struct SdrCorrelator* correlator, int index, int side)
+{
+	struct CorrelatorSlot* slot = &correlator->m_slots[index];
+	slot->m_complete[side] = true;
+	bool paired = correlator->m_reference != NULL || (slot->m_complete[1-side] && slot->m_segment[1-side] == slot->m_segment[side]);
+	if(paired)
+	{
+		slot->m_busy = true;
+		correlator->m_queue[(correlator->m_queueHead + correlator->m_queueCount)%CORRELATORSLOTS] = index;
+		correlator->m_queueCount++;
+		pthread_cond_signal(&correlator->m_work);
+	}
+}
+
+/*
+	Copies a block to the segments of its side. A segment is only used if it's received whole, so after a gap
+	or when the slot is still being correlated the side waits for the start of the next segment.
+*/
+static void correlator_stage(struct SdrBlock* block, void* data)
+{
+	struct CorrelatorSide* side = (struct CorrelatorSide*) data;
+	struct SdrCorrelator* correlator = side->m_correlator;
+	int size = correlator->m_options.m_size;
+	if(block->m_sample != side->m_next)
+	{
+		side->m_segment = -1;
+	}
+	side->m_next = block->m_sample + block->m_length;
+	
+	int done = 0;
+	while(done < block->m_length)
+	{
+		unsigned long long sample = block->m_sample + done;
+		long long segment = sample/size;
+		int position = sample%size;
+		int chunk = size - position < block->m_length - done ? size - position : block->m_length - done;
+		int index = segment%CORRELATORSLOTS;
+		struct CorrelatorSlot* slot = &correlator->m_slots[index];
+		
+		if(side->m_segment != segment)
+		{
+			side->m_segment = -1;
+			if(position == 0)
+			{
+				pthread_mutex_lock(&correlator->m_lock);
+				if(slot->m_busy)
+				{
+					correlator->m_dropped++;
+				}
+				else
+				{
+					/*The last segment of this side in the slot never found the other side*/
+					if(slot->m_complete[side->m_side])
+					{
+						correlator->m_dropped++;
+					}
+					slot->m_segment[side->m_side] = segment;
+					slot->m_complete[side->m_side] = false;
+					side->m_segment = segment;
+					side->m_filled = 0;
+				}
+				pthread_mutex_unlock(&correlator->m_lock);
+			}
+		}
+		if(side->m_segment == segment)
+		{
+			memcpy(slot->m_I[side->m_side] + position, block->m_I + done, chunk*sizeof(float));
+			memcpy(slot->m_Q[side->m_side] + position, block->m_Q + done, chunk*sizeof(float));
+			side->m_filled += chunk;
+			if(side->m_filled == size)
+			{
+				pthread_mutex_lock(&correlator->m_lock);
+				correlator_complete(correlator, index, side->m_side);
+				pthread_mutex_unlock(&correlator->m_lock);
+				side->m_segment = -1;
+			}
+		}
+		done += chunk;
+	}
+}
+
+VirtualSdrError DefaultCorrelatorOptions(struct CorrelatorOptions* options)
+{
+	if(options == NULL)
+	{
+		return NULLPOINTER;
+	}
+	options->m_size = 4096;
+	options->m_average = 8;
+	options->m_threads = 1;
+	return OK;
+}
+
+/*Frees what is created, the threads must be already stopped*/
+static void correlator_free(struct SdrCorrelator* correlator)
+{
+	if(correlator->m_workers != NULL)
+	{
+		for(int w = 0; w < correlator->m_options.m_threads; w++)
+		{
+			free(correlator->m_workers[w].m_padded);
+		}
+	}
+	for(int i = 0; i < CORRELATORSLOTS; i++)
+	{
+		free(correlator->m_slots[i].m_I[0]);
+	}
+	fft_plan_free(&correlator->m_plan);
+	pthread_mutex_destroy(&correlator->m_lock);
+	pthread_cond_destroy(&correlator->m_work);
+	free(correlator->m_workers);
+	free(correlator->m_reference);
+	free(correlator->m_average);
+	free(correlator);
+}
+
+VirtualSdrError CreateCorrelator(struct SdrCorrelator** correlator, struct CorrelatorOptions* options, SdrDelayCallback callback, void* data)
+{
+	if(correlator == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct CorrelatorOptions defaults;
+	if(options == NULL)
+	{
+		DefaultCorrelatorOptions(&defaults);
+		options = &defaults;
+	}
+	if(options->m_average <= 0 || options->m_threads <= 0 || options->m_size < 2)
+	{
+		return INVALIDVALUE;
+	}
+	struct SdrCorrelator* aux = (struct SdrCorrelator*) calloc(1, sizeof(struct SdrCorrelator));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	VirtualSdrError err = fft_plan_init(&aux->m_plan, 2*options->m_size);
+	if(err != OK)
+	{
+		free(aux);
+		return err;
+	}
+	aux->m_options = *options;
+	aux->m_callback = callback;
+	aux->m_data = data;
+	pthread_mutex_init(&aux->m_lock, NULL);
+	pthread_cond_init(&aux->m_work, NULL);
+	
+	int n = aux->m_plan.m_size;
+	int size = options->m_size;
+	aux->m_average = (cplxf*) calloc(n, sizeof(cplxf));
+	aux->m_workers = (struct CorrelatorWorker*) calloc(options->m_threads, sizeof(struct CorrelatorWorker));
+	bool allocated = aux->m_average != NULL && aux->m_workers != NULL;
+	for(int i = 0; i < CORRELATORSLOTS && allocated; i++)
+	{
+		struct CorrelatorSlot* slot = &aux->m_slots[i];
+		slot->m_I[0] = (float*) malloc(4*size*sizeof(float));
+		allocated = slot->m_I[0] != NULL;
+		slot->m_Q[0] = slot->m_I[0] + size;
+		slot->m_I[1] = slot->m_I[0] + 2*size;
+		slot->m_Q[1] = slot->m_I[0] + 3*size;
+		slot->m_segment[0] = -1;
+		slot->m_segment[1] = -1;
+	}
+	for(int w = 0; w < options->m_threads && allocated; w++)
+	{
+		struct CorrelatorWorker* worker = &aux->m_workers[w];
+		worker->m_correlator = aux;
+		worker->m_padded = (cplxf*) malloc(4*n*sizeof(cplxf));
+		allocated = worker->m_padded != NULL;
+		worker->m_spectrum = worker->m_padded + n;
+		worker->m_cross = worker->m_padded + 2*n;
+		worker->m_corr = worker->m_padded + 3*n;
+	}
+	if(!allocated)
+	{
+		correlator_free(aux);
+		return NOMEMORY;
+	}
+	for(int s = 0; s < 2; s++)
+	{
+		aux->m_sides[s].m_correlator = aux;
+		aux->m_sides[s].m_side = s;
+		aux->m_sides[s].m_segment = -1;
+	}
+	while(aux->m_running < options->m_threads)
+	{
+		if(pthread_create(&aux->m_workers[aux->m_running].m_thread, NULL, correlator_worker, &aux->m_workers[aux->m_running]) != 0)
+		{
+			FreeCorrelator(aux);
+			return NOMEMORY;
+		}
+		aux->m_running++;
+	}
+	*correlator = aux;
+	return OK;
+}
+
+VirtualSdrError SetCorrelatorReference(struct SdrCorrelator* correlator, float* I_ref, float* Q_ref, int len)
+{
+	if(correlator == NULL || I_ref == NULL || Q_ref == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0 || len > correlator->m_options.m_size)
+	{
+		return INVALIDVALUE;
+	}
+	int n = correlator->m_plan.m_size;
+	cplxf* reference = (cplxf*) malloc(n*sizeof(cplxf));
+	cplxf* padded = (cplxf*) malloc(n*sizeof(cplxf));
+	if(reference == NULL || padded == NULL)
+	{
+		free(reference);
+		free(padded);
+		return NOMEMORY;
+	}
+	correlator->m_referenceEnergy = correlator_spectrum(&correlator->m_plan, I_ref, Q_ref, len, padded, reference);
+	for(int i = 0; i < n; i++)
+	{
+		reference[i] = conjf(reference[i]);
+	}
+	free(padded);
+	free(correlator->m_reference);
+	correlator->m_reference = reference;
+	return OK;
+}
+
+VirtualSdrError CorrelatorPush(struct SdrCorrelator* correlator, float* I_a, float* Q_a, float* I_b, float* Q_b, int len)
+{
+	if(correlator == NULL || I_b == NULL || Q_b == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(correlator->m_reference == NULL && (I_a == NULL || Q_a == NULL))
+	{
+		return NULLPOINTER;
+	}
+	if(len <= 0)
+	{
+		return INVALIDVALUE;
+	}
+	struct SdrBlock block;
+	block.m_port = first;
+	block.m_length = len;
+	block.m_sample = correlator->m_sides[1].m_next;
+	block.m_time = now_ns();
+	if(correlator->m_reference == NULL)
+	{
+		block.m_I = I_a;
+		block.m_Q = Q_a;
+		correlator_stage(&block, &correlator->m_sides[0]);
+	}
+	block.m_I = I_b;
+	block.m_Q = Q_b;
+	correlator_stage(&block, &correlator->m_sides[1]);
+	return OK;
+}
+
+/*
+	Two ports streamed separately don't share the sample index, every buffer counts from its own start, so
+	only the reference mode is streamed. Coherent signals of two ports are given with CorrelatorPush.
+*/
+VirtualSdrError AttachCorrelator(struct VirtualSdr* virtual, SdrPort port, struct SdrCorrelator* correlator)
+{
+	if(virtual == NULL || correlator == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(correlator->m_virtual != NULL)
+	{
+		return PORTBUSY;
+	}
+	if(correlator->m_reference == NULL)
+	{
+		return INVALIDVALUE;
+	}
+	VirtualSdrError err = AddRxStage(virtual, port, correlator_stage, &correlator->m_sides[1]);
+	if(err != OK)
+	{
+		return err;
+	}
+	correlator->m_virtual = virtual;
+	correlator->m_port = port;
+	return OK;
+}
+
+VirtualSdrError DetachCorrelator(struct SdrCorrelator* correlator)
+{
+	if(correlator == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(correlator->m_virtual == NULL)
+	{
+		return OK;
+	}
+	VirtualSdrError error = stream_remove_stage(correlator->m_virtual, RX, correlator->m_port, correlator_stage, &correlator->m_sides[1]);
+	if(error != OK && error != NOPORT)
+	{
+		return error;
+	}
+	correlator->m_virtual = NULL;
+	return OK;
+}
+
+VirtualSdrError GetDelay(struct SdrCorrelator* correlator, struct SdrDelay* result, unsigned long long* dropped)
+{
+	if(correlator == NULL || result == NULL)
+	{
+		return NULLPOINTER;
+	}
+	pthread_mutex_lock(&correlator->m_lock);
+	bool valid = correlator->m_valid;
+	*result = correlator->m_last;
+	if(dropped != NULL)
+	{
+		*dropped = correlator->m_dropped;
+	}
+	pthread_mutex_unlock(&correlator->m_lock);
+	return valid ? OK : NOTSTREAMING;
+}
+
+void FreeCorrelator(struct SdrCorrelator* correlator)
+{
+	if(correlator != NULL)
+	{
+		DetachCorrelator(correlator);
+		pthread_mutex_lock(&correlator->m_lock);
+		correlator->m_stop = true;
+		pthread_cond_broadcast(&correlator->m_work);
+		pthread_mutex_unlock(&correlator->m_lock);
+		for(int w = 0; w < correlator->m_running; w++)
+		{
+			pthread_join(correlator->m_workers[w].m_thread, NULL);
+		}
+		correlator_free(correlator);
+	}
+}
+
+/*Just a small function to avoid weird-looking code*/
+float calc_compression(float gain,  float attenuation, float recv)
+{
+	return ((attenuation+gain)-recv);
+}
+
+/*
+	Sweep engine used by the measurement functions.
+	A capture thread reconfigures the receiver and captures the next step while the caller analyzes the previous one,
+	the captures are passed through a small ring of slots so the radio is never waiting for the analysis. Like the
+	scanner, the sweep has its own connection which is configured once, and only the gain is written after that.
+*/
+#define SWEEPSLOTS 3
+#define SWEEPLENGTH 2048
+#define SWEEPTOLERANCE 0.05f
+
+struct SweepSlot{
+	float* m_I;
+	float* m_Q;
+};
+
+struct SweepEngine{
+	struct VirtualSdr* m_sdr;
+	struct PortList* m_rxPort;
+	int m_averages;
+	
+	/*Own connection of the sweep, the tone is a cyclic buffer and only the gain is written between captures*/
+	struct iio_context* m_ctx;
+	struct iio_channel* m_gain;
+	struct iio_channel* m_channelI;
+	struct iio_buffer* m_rxBuffer;
+	struct iio_buffer* m_txBuffer;
+	float m_lastGain;
+	pthread_t m_thread;
+	bool m_started;
+	bool m_quit;
+	bool m_running;
+	
+	float* m_gains;
+	int m_nGains;
+	struct SweepSlot m_slots[SWEEPSLOTS];
+	int m_captured;
+	int m_analyzed;
+	bool m_cancel;
+	bool m_finished;
+	VirtualSdrError m_error;
+	pthread_mutex_t m_lock;
+	pthread_cond_t m_cond;
+};
+
+/*Called after every point is analyzed, returning true stops the batch*/
+typedef bool (*SweepStop)(int, float*, void*);
+
+static void* sweep_capture(void* arg);
+
+static void sweep_free(struct SweepEngine* engine)
+{
+	if(engine->m_started)
+	{
+		pthread_mutex_lock(&engine->m_lock);
+		engine->m_quit = true;
+		pthread_cond_broadcast(&engine->m_cond);
+		pthread_mutex_unlock(&engine->m_lock);
+		pthread_join(engine->m_thread, NULL);
+	}
+	if(engine->m_rxBuffer != NULL)
+	{
+		iio_buffer_destroy(engine->m_rxBuffer);
+	}
+	if(engine->m_txBuffer != NULL)
+	{
+		iio_buffer_destroy(engine->m_txBuffer);
+	}
+	if(engine->m_ctx != NULL)
+	{
+		iio_context_destroy(engine->m_ctx);
+	}
+	for(int i = 0; i < SWEEPSLOTS; i++)
+	{
+		free(engine->m_slots[i].m_I);
+	}
+	pthread_mutex_destroy(&engine->m_lock);
+	pthread_cond_destroy(&engine->m_cond);
+}
+
+/*
+	Opens the connection of the sweep: the TX port sends the tone of len samples forever and the RX port is left
+	in manual gain with few kernel buffers, so after a change of gain only those blocks are thrown away.
+*/
+static VirtualSdrError sweep_init(struct SweepEngine* engine, struct VirtualSdr* virtual, struct PortList* txPort, struct PortList* rxPort, float* I_tx, float* Q_tx, int len, int averages)
+{
+	memset(engine, 0, sizeof(struct SweepEngine));
+	engine->m_sdr = virtual;
+	engine->m_rxPort = rxPort;
+	engine->m_averages = averages;
+	pthread_mutex_init(&engine->m_lock, NULL);
+	pthread_cond_init(&engine->m_cond, NULL);
+	for(int i = 0; i < SWEEPSLOTS; i++)
+	{
+		engine->m_slots[i].m_I = (float*) malloc(2*SWEEPLENGTH*sizeof(float));
+		if(engine->m_slots[i].m_I == NULL)
+		{
+			sweep_free(engine);
+			return NOMEMORY;
+		}
+		engine->m_slots[i].m_Q = engine->m_slots[i].m_I + SWEEPLENGTH;
+	}
+	
+	char auxStr [64];
+	struct iio_device* tx;
+	struct iio_device* rx;
+	struct iio_channel* tx_i;
+	struct iio_channel* tx_q;
+	struct iio_channel* rx_q;
+	struct PortList manualPort = *rxPort;
+	manualPort.m_Amp = rxPort->m_Amp >= 0 ? rxPort->m_Amp : 0;
+	engine->m_lastGain = manualPort.m_Amp;
+	engine->m_ctx = create_context(virtual);
+	if(engine->m_ctx == NULL || !configure_port(engine->m_ctx, virtual->m_FS, txPort, auxStr) || !configure_port(engine->m_ctx, virtual->m_FS, &manualPort, auxStr)
+		|| !get_phy_chan(RX, rxPort->m_port-1, &engine->m_gain, auxStr, engine->m_ctx)
+		|| !get_ad9361_stream_dev(TX, &tx, engine->m_ctx) || !get_ad9361_stream_ch(TX, tx, txPort->m_port*2, &tx_i, auxStr) || !get_ad9361_stream_ch(TX, tx, txPort->m_port*2+1, &tx_q, auxStr)
+		|| !get_ad9361_stream_dev(RX, &rx, engine->m_ctx) || !get_ad9361_stream_ch(RX, rx, rxPort->m_port*2, &engine->m_channelI, auxStr) || !get_ad9361_stream_ch(RX, rx, rxPort->m_port*2+1, &rx_q, auxStr))
+	{
+		sweep_free(engine);
+		return REALSDRNOTFOUND;
+	}
+	iio_channel_enable(tx_i);
+	iio_channel_enable(tx_q);
+	iio_channel_enable(engine->m_channelI);
+	iio_channel_enable(rx_q);
+	
+	engine->m_txBuffer = create_buffer(tx, len, true);
+	if(engine->m_txBuffer == NULL)
+	{
+		sweep_free(engine);
+		return REALSDRNOTFOUND;
+	}
+	int t_iter = 0;
+	ptrdiff_t p_inc = iio_buffer_step(engine->m_txBuffer);
+	char* p_end = iio_buffer_end(engine->m_txBuffer);
+	for (char* p_dat = (char *)iio_buffer_first(engine->m_txBuffer, tx_i); p_dat < p_end; p_dat += p_inc)
+	{
+		((int16_t*)p_dat)[0] = (int16_t) ((pow(2, 15)-1)*I_tx[t_iter]); // Real (I)
+		((int16_t*)p_dat)[1] = (int16_t) ((pow(2, 15)-1)*Q_tx[t_iter]); // Imag (Q)
+		t_iter++;
+	}
+	if(push_buffer(engine->m_txBuffer) < 0)
+	{
+		sweep_free(engine);
+		return BUFFERERROR;
+	}
+	
+	iio_device_set_kernel_buffers_count(rx, SCANKERNELBUFFERS);
+	engine->m_rxBuffer = create_buffer(rx, SWEEPLENGTH, false);
+	if(engine->m_rxBuffer == NULL)
+	{
+		sweep_free(engine);
+		return REALSDRNOTFOUND;
+	}
+	if(pthread_create(&engine->m_thread, NULL, sweep_capture, engine) != 0)
+	{
+		sweep_free(engine);
+		return NOMEMORY;
+	}
+	engine->m_started = true;
+	return OK;
+}
+
+/*Captures one block at a gain, the blocks which may have the previous gain are thrown away*/
+static VirtualSdrError sweep_capture_one(struct SweepEngine* engine, float gain, struct SweepSlot* slot)
+{
+	int flush = 0;
+	if(gain != engine->m_lastGain)
+	{
+		if(iio_channel_attr_write_double(engine->m_gain, "hardwaregain", gain) < 0)
+		{
+			return INVALIDVALUE;
+		}
+		engine->m_lastGain = gain;
+		flush = SCANKERNELBUFFERS;
+	}
+	for(int f = 0; f <= flush; f++)
+	{
+		if(refill_buffer(engine->m_rxBuffer) < 0)
+		{
+			return BUFFERERROR;
+		}
+	}
+	
+	METRIC_BEGIN(conversion);
+	int t_iter = 0;
+	ptrdiff_t p_inc = iio_buffer_step(engine->m_rxBuffer);
+	char* p_end = iio_buffer_end(engine->m_rxBuffer);
+	for (char* p_dat = (char *)iio_buffer_first(engine->m_rxBuffer, engine->m_channelI); p_dat < p_end && t_iter < SWEEPLENGTH; p_dat += p_inc)
+	{
+		slot->m_I[t_iter] = (float)(((int16_t*)p_dat)[0])/(pow(2,11)-1);
+		slot->m_Q[t_iter] = (float)(((int16_t*)p_dat)[1])/(pow(2,11)-1);
+		t_iter++;
+	}
+	METRIC_END(METRICCONVERSION, conversion, t_iter*2*sizeof(int16_t));
+	return OK;
+}
+
+/*Capture thread, it lives for the whole sweep and captures the batches given by sweep_measure*/
+static void* sweep_capture(void* arg)
+{
+	struct SweepEngine* engine = (struct SweepEngine*) arg;
+	
+	pthread_mutex_lock(&engine->m_lock);
+	while(true)
+	{
+		while(!engine->m_running && !engine->m_quit)
+		{
+			pthread_cond_wait(&engine->m_cond, &engine->m_lock);
+		}
+		if(engine->m_quit)
+		{
+			break;
+		}
+		int total = engine->m_nGains*engine->m_averages;
+		VirtualSdrError funcRes = OK;
+		for(int c = 0; c < total && funcRes == OK; c++)
+		{
+			while(engine->m_captured - engine->m_analyzed == SWEEPSLOTS && !engine->m_cancel)
+			{
+				pthread_cond_wait(&engine->m_cond, &engine->m_lock);
+			}
+			if(engine->m_cancel)
+			{
+				break;
+			}
+			float gain = engine->m_gains[c/engine->m_averages];
+			pthread_mutex_unlock(&engine->m_lock);
+			
+			funcRes = sweep_capture_one(engine, gain, &engine->m_slots[c%SWEEPSLOTS]);
+			
+			pthread_mutex_lock(&engine->m_lock);
+			if(funcRes == OK)
+			{
+				engine->m_captured++;
+			}
+			else
+			{
+				engine->m_error = funcRes;
+			}
+			pthread_cond_broadcast(&engine->m_cond);
+		}
+		engine->m_finished = true;
+		engine->m_running = false;
+		pthread_cond_broadcast(&engine->m_cond);
+	}
+	pthread_mutex_unlock(&engine->m_lock);
+	return NULL;
+}
+
+/*Measures the tones at every gain of the list averaging the captures of each point, power is stored as nGains x nTones*/
+static VirtualSdrError sweep_measure(struct SweepEngine* engine, float* gains, int nGains, double* tones, int nTones, float* power, SweepStop stop, void* stopData)
+{
+	float tonePower [8];
+	double accumulated [8];
+	
+	if(nTones > 8)
+	{
+		return INVALIDVALUE;
+	}
+	pthread_mutex_lock(&engine->m_lock);
+	engine->m_gains = gains;
+	engine->m_nGains = nGains;
+	engine->m_captured = 0;
+	engine->m_analyzed = 0;
+	engine->m_cancel = false;
+	engine->m_finished = false;
+	engine->m_error = OK;
+	engine->m_running = true;
+	pthread_cond_broadcast(&engine->m_cond);
+	pthread_mutex_unlock(&engine->m_lock);
+	
+	VirtualSdrError funcRes = OK;
+	int total = nGains*engine->m_averages;
+	for(int c = 0; c < total && funcRes == OK; c++)
+	{
+		pthread_mutex_lock(&engine->m_lock);
+		while(engine->m_captured <= c && !engine->m_finished && engine->m_error == OK)
+		{
+			pthread_cond_wait(&engine->m_cond, &engine->m_lock);
+		}
+		if(engine->m_captured <= c)
+		{
+			funcRes = engine->m_error != OK ? engine->m_error : REALSDRNOTFOUND;
+			pthread_mutex_unlock(&engine->m_lock);
+			break;
+		}
+		pthread_mutex_unlock(&engine->m_lock);
+		
+		struct SweepSlot* slot = &engine->m_slots[c%SWEEPSLOTS];
+		funcRes = MeasureTonePower(slot->m_I, slot->m_Q, SWEEPLENGTH, engine->m_sdr->m_FS, tones, nTones, tonePower);
+		
+		pthread_mutex_lock(&engine->m_lock);
+		engine->m_analyzed++;
+		pthread_cond_broadcast(&engine->m_cond);
+		pthread_mutex_unlock(&engine->m_lock);
+		
+		/*The average is done with the power, not with the dB*/
+		int point = c/engine->m_averages;
+		for(int t = 0; t < nTones; t++)
+		{
+			if(c%engine->m_averages == 0)
+			{
+				accumulated[t] = 0;
+			}
+			accumulated[t] += pow(10, tonePower[t]/10);
+		}
+		if(c%engine->m_averages == engine->m_averages-1)
+		{
+			for(int t = 0; t < nTones; t++)
+			{
+				power[point*nTones+t] = 10*log10(accumulated[t]/engine->m_averages);
+			}
+			if(stop != NULL && stop(point, power, stopData))
+			{
+				break;
+			}
+		}
+	}
+	
+	pthread_mutex_lock(&engine->m_lock);
+	engine->m_cancel = true;
+	pthread_cond_broadcast(&engine->m_cond);
+	while(engine->m_running)
+	{
+		pthread_cond_wait(&engine->m_cond, &engine->m_lock);
+	}
+	pthread_mutex_unlock(&engine->m_lock);
+	return funcRes;
+}
+
+/*Stops the coarse grid of the compression point at the first point which is not compressed, point 0 is the reference*/
+struct CompressionGrid{
+	float* m_gains;
+	int m_last;
+};
+
+static bool compression_grid_stop(int point, float* power, void* data)
+{
+	struct CompressionGrid* grid = (struct CompressionGrid*) data;
+	grid->m_last = point;
+	return point > 0 && calc_compression(power[0], grid->m_gains[point] - grid->m_gains[0], power[point]) <= 1;
+}
+
+VirtualSdrError DefaultSweepOptions(struct SweepOptions* options)
+{
+	if(options == NULL)
+	{
+		return NULLPOINTER;
+	}
+	options->m_search = SWEEPBRACKETED;
+	options->m_averages = 1;
+	options->m_points = 8;
+	options->m_minGain = 0;
+	options->m_maxGain = 71;
+	options->m_resolution = 0.25f;
+	return OK;
+}
+
+static VirtualSdrError check_sweep_options(struct SweepOptions* options)
+{
+	if(options->m_averages < 1 || options->m_points < 2 || options->m_resolution <= 0 || options->m_minGain < 0 || options->m_maxGain <= options->m_minGain)
+	{
+		return INVALIDVALUE;
+	}
+	return OK;
+}
+
+VirtualSdrError FindCompressionPoint(struct VirtualSdr* virtual, SdrPort inPort, SdrPort outPort, float* result)
+{
+	return FindCompressionPointSweep(virtual, inPort, outPort, NULL, result);
+}
+
+VirtualSdrError FindCompressionPointSweep(struct VirtualSdr* virtual, SdrPort inPort, SdrPort outPort, struct SweepOptions* options, float* result)
+{
+	float I_tx[2048];
+	float Q_tx[2048];
+	struct SweepOptions defaults;
+	struct SweepEngine engine;
+	double tone;
+	
+	if(virtual == NULL || result == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(options == NULL)
+	{
+		DefaultSweepOptions(&defaults);
+		options = &defaults;
+	}
+	VirtualSdrError funcRes = check_sweep_options(options);
+	if(funcRes != OK)
+	{
+		return funcRes;
+	}
+	
+	for(int i = 0; i < 2048; i++)
+	{
+	 	I_tx[i] = sin(2*M_PI*i/2048);
+		Q_tx[i] = cos(2*M_PI*i/2048);
+	}
+	/*The sinus sent is at -FS/2048 and it's received moved by the difference between both LO*/
+	struct PortList* txPort = find_port(virtual, TX, inPort);
+	struct PortList* rxPort = find_port(virtual, RX, outPort);
+	if(txPort == NULL || rxPort == NULL)
+	{
+		return NOPORT;
+	}
+	tone = -(double)virtual->m_FS/2048 + (txPort->m_Frec - rxPort->m_Frec);
+	
+	funcRes = sweep_init(&engine, virtual, txPort, rxPort, I_tx, Q_tx, 2048, options->m_averages);
+	if(funcRes != OK)
+	{
+		return funcRes;
+	}
+	
+	/*The reference is taken at the configured gain, or at the bottom of the range if the port is in automatic gain*/
+	float refGain = rxPort->m_Amp >= 0 ? rxPort->m_Amp : options->m_minGain;
+	
+	/*
+		First batch: the reference at the configured gain and the ends of the range, or a coarse grid stopped at the first linear point.
+		The compression is above 1dB at the top of the range and goes down with the gain.
+	*/
+	int nGains = options->m_search == SWEEPBISECTION ? 3 : options->m_points+1;
+	float* gains = (float*) malloc(2*nGains*sizeof(float));
+	if(gains == NULL)
+	{
+		sweep_free(&engine);
+		return NOMEMORY;
+	}
+	float* power = gains + nGains;
+	gains[0] = refGain;
+	if(options->m_search == SWEEPBISECTION)
+	{
+		gains[1] = options->m_maxGain;
+		gains[2] = options->m_minGain;
+	}
+	else
+	{
+		for(int i = 0; i < options->m_points; i++)
+		{
+			gains[i+1] = options->m_maxGain - i*(options->m_maxGain - options->m_minGain)/(options->m_points-1);
+		}
+	}
+	struct CompressionGrid grid = {gains, 0};
+	funcRes = sweep_measure(&engine, gains, nGains, &tone, 1, power, options->m_search == SWEEPBISECTION ? NULL : compression_grid_stop, &grid);
+	
+	float ref = power[0];
+	float gComp = 0, gLin = 0, cComp = 0, cLin = 0;
+	bool bracketed = false;
+	if(funcRes == OK)
+	{
+		if(options->m_search == SWEEPBISECTION)
+		{
+			grid.m_last = calc_compression(ref, gains[1] - refGain, power[1]) <= 1 ? 1 : 2;
+		}
+		int last = grid.m_last;
+		float cLast = calc_compression(ref, gains[last] - refGain, power[last]);
+		if(last == 1 && cLast <= 1)
+		{
+			/*Not even the top of the range is compressed*/
+			result[0] = gains[1];
+		}
+		else if(cLast > 1)
+		{
+			/*Still compressed at the bottom of the range*/
+			result[0] = options->m_minGain;
+		}
+		else
+		{
+			gLin = gains[last];
+			cLin = cLast;
+			gComp = gains[last-1];
+			cComp = calc_compression(ref, gComp - refGain, power[last-1]);
+			bracketed = true;
+		}
+	}
+	free(gains);
+	
+	/*Refine inside the bracket, halving it or following the line between both ends (regula falsi, illinois variant)*/
+	int lastSide = 0;
+	while(funcRes == OK && bracketed)
+	{
+		float g, p, c;
+		if(gComp - gLin <= options->m_resolution)
+		{
+			result[0] = options->m_search == SWEEPMODEL ? gLin + (gComp - gLin)*(cLin - 1)/(cLin - cComp) : gComp;
+			break;
+		}
+		if(options->m_search == SWEEPMODEL)
+		{
+			g = gLin + (gComp - gLin)*(cLin - 1)/(cLin - cComp);
+		}
+		else
+		{
+			g = (gComp + gLin)/2;
+		}
+		g = gLin + roundf((g - gLin)/options->m_resolution)*options->m_resolution;
+		if(g <= gLin)
+		{
+			g = gLin + options->m_resolution;
+		}
+		if(g >= gComp)
+		{
+			g = gComp - options->m_resolution;
+		}
+		
+		funcRes = sweep_measure(&engine, &g, 1, &tone, 1, &p, NULL, NULL);
+		c = calc_compression(ref, g - refGain, p);
+		if(options->m_search == SWEEPMODEL && fabsf(c - 1) < SWEEPTOLERANCE)
+		{
+			result[0] = g;
+			break;
+		}
+		if(c > 1)
+		{
+			gComp = g;
+			cComp = c;
+			if(lastSide > 0)
+			{
+				cLin = 1 + (cLin - 1)/2;
+			}
+			lastSide = 1;
+		}
+		else
+		{
+			gLin = g;
+			cLin = c;
+			if(lastSide < 0)
+			{
+				cComp = 1 + (cComp - 1)/2;
+			}
+			lastSide = -1;
+		}
+	}
+	
+	sweep_free(&engine);
+	return funcRes;
+}
+
+VirtualSdrError FindIIP3(struct VirtualSdr* virtual, SdrPort inPort, SdrPort outPort, float* result)
+{
+	return FindIIP3Sweep(virtual, inPort, outPort, NULL, result);
+}
+
+VirtualSdrError FindIIP3Sweep(struct VirtualSdr* virtual, SdrPort inPort, SdrPort outPort, struct SweepOptions* options, float* result)
+{
+	float I_tx[2048];
+	float Q_tx[2048];
+	float poutMax, poutIIP3Max;
+	float tonePower [4];
+	double tones [4];
+	struct SweepOptions defaults;
+	struct SweepEngine engine;
+	
+	if(virtual == NULL || result == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(options == NULL)
+	{
+		DefaultSweepOptions(&defaults);
+		options = &defaults;
+	}
+	VirtualSdrError funcRes = check_sweep_options(options);
+	if(funcRes != OK)
+	{
+		return funcRes;
+	}
+	
+	for(int i = 0; i < 2048; i++)
+	{
+	 	I_tx[i] = 0.5*sin(2*M_PI*i/2048)+0.5*sin(1000000*2*M_PI*i/virtual->m_FS);
+		Q_tx[i] = 0.5*cos(2*M_PI*i/2048)+0.5*sin(0500000*2*M_PI*i/virtual->m_FS);
+	}
+	/*Fundamentals at -0.5MHz and -1.5MHz, third order products at the mirrored frecuencies, all moved by the difference between both LO*/
+	struct PortList* txPort = find_port(virtual, TX, inPort);
+	struct PortList* rxPort = find_port(virtual, RX, outPort);
+	if(txPort == NULL || rxPort == NULL)
+	{
+		return NOPORT;
+	}
+	double loOffset = txPort->m_Frec - rxPort->m_Frec;
+	tones[0] = -500000 + loOffset;
+	tones[1] = -1500000 + loOffset;
+	tones[2] = 500000 + loOffset;
+	tones[3] = 1500000 + loOffset;
+	
+	/*Only one point at the configured gain, the averaged captures are the ones pipelined*/
+	funcRes = sweep_init(&engine, virtual, txPort, rxPort, I_tx, Q_tx, 2048, options->m_averages);
+	if(funcRes != OK)
+	{
+		return funcRes;
+	}
+	float gain = rxPort->m_Amp >= 0 ? rxPort->m_Amp : options->m_minGain;
+	funcRes = sweep_measure(&engine, &gain, 1, tones, 4, tonePower, NULL, NULL);
+	sweep_free(&engine);
+	if(funcRes != OK)
+	{
+		return funcRes;
+	}
+	poutMax = fmaxf(tonePower[0], tonePower[1]);
+	poutIIP3Max = fmaxf(tonePower[2], tonePower[3]);
+	result[0] = poutMax+(poutMax/poutIIP3Max)/2;
+	return OK;
+}
+
+/*
+	Calibration store of the measurement functions.
+	The points are kept in a list like the rest of the configuration and saved in a small binary file:
+	"SDRC", version and number of points, followed by one fixed size record per point. Each value keeps the
+	time it was measured, the files of version 1 have one time for both.
+*/
+#define CALIBRATIONMAGIC "SDRC"
+#define CALIBRATIONVERSION 2
+#define CALIBRATIONGAINTOLERANCE 0.5f
+
+VirtualSdrError InitCalibration(struct SdrCalibration* calibration, long maxAge, long maxSpan)
+{
+	if(calibration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(maxAge < 0 || maxSpan < 0)
+	{
+		return INVALIDVALUE;
+	}
+	calibration->m_points = NULL;
+	calibration->m_maxAge = maxAge;
+	calibration->m_maxSpan = maxSpan;
+	return OK;
+}
+
+static bool calibration_fresh(struct SdrCalibration* calibration, long long measured, long long now)
+{
+	return calibration->m_maxAge == 0 || now - measured <= calibration->m_maxAge;
+}
+
+/*Finds the point with exactly this key or creates it*/
+static struct CalibrationList* calibration_point(struct SdrCalibration* calibration, SdrPort port, long frec, int bw, float gain)
+{
+	struct CalibrationList* iterPoint = calibration->m_points;
+	while(iterPoint != NULL)
+	{
+		if(iterPoint->m_port == port && iterPoint->m_Frec == frec && iterPoint->m_Bw == bw && iterPoint->m_gain == gain)
+		{
+			return iterPoint;
+		}
+		iterPoint = iterPoint->m_next;
+	}
+	iterPoint = (struct CalibrationList*) malloc(sizeof(struct CalibrationList));
+	if(iterPoint == NULL)
+	{
+		return NULL;
+	}
+	iterPoint->m_port = port;
+	iterPoint->m_Frec = frec;
+	iterPoint->m_Bw = bw;
+	iterPoint->m_gain = gain;
+	iterPoint->m_compressionPoint = NAN;
+	iterPoint->m_IIP3 = NAN;
+	iterPoint->m_compressionTime = 0;
+	iterPoint->m_IIP3Time = 0;
+	iterPoint->m_next = calibration->m_points;
+	calibration->m_points = iterPoint;
+	return iterPoint;
+}
+
+/*Looks for the nearest fresh points below and above the frecuency and interpolates between them*/
+static VirtualSdrError calibration_lookup(struct SdrCalibration* calibration, SdrPort port, long frec, int bw, float gain, bool iip3, float* result)
+{
+	struct CalibrationList* below = NULL;
+	struct CalibrationList* above = NULL;
+	long long now = time(NULL);
+	
+	struct CalibrationList* iterPoint = calibration->m_points;
+	while(iterPoint != NULL)
+	{
+		float value = iip3 ? iterPoint->m_IIP3 : iterPoint->m_compressionPoint;
+		long long measured = iip3 ? iterPoint->m_IIP3Time : iterPoint->m_compressionTime;
+		if(iterPoint->m_port == port && iterPoint->m_Bw == bw && fabsf(iterPoint->m_gain - gain) <= CALIBRATIONGAINTOLERANCE && !isnan(value) && calibration_fresh(calibration, measured, now))
+		{
+			if(iterPoint->m_Frec <= frec && (below == NULL || iterPoint->m_Frec > below->m_Frec))
+			{
+				below = iterPoint;
+			}
+			if(iterPoint->m_Frec >= frec && (above == NULL || iterPoint->m_Frec < above->m_Frec))
+			{
+				above = iterPoint;
+			}
+		}
+		iterPoint = iterPoint->m_next;
+	}
+	
+	if(below != NULL && below->m_Frec == frec)
+	{
+		result[0] = iip3 ? below->m_IIP3 : below->m_compressionPoint;
+		return OK;
+	}
+	if(below == NULL || above == NULL || above->m_Frec - below->m_Frec > calibration->m_maxSpan)
+	{
+		return NOCALIBRATION;
+	}
+	float valueBelow = iip3 ? below->m_IIP3 : below->m_compressionPoint;
+	float valueAbove = iip3 ? above->m_IIP3 : above->m_compressionPoint;
+	result[0] = valueBelow + (valueAbove - valueBelow)*(float)(frec - below->m_Frec)/(above->m_Frec - below->m_Frec);
+	return OK;
+}
+
+VirtualSdrError QueryCalibration(struct SdrCalibration* calibration, SdrPort port, long frec, int bw, float gain, float* compressionPoint, float* iip3)
+{
+	if(calibration == NULL || compressionPoint == NULL || iip3 == NULL)
+	{
+		return NULLPOINTER;
+	}
+	VirtualSdrError resCp = calibration_lookup(calibration, port, frec, bw, gain, false, compressionPoint);
+	VirtualSdrError resIIP3 = calibration_lookup(calibration, port, frec, bw, gain, true, iip3);
+	if(resCp != OK)
+	{
+		compressionPoint[0] = NAN;
+	}
+	if(resIIP3 != OK)
+	{
+		iip3[0] = NAN;
+	}
+	return resCp == OK || resIIP3 == OK ? OK : NOCALIBRATION;
+}
+
+/*Common part of the calibrated measurements, only goes to the hardware if the store can't answer*/
+static VirtualSdrError calibrated_measure(struct VirtualSdr* virtual, struct SdrCalibration* calibration, SdrPort inPort, SdrPort outPort, bool iip3, float* result)
+{
+	if(virtual == NULL || calibration == NULL || result == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct PortList* rxPort = find_port(virtual, RX, outPort);
+	if(rxPort == NULL)
+	{
+		return NOPORT;
+	}
+	long frec = rxPort->m_Frec;
+	int bw = rxPort->m_Bw;
+	float gain = rxPort->m_Amp;
+	
+	if(calibration_lookup(calibration, outPort, frec, bw, gain, iip3, result) == OK)
+	{
+		return OK;
+	}
+	
+	VirtualSdrError funcRes = iip3 ? FindIIP3(virtual, inPort, outPort, result) : FindCompressionPoint(virtual, inPort, outPort, result);
+	if(funcRes != OK)
+	{
+		return funcRes;
+	}
+	struct CalibrationList* point = calibration_point(calibration, outPort, frec, bw, gain);
+	if(point == NULL)
+	{
+		return NOMEMORY;
+	}
+	if(iip3)
+	{
+		point->m_IIP3 = result[0];
+		point->m_IIP3Time = time(NULL);
+	}
+	else
+	{
+		point->m_compressionPoint = result[0];
+		point->m_compressionTime = time(NULL);
+	}
+	return OK;
+}
+
+VirtualSdrError CalibratedCompressionPoint(struct VirtualSdr* virtual, struct SdrCalibration* calibration, SdrPort inPort, SdrPort outPort, float* result)
+{
+	return calibrated_measure(virtual, calibration, inPort, outPort, false, result);
+}
+
+VirtualSdrError CalibratedIIP3(struct VirtualSdr* virtual, struct SdrCalibration* calibration, SdrPort inPort, SdrPort outPort, float* result)
+{
+	return calibrated_measure(virtual, calibration, inPort, outPort, true, result);
+}
+
+VirtualSdrError InvalidateCalibration(struct SdrCalibration* calibration, SdrPort port)
+{
+	if(calibration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct CalibrationList** iterPoint = &calibration->m_points;
+	while(*iterPoint != NULL)
+	{
+		if(port == 0 || (*iterPoint)->m_port == port)
+		{
+			struct CalibrationList* aux = *iterPoint;
+			*iterPoint = aux->m_next;
+			free(aux);
+		}
+		else
+		{
+			iterPoint = &(*iterPoint)->m_next;
+		}
+	}
+	return OK;
+}
+
+VirtualSdrError SaveCalibration(struct SdrCalibration* calibration, char* fileName)
+{
+	if(calibration == NULL || fileName == NULL)
+	{
+		return NULLPOINTER;
+	}
+	FILE* stream = fopen(fileName, "wb");
+	if(stream == NULL)
+	{
+		return FILENOTOPEN;
+	}
+	
+	/*Expired values are not worth saving, they are saved as NAN and the points with none are left out*/
+	long long now = time(NULL);
+	uint32_t count = 0;
+	struct CalibrationList* iterPoint = calibration->m_points;
+	while(iterPoint != NULL)
+	{
+		if(calibration_fresh(calibration, iterPoint->m_compressionTime, now) || calibration_fresh(calibration, iterPoint->m_IIP3Time, now))
+		{
+			count++;
+		}
+		iterPoint = iterPoint->m_next;
+	}
+	uint32_t version = CALIBRATIONVERSION;
+	fwrite(CALIBRATIONMAGIC, 1, 4, stream);
+	fwrite(&version, sizeof(uint32_t), 1, stream);
+	fwrite(&count, sizeof(uint32_t), 1, stream);
+	
+	iterPoint = calibration->m_points;
+	while(iterPoint != NULL)
+	{
+		bool freshCp = calibration_fresh(calibration, iterPoint->m_compressionTime, now);
+		bool freshIIP3 = calibration_fresh(calibration, iterPoint->m_IIP3Time, now);
+		if(freshCp || freshIIP3)
+		{
+			uint8_t port = iterPoint->m_port;
+			int64_t frec = iterPoint->m_Frec;
+			int32_t bw = iterPoint->m_Bw;
+			float compressionPoint = freshCp ? iterPoint->m_compressionPoint : NAN;
+			float iip3 = freshIIP3 ? iterPoint->m_IIP3 : NAN;
+			int64_t compressionTime = iterPoint->m_compressionTime;
+			int64_t iip3Time = iterPoint->m_IIP3Time;
+			fwrite(&port, sizeof(uint8_t), 1, stream);
+			fwrite(&frec, sizeof(int64_t), 1, stream);
+			fwrite(&bw, sizeof(int32_t), 1, stream);
+			fwrite(&iterPoint->m_gain, sizeof(float), 1, stream);
+			fwrite(&compressionPoint, sizeof(float), 1, stream);
+			fwrite(&iip3, sizeof(float), 1, stream);
+			fwrite(&compressionTime, sizeof(int64_t), 1, stream);
+			fwrite(&iip3Time, sizeof(int64_t), 1, stream);
+		}
+		iterPoint = iterPoint->m_next;
+	}
+	
+	bool failed = ferror(stream);
+	if(fclose(stream) != 0 || failed)
+	{
+		return FILENOTOPEN;
+	}
+	return OK;
+}
+
+VirtualSdrError LoadCalibration(struct SdrCalibration* calibration, char* fileName)
+{
+	if(calibration == NULL || fileName == NULL)
+	{
+		return NULLPOINTER;
+	}
+	FILE* stream = fopen(fileName, "rb");
+	if(stream == NULL)
+	{
+		return FILENOTOPEN;
+	}
+	
+	char magic [4];
+	uint32_t version, count;
+	if(fread(magic, 1, 4, stream) != 4 || memcmp(magic, CALIBRATIONMAGIC, 4) != 0 || fread(&version, sizeof(uint32_t), 1, stream) != 1 || version < 1 || version > CALIBRATIONVERSION || fread(&count, sizeof(uint32_t), 1, stream) != 1)
+	{
+		fclose(stream);
+		return INVALIDVALUE;
+	}
+	
+	VirtualSdrError funcRes = OK;
+	for(uint32_t i = 0; i < count && funcRes == OK; i++)
+	{
+		uint8_t port;
+		int64_t frec, compressionTime, iip3Time;
+		int32_t bw;
+		float gain, compressionPoint, iip3;
+		if(fread(&port, sizeof(uint8_t), 1, stream) != 1 || fread(&frec, sizeof(int64_t), 1, stream) != 1 || fread(&bw, sizeof(int32_t), 1, stream) != 1 || fread(&gain, sizeof(float), 1, stream) != 1 || fread(&compressionPoint, sizeof(float), 1, stream) != 1 || fread(&iip3, sizeof(float), 1, stream) != 1 || fread(&compressionTime, sizeof(int64_t), 1, stream) != 1)
+		{
+			funcRes = INVALIDVALUE;
+			break;
+		}
+		iip3Time = compressionTime;
+		if(version > 1 && fread(&iip3Time, sizeof(int64_t), 1, stream) != 1)
+		{
+			funcRes = INVALIDVALUE;
+			break;
+		}
+		/*Points in the file replace the ones in memory with the same key*/
+		struct CalibrationList* point = calibration_point(calibration, port, frec, bw, gain);
+		if(point == NULL)
+		{
+			funcRes = NOMEMORY;
+			break;
+		}
+		point->m_compressionPoint = compressionPoint;
+		point->m_IIP3 = iip3;
+		point->m_compressionTime = compressionTime;
+		point->m_IIP3Time = iip3Time;
+	}
+	fclose(stream);
+	return funcRes;
+}
+
+void FreeCalibration(struct SdrCalibration* calibration)
+{
+	if(calibration != NULL)
+	{
+		InvalidateCalibration(calibration, 0);
+	}
+}
+
+VirtualSdrError CopySdrConfig(struct SdrConfig* destination, struct SdrConfig* source)
+{
+	if(destination == NULL || source == NULL)
+	{
+		return NULLPOINTER;
+	}
+	memcpy(destination, source, sizeof(struct SdrConfig));
+	destination->m_channels = NULL;
+	destination->m_ports = NULL;
+	
+	struct ChannelList** iterChannel = &destination->m_channels;
+	for(struct ChannelList* channel = source->m_channels; channel != NULL; channel = channel->m_next)
+	{
+		*iterChannel = (struct ChannelList*) malloc(sizeof(struct ChannelList));
+		if(*iterChannel == NULL)
+		{
+			FreeSdrConfig(destination);
+			return NOMEMORY;
+		}
+		memcpy(*iterChannel, channel, sizeof(struct ChannelList));
+		(*iterChannel)->m_next = NULL;
+		iterChannel = &(*iterChannel)->m_next;
+	}
+	struct PortList** iterPort = &destination->m_ports;
+	for(struct PortList* port = source->m_ports; port != NULL; port = port->m_next)
+	{
+		*iterPort = (struct PortList*) malloc(sizeof(struct PortList));
+		if(*iterPort == NULL)
+		{
+			FreeSdrConfig(destination);
+			return NOMEMORY;
+		}
+		memcpy(*iterPort, port, sizeof(struct PortList));
+		(*iterPort)->m_next = NULL;
+		iterPort = &(*iterPort)->m_next;
+	}
+	return OK;
+}
+
+/*
+	Shared configuration, readers take the current version without locking and writers publish a new copy.
+	Every version counts its own readers, and a version replaced is kept in the retired list until it has none.
+	m_entering only covers a reader between loading the current version and counting itself on it, so a
+	version isn't freed in that window, and readers which overlap don't keep the other versions alive.
+*/
+struct SnapshotList{
+	struct SnapshotList* m_next;
+	atomic_int m_readers;
+	struct SdrConfig m_config;
+};
+
+struct SdrShared{
+	_Atomic(struct SnapshotList*) m_current;
+	atomic_int m_entering;
+	pthread_mutex_t m_writer;
+	struct SnapshotList* m_retired;
+};
+
+static void shared_reclaim(struct SdrShared* shared)
+{
+	if(atomic_load(&shared->m_entering) != 0)
+	{
+		return;
+	}
+	struct SnapshotList** iterSnapshot = &shared->m_retired;
+	while(*iterSnapshot != NULL)
+	{
+		struct SnapshotList* aux = *iterSnapshot;
+		if(atomic_load(&aux->m_readers) == 0)
+		{
+			*iterSnapshot = aux->m_next;
+			FreeSdrConfig(&aux->m_config);
+			free(aux);
+		}
+		else
+		{
+			iterSnapshot = &aux->m_next;
+		}
+	}
+}
+
+VirtualSdrError CreateSharedConfig(struct SdrShared** shared, struct SdrConfig* configuration)
+{
+	if(shared == NULL || configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	*shared = (struct SdrShared*) malloc(sizeof(struct SdrShared));
+	if(*shared == NULL)
+	{
+		return NOMEMORY;
+	}
+	atomic_init(&(*shared)->m_current, NULL);
+	atomic_init(&(*shared)->m_entering, 0);
+	pthread_mutex_init(&(*shared)->m_writer, NULL);
+	(*shared)->m_retired = NULL;
+	
+	VirtualSdrError error = PublishConfig(*shared, configuration);
+	if(error != OK)
+	{
+		FreeSharedConfig(*shared);
+		*shared = NULL;
+	}
+	return error;
+}
+
+VirtualSdrError PublishConfig(struct SdrShared* shared, struct SdrConfig* configuration)
+{
+	if(shared == NULL || configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct SnapshotList* snapshot = (struct SnapshotList*) malloc(sizeof(struct SnapshotList));
+	if(snapshot == NULL)
+	{
+		return NOMEMORY;
+	}
+	atomic_init(&snapshot->m_readers, 0);
+	VirtualSdrError error = CopySdrConfig(&snapshot->m_config, configuration);
+	if(error != OK)
+	{
+		free(snapshot);
+		return error;
+	}
+	
+	pthread_mutex_lock(&shared->m_writer);
+	struct SnapshotList* old = atomic_exchange(&shared->m_current, snapshot);
+	if(old != NULL)
+	{
+		old->m_next = shared->m_retired;
+		shared->m_retired = old;
+	}
+	shared_reclaim(shared);
+	pthread_mutex_unlock(&shared->m_writer);
+	return OK;
+}
+
+VirtualSdrError AcquireConfig(struct SdrShared* shared, struct SdrConfig** configuration)
+{
+	if(shared == NULL || configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	atomic_fetch_add(&shared->m_entering, 1);
+	struct SnapshotList* snapshot = atomic_load(&shared->m_current);
+	atomic_fetch_add(&snapshot->m_readers, 1);
+	atomic_fetch_sub(&shared->m_entering, 1);
+	*configuration = &snapshot->m_config;
+	return OK;
+}
+
+VirtualSdrError ReleaseConfig(struct SdrShared* shared, struct SdrConfig* configuration)
+{
+	if(shared == NULL || configuration == NULL)
+	{
+		return NULLPOINTER;
+	}
+	struct SnapshotList* snapshot = (struct SnapshotList*) ((char*) configuration - offsetof(struct SnapshotList, m_config));
+	if(atomic_fetch_sub(&snapshot->m_readers, 1) == 1 && pthread_mutex_trylock(&shared->m_writer) == 0)
+	{
+		shared_reclaim(shared);
+		pthread_mutex_unlock(&shared->m_writer);
+	}
+	return OK;
+}
+
+void FreeSharedConfig(struct SdrShared* shared)
+{
+	if(shared != NULL)
+	{
+		struct SnapshotList* current = atomic_load(&shared->m_current);
+		if(current != NULL)
+		{
+			current->m_next = shared->m_retired;
+			shared->m_retired = current;
+		}
+		shared_reclaim(shared);
+		pthread_mutex_destroy(&shared->m_writer);
+		free(shared);
+	}
+}
+
+VirtualSdrError SaveConfiguration(struct SdrConfig* confFile, char* fileName)
+{
+	if(confFile == NULL)
+	{
+		return NULLPOINTER;
+	}
+	
+	FILE* stream = fopen(fileName, "w");
+	if(stream == NULL)
+	{
+		return FILENOTOPEN;
+	}
+	fprintf(stream, "A,%s,%i,%i,%i,%ld,%ld,%ld\n", confFile->m_location, confFile->m_connectionType, confFile->m_activeRxChannel, confFile->m_activeTxChannel, confFile->m_minFS, confFile->m_maxFS, confFile->m_FS);
+	struct ChannelList* iterCh = confFile->m_channels;
+	while(iterCh != NULL)
+	{
+		fprintf(stream, "C,%c,%i,%ld,%ld,%ld,%ld,%f,%f,%i,%i\n", iterCh->m_channel, iterCh->m_type == TX, iterCh->m_minFS, iterCh->m_maxFS, iterCh->m_minFrec, iterCh->m_maxFrec, iterCh->m_minAmp, iterCh->m_maxAmp, iterCh->m_minBw, iterCh->m_maxBw);
+		iterCh = iterCh->m_next;
+	}
+	
+	struct PortList* iterP = confFile->m_ports;
+	while(iterP != NULL)
+	{
+		fprintf(stream, "P,%c,%i,%i,%ld,%f,%i\n", iterP->m_channel, iterP->m_type == TX, iterP->m_port, iterP->m_Frec, iterP->m_Amp, iterP->m_Bw);
+		iterP = iterP->m_next;
+	}
+	fclose(stream);
+	return OK;
+}
+
+VirtualSdrError LoadConfiguration(struct SdrConfig* confFile, char* fileName)
+{
+	if(confFile == NULL)
+	{
+		return NULLPOINTER;
+	}
+	FILE* stream = fopen(fileName, "r");
+	if(stream == NULL)
+	{
+		return FILENOTOPEN;
+	}
+	
+	char* csvParam;
+	char line[1024];
+	char* tok;
+	char* savePtr;
+	bool firstCh = true;
+	bool firstP = true;
+	while(NULL != fgets(line, 1024, stream))
+	{
+		csvParam = strdup(line);
+    		tok = strtok_r(line, ",", &savePtr);
+    		switch (tok[0])
+    		{
+    			case 'A': 
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				strcpy(confFile->m_location, tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				confFile->m_connectionType = atoi(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				confFile->m_activeRxChannel = atoi(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				confFile->m_activeTxChannel = atoi(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				confFile->m_minFS = atol(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				confFile->m_maxFS = atol(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				confFile->m_FS = atol(tok);
+    				break;
+    			case 'C': 
+    				struct ChannelList* iterCh = (struct ChannelList*)malloc(sizeof(struct ChannelList));
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_channel = tok[0];
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_type = atoi(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_minFS = atol(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_maxFS = atol(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_minFrec = atol(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_maxFrec = atol(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_minAmp = atof(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_maxAmp = atof(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_minBw = atoi(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterCh->m_maxBw = atoi(tok);
+    				
+    				if(firstCh)
+    				{
+    					iterCh->m_next = NULL;
+    					confFile->m_channels = iterCh;
+    					firstCh = false;
+    				}
+    				else
+    				{
+	    				struct ChannelList* auxCh;
+	    				auxCh = confFile->m_channels;
+	    				confFile->m_channels = iterCh;
+	    				iterCh->m_next = auxCh;
+    				}
+    				break;
+    			case 'P': 
+    				struct PortList* iterP = (struct PortList*)malloc(sizeof(struct PortList));
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterP->m_channel = tok[0];
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterP->m_type = atoi(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterP->m_port = atoi(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterP->m_Frec = atol(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterP->m_Amp = atof(tok);
+    				tok = strtok_r(NULL, ",\n", &savePtr);
+    				iterP->m_Bw = atoi(tok);
+    				
+    				if(firstP)
+    				{
+    					iterP->m_next = NULL;
+    					confFile->m_ports = iterP;
+    					firstP = false;
+    				}
+    				else
+    				{
+	    				struct PortList* auxP;
+	    				auxP = confFile->m_ports;
+	    				confFile->m_ports = iterP;
+	    				iterP->m_next = auxP;
+    				}
+    				break;
+    		}
+
+	}
+	
+	fclose(stream);
+	return OK;
+}
+
+VirtualSdrError TransmitFromFileOnce(struct VirtualSdr* virtual ,SdrPort port ,char* dataFile)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	
+	FILE* stream = fopen(dataFile, "r");
+	if(stream == NULL)
+	{
+		return FILENOTOPEN;
+	}
+	int counterLines = 0;
+	char line [64];
+	while(NULL != fgets(line, 64, stream))
+	{
+		counterLines++;
+	}
+	fclose(stream);
+	
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	while(portIter != NULL){
+		if(portIter->m_type == TX && portIter->m_port == port)
+		{
+			virtual->m_function[iter] = TXFILEONCE;
+			virtual->m_fileName[iter] = (char*) malloc(sizeof(char)*(strlen(dataFile)+1));
+			strcpy(virtual->m_fileName[iter], dataFile);
+			virtual->m_IList[iter] = (float*) malloc(counterLines*sizeof(float));
+			virtual->m_QList[iter] = (float*) malloc(counterLines*sizeof(float));
+			
+			stream = fopen(dataFile, "r");
+			if(stream == NULL)
+			{
+				return FILENOTOPEN;
+			}
+			
+			for(int i = 0; i < counterLines; i++)
+			{
+				char* tok;
+				char* savePtr;
+				char* param;
+
+				param = strdup(line);
+		    		tok = strtok_r(line, ",", &savePtr);				
+				virtual->m_IList[iter][i] = atof(tok);
+				tok = strtok_r(NULL, ",\n", &savePtr);
+				virtual->m_QList[iter][i] = atof(tok);
+			}
+			fclose(stream);
+			return OK;
+		}
+		iter++;
+		portIter = portIter->m_next;
+	}
+	
+	return NOPORT;
+}
+
+VirtualSdrError TransmitFromFile(struct VirtualSdr* virtual,SdrPort port, char* dataFile)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	
+	FILE* stream = fopen(dataFile, "r");
+	if(stream == NULL)
+	{
+		return FILENOTOPEN;
+	}
+	int counterLines = 0;
+	char line [64];
+	while(NULL != fgets(line, 64, stream))
+	{
+		counterLines++;
+	}
+	fclose(stream);
+	
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	while(portIter != NULL){
+		if(portIter->m_type == TX && portIter->m_port == port)
+		{
+			virtual->m_function[iter] = TXFILECONTINUOUSLY;
+			virtual->m_fileName[iter] = (char*) malloc(sizeof(char)*(strlen(dataFile)+1));
+			strcpy(virtual->m_fileName[iter], dataFile);
+			virtual->m_IList[iter] = (float*) malloc(counterLines*sizeof(float));
+			virtual->m_QList[iter] = (float*) malloc(counterLines*sizeof(float));
+			
+			stream = fopen(dataFile, "r");
+			if(stream == NULL)
+			{
+				return FILENOTOPEN;
+			}
+			
+			for(int i = 0; i < counterLines; i++)
+			{
+				char* tok;
+				char* savePtr;
+				char* param;
+
+				param = strdup(line);
+		    		tok = strtok_r(line, ",", &savePtr);				
+				virtual->m_IList[iter][i] = atof(tok);
+				tok = strtok_r(NULL, ",\n", &savePtr);
+				virtual->m_QList[iter][i] = atof(tok);
+			}
+			fclose(stream);
+			return OK;
+		}
+		iter++;
+		portIter = portIter->m_next;
+	}
+	
+	return NOPORT;
+}
+
+VirtualSdrError ReceiveToFile(struct VirtualSdr* virtual, SdrPort port, int dataLen, char* dataFile)
+{
+	if(virtual == NULL)
+	{
+		return NULLPOINTER;
+	}
+	
+	struct PortList* portIter = virtual->m_ports;
+	int iter = 0;
+	while(portIter != NULL){
+		if(portIter->m_type == RX && portIter->m_port == port)
+		{
+			virtual->m_function[iter] = RXFILE;
+			virtual->m_fileName[iter] = (char*) malloc(sizeof(char)*(strlen(dataFile)+1));
+			strcpy(virtual->m_fileName[iter], dataFile);
+			virtual->m_LengthBuffer[iter] = dataLen;
+			virtual->m_IList[iter] = (float*)malloc(dataLen*sizeof(float));
+			virtual->m_QList[iter] = (float*)malloc(dataLen*sizeof(float));
+			return OK;
+		}
+		iter++;
+		portIter = portIter->m_next;
+	}
+	
+	return NOPORT;
+}
+
+/*
+	Recorder of streaming ports. The stage copies every block to a ring of slots and a writer thread moves them
+	to the disk in chunks of RECORDERCHUNK bytes, aligned for O_DIRECT. The capture thread never waits for the
+	disk, if the ring is full the block is dropped and counted. Samples are saved as interleaved float I/Q, or as
+	blocks of the codec below encoded by a pool of threads before the writer takes them.
+	
+	Every data file has its SigMF metadata, and the recording has one index of entries (sample of the port,
+	position in the recording, byte offset in the concatenated files, UTC time in ns) every RECORDERINDEXSTEP
+	samples, at every gap and at the end, so a reader can seek to a time without scanning the data. Compressed
+	data files aren't cf32_le, so they take the RECORDERCOMPRESSEDEXT extension instead of .sigmf-data.
+*/
+#define RECORDERCHUNK (1 << 22)
+#define RECORDERALIGN 4096
+#define RECORDERINDEXSTEP (1 << 20)
+#define RECORDERINDEXMAGIC "SDRI"
+#define RECORDERINDEXVERSION 2
+#define RECORDERINDEXHEADER 6
+#define RECORDERCOMPRESSED 0x01
+#define RECORDERCOMPRESSEDEXT "sdrapi-data"
+
+/*Name of a data file of a recording*/
+static void recording_data_name(char* fileName, size_t size, char* baseName, int file, bool compressed)
+{
+	snprintf(fileName, size, "%s_%04d.%s", baseName, file, compressed ? RECORDERCOMPRESSEDEXT : "sigmf-data");
+}
+
+struct RecorderSlot{
+	float* m_data;
+	int m_length;
+	int m_capacity;
+	unsigned long long m_sample;
+	unsigned long long m_time;
+	uint8_t* m_packed;
+	int m_packedBytes;
+	int m_packedCapacity;
+	bool m_ready;
+};
+
+struct IndexEntry{
+	unsigned long long m_sample;
+	unsigned long long m_position;
+	unsigned long long m_offset;
+	unsigned long long m_time;
+};
+
+/*
+	Lossless codec of the recordings. The samples come from the 12 bit converter divided by 2^11-1, so they are
+	turned back to integers and checked to give the same float. A block is saved as a header (samples, bytes,
+	mode and Rice parameters) and the smallest of: packed in 12 bits or Rice coded, of the samples or of their
+	differences. Blocks with other values, like the output of a filter, are saved as the raw floats.
+*/
+#define CODECHEADER 12
+#define CODECRAW 0
+#define CODECPACK 1
+#define CODECRICE 2
+#define CODECDELTA 0x80
+#define CODECESCAPE 24
+#define CODECESCAPEBITS 18
+#define CODECSCALE 2047.0
+
+struct BitWriter{
+	uint8_t* m_data;
+	int m_bytes;
+	uint64_t m_acc;
+	int m_bits;
+};
+
+struct BitReader{
+	const uint8_t* m_data;
+	int m_bytes;
+	int m_pos;
+	uint64_t m_acc;
+	int m_bits;
+};
+
+static inline uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t) value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline void bits_put(struct BitWriter* writer, uint32_t value, int bits)
+{
+	writer->m_acc |= (uint64_t) value << writer->m_bits;
+	writer->m_bits += bits;
+	while(writer->m_bits >= 8)
+	{
+		writer->m_data[writer->m_bytes++] = (uint8_t) writer->m_acc;
+		writer->m_acc >>= 8;
+		writer->m_bits -= 8;
+	}
+}
+
+static inline void bits_fill(struct BitReader* reader)
+{
+	while(reader->m_bits <= 56)
+	{
+		reader->m_acc |= (uint64_t)(reader->m_pos < reader->m_bytes ? reader->m_data[reader->m_pos] : 0) << reader->m_bits;
+		reader->m_pos++;
+		reader->m_bits += 8;
+	}
+}
+
+static inline uint32_t bits_get(struct BitReader* reader, int bits)
+{
+	bits_fill(reader);
+	uint32_t value = reader->m_acc & ((1ULL << bits) - 1);
+	reader->m_acc >>= bits;
+	reader->m_bits -= bits;
+	return value;
+}
+
+/*Rice code of a value: the quotient in unary and k bits, or the escape and the value if the quotient is too long*/
+static inline void rice_put(struct BitWriter* writer, uint32_t value, int k)
+{
+	uint32_t q = value >> k;
+	if(q < CODECESCAPE)
+	{
+		bits_put(writer, (1U << q) - 1, q + 1);
+		bits_put(writer, value & ((1U << k) - 1), k);
+	}
+	else
+	{
+		bits_put(writer, (1U << CODECESCAPE) - 1, CODECESCAPE);
+		bits_put(writer, value, CODECESCAPEBITS);
+	}
+}
+
+static inline uint32_t rice_get(struct BitReader* reader, int k)
+{
+	bits_fill(reader);
+	int q = __builtin_ctzll(~reader->m_acc);
+	if(q >= CODECESCAPE)
+	{
+		reader->m_acc >>= CODECESCAPE;
+		reader->m_bits -= CODECESCAPE;
+		return bits_get(reader, CODECESCAPEBITS);
+	}
+	reader->m_acc >>= q + 1;
+	reader->m_bits -= q + 1;
+	return ((uint32_t) q << k) | bits_get(reader, k);
+}
+
+static int codec_header(uint8_t* out, int len, int payload, int mode, int kI, int kQ)
+{
+	uint32_t fields[2] = {(uint32_t) len, (uint32_t) payload};
+	memcpy(out, fields, sizeof(fields));
+	out[8] = mode;
+	out[9] = kI;
+	out[10] = kQ;
+	out[11] = 0;
+	return CODECHEADER + payload;
+}
+
+/*Samples and bytes after the header of a block, false if the header isn't valid*/
+static bool codec_block(const uint8_t* in, int* len, int* payload)
+{
+	uint32_t fields[2];
+	memcpy(fields, in, sizeof(fields));
+	int mode = in[8] & ~CODECDELTA;
+	if(fields[0] == 0 || fields[0] > (1U << 26) || fields[1] > 8*fields[0] || mode > CODECRICE || in[9] > 16 || in[10] > 16)
+	{
+		return false;
+	}
+	*len = fields[0];
+	*payload = fields[1];
+	return true;
+}
+
+/*Encodes len interleaved I/Q samples in out, which has room for CODECHEADER + 8*len bytes. Returns the bytes used*/
+static int codec_encode(const float* data, int len, int32_t* values, uint8_t* out)
+{
+	unsigned long long sum[2] = {0, 0};
+	unsigned long long deltaSum[2] = {0, 0};
+	bool packable = true;
+	bool exact = true;
+	for(int i = 0; i < 2*len && exact; i++)
+	{
+		long value = lrintf(data[i]*(float) CODECSCALE);
+		float back = (float)((float) value/CODECSCALE);
+		exact = value >= INT16_MIN && value <= INT16_MAX && memcmp(&back, &data[i], sizeof(float)) == 0;
+		packable = packable && value >= -2048 && value <= 2047;
+		values[i] = value;
+		sum[i&1] += zigzag(values[i]);
+		deltaSum[i&1] += zigzag(i >= 2 ? values[i] - values[i-2] : values[i]);
+	}
+	if(!exact)
+	{
+		memcpy(out + CODECHEADER, data, 2*len*sizeof(float));
+		return codec_header(out, len, 2*len*sizeof(float), CODECRAW, 0, 0);
+	}
+	
+	bool delta = deltaSum[0] + deltaSum[1] < sum[0] + sum[1];
+	int k[2];
+	for(int c = 0; c < 2; c++)
+	{
+		unsigned long long total = delta ? deltaSum[c] : sum[c];
+		k[c] = 0;
+		while(k[c] < 16 && ((unsigned long long) len << (k[c] + 1)) <= total)
+		{
+			k[c]++;
+		}
+	}
+	unsigned long long riceBits = 0;
+	for(int i = 0; i < 2*len; i++)
+	{
+		uint32_t q = zigzag(delta && i >= 2 ? values[i] - values[i-2] : values[i]) >> k[i&1];
+		riceBits += q < CODECESCAPE ? q + 1 + k[i&1] : CODECESCAPE + CODECESCAPEBITS;
+	}
+	
+	if(packable && 24ULL*len <= riceBits)
+	{
+		uint8_t* p = out + CODECHEADER;
+		for(int i = 0; i < len; i++)
+		{
+			uint32_t a = values[2*i] & 0xFFF;
+			uint32_t b = values[2*i+1] & 0xFFF;
+			p[3*i] = a;
+			p[3*i+1] = (a >> 8) | (b << 4);
+			p[3*i+2] = b >> 4;
+		}
+		return codec_header(out, len, 3*len, CODECPACK, 0, 0);
+	}
+	if(riceBits >= 64ULL*len)
+	{
+		memcpy(out + CODECHEADER, data, 2*len*sizeof(float));
+		return codec_header(out, len, 2*len*sizeof(float), CODECRAW, 0, 0);
+	}
+	struct BitWriter writer = {out + CODECHEADER, 0, 0, 0};
+	for(int i = 0; i < 2*len; i++)
+	{
+		rice_put(&writer, zigzag(delta && i >= 2 ? values[i] - values[i-2] : values[i]), k[i&1]);
+	}
+	bits_put(&writer, 0, 7);
+	return codec_header(out, len, writer.m_bytes, CODECRICE | (delta ? CODECDELTA : 0), k[0], k[1]);
+}
+
+/*Decodes a whole block to interleaved I/Q, returns the samples or -1 if it's damaged*/
+static int codec_decode(const uint8_t* in, int bytes, float* data, int capacity)
+{
+	int len;
+	int payload;
+	if(bytes < CODECHEADER || !codec_block(in, &len, &payload) || len > capacity || CODECHEADER + payload > bytes)
+	{
+		return -1;
+	}
+	const uint8_t* p = in + CODECHEADER;
+	switch(in[8] & ~CODECDELTA)
+	{
+		case CODECRAW:
+			if(payload != (int)(2*len*sizeof(float)))
+			{
+				return -1;
+			}
+			memcpy(data, p, payload);
+			break;
+		case CODECPACK:
+			if(payload != 3*len)
+			{
+				return -1;
+			}
+			for(int i = 0; i < len; i++)
+			{
+				int32_t a = p[3*i] | ((p[3*i+1] & 0x0F) << 8);
+				int32_t b = (p[3*i+1] >> 4) | (p[3*i+2] << 4);
+				data[2*i] = (float)((float)((a ^ 0x800) - 0x800)/CODECSCALE);
+				data[2*i+1] = (float)((float)((b ^ 0x800) - 0x800)/CODECSCALE);
+			}
+			break;
+		default:
+		{
+			struct BitReader reader = {p, payload, 0, 0, 0};
+			int32_t previous[2] = {0, 0};
+			bool delta = (in[8] & CODECDELTA) != 0;
+			for(int i = 0; i < 2*len; i++)
+			{
+				int32_t value = unzigzag(rice_get(&reader, in[9 + (i&1)]));
+				if(delta)
+				{
+					value += previous[i&1];
+					previous[i&1] = value;
+				}
+				data[i] = (float)((float) value/CODECSCALE);
+			}
+			if(reader.m_pos - reader.m_bits/8 > payload)
+			{
+				return -1;
+			}
+			break;
+		}
 	}
-	
-	return 1;
+	return len;
 }
 
-VirtualSdrError SetConnection(struct SdrConfig* configuration, SdrConnectionType type, char* location)
+/*
+	Preview pyramid of a recording. Level 0 has an entry every PREVIEWBLOCK samples and every level above joins
+	PREVIEWFACTOR entries of the one below, each level is a file base.previewN of SdrPreviewEntry. Powers are
+	kept linear while the entries are filled and saved in dB.
+*/
+#define PREVIEWBLOCK 65536
+#define PREVIEWFACTOR 16
+
+struct PreviewLevel{
+	FILE* m_file;
+	float m_min;
+	float m_max;
+	double m_sum;
+	unsigned long long m_samples;
+	double m_spectrum[PREVIEWBINS];
+	int m_children;
+};
+
+struct SdrPreview{
+	struct PreviewLevel m_levels[PREVIEWLEVELS];
+	struct SpectrumAnalyzer* m_analyzer;
+};
+
+static void preview_reset(struct PreviewLevel* level)
 {
-	if(location == NULL || configuration == NULL)
+	level->m_min = INFINITY;
+	level->m_max = 0;
+	level->m_sum = 0;
+	level->m_samples = 0;
+	level->m_children = 0;
+	for(int k = 0; k < PREVIEWBINS; k++)
 	{
-		return NULLPOINTER;
+		level->m_spectrum[k] = 0;
 	}
-	configuration->m_connectionType = type;
-	strcpy(configuration->m_location,location);
-	return OK;
 }
 
-VirtualSdrError GetConnection(struct SdrConfig* configuration, SdrConnectionType* type, char* location)
+/*Saves the entry of a level and adds it to the level above, which is saved when it has all its entries*/
+static void preview_emit(struct SdrPreview* preview, int iter)
 {
-	if(location == NULL || type == NULL || configuration == NULL)
+	struct PreviewLevel* level = &preview->m_levels[iter];
+	struct SdrPreviewEntry entry;
+	int children = level->m_children > 0 ? level->m_children : 1;
+	entry.m_min = 10*log10f(level->m_min + 1e-20f);
+	entry.m_max = 10*log10f(level->m_max + 1e-20f);
+	entry.m_rms = 10*log10f(level->m_sum/level->m_samples + 1e-20f);
+	for(int k = 0; k < PREVIEWBINS; k++)
 	{
-		return NULLPOINTER;
+		entry.m_spectrum[k] = 10*log10f(level->m_spectrum[k]/children + 1e-20f);
 	}
-	*type = configuration->m_connectionType;
-	strcpy(location,configuration->m_location);
-	return OK;
+	fwrite(&entry, sizeof(struct SdrPreviewEntry), 1, level->m_file);
+	
+	if(iter + 1 < PREVIEWLEVELS)
+	{
+		struct PreviewLevel* up = &preview->m_levels[iter + 1];
+		up->m_min = level->m_min < up->m_min ? level->m_min : up->m_min;
+		up->m_max = level->m_max > up->m_max ? level->m_max : up->m_max;
+		up->m_sum += level->m_sum;
+		up->m_samples += level->m_samples;
+		for(int k = 0; k < PREVIEWBINS; k++)
+		{
+			up->m_spectrum[k] += level->m_spectrum[k]/children;
+		}
+		up->m_children++;
+		if(up->m_children == PREVIEWFACTOR)
+		{
+			preview_emit(preview, iter + 1);
+		}
+	}
+	preview_reset(level);
 }
 
-VirtualSdrError ChangeRxChannel(struct SdrConfig* configuration, SdrChannel channel)
+/*Closes the entry of level 0 with the spectrum of its samples*/
+static void preview_block(struct SdrPreview* preview)
 {
-	if(configuration == NULL)
+	struct PreviewLevel* level = &preview->m_levels[0];
+	struct SpectrumAnalyzer* analyzer = preview->m_analyzer;
+	for(int k = 0; k < PREVIEWBINS; k++)
 	{
-		return NULLPOINTER;
+		level->m_spectrum[k] = analyzer->m_count > 0 ? analyzer->m_power[k]/analyzer->m_count : 0;
 	}
-	bool found = false;
-	struct ChannelList* iterator = configuration->m_channels;
-	while(!found && iterator != NULL)
+	ResetSpectrum(analyzer);
+	preview_emit(preview, 0);
+}
+
+static void preview_push(struct SdrPreview* preview, float* data, int len)
+{
+	struct PreviewLevel* level = &preview->m_levels[0];
+	float I_rx[PREVIEWBINS];
+	float Q_rx[PREVIEWBINS];
+	int read = 0;
+	while(read < len)
 	{
-		if(iterator->m_type == RX && iterator->m_channel == channel)
+		int n = len - read < PREVIEWBINS ? len - read : PREVIEWBINS;
+		if(n > PREVIEWBLOCK - (int) level->m_samples)
 		{
-			found = true;
+			n = PREVIEWBLOCK - level->m_samples;
 		}
-		else
+		for(int i = 0; i < n; i++)
 		{
-			iterator = iterator->m_next;
+			I_rx[i] = data[2*(read+i)];
+			Q_rx[i] = data[2*(read+i)+1];
+			float power = I_rx[i]*I_rx[i] + Q_rx[i]*Q_rx[i];
+			level->m_min = power < level->m_min ? power : level->m_min;
+			level->m_max = power > level->m_max ? power : level->m_max;
+			level->m_sum += power;
+		}
+		SpectrumAnalyzerPush(preview->m_analyzer, I_rx, Q_rx, n);
+		level->m_samples += n;
+		read += n;
+		if(level->m_samples == PREVIEWBLOCK)
+		{
+			preview_block(preview);
 		}
 	}
-	if(!found)
-	{
-		return NOCHANNEL;
-	}
-	configuration->m_activeRxChannel = channel;
-	return OK;
 }
 
-VirtualSdrError GetRxChannel(struct SdrConfig* configuration, SdrChannel* buffer)
+static void free_preview(struct SdrPreview* preview)
 {
-	if(configuration == NULL || buffer == NULL)
+	if(preview != NULL)
 	{
-		return NULLPOINTER;
+		for(int iter = 0; iter < PREVIEWLEVELS; iter++)
+		{
+			if(preview->m_levels[iter].m_file != NULL)
+			{
+				fclose(preview->m_levels[iter].m_file);
+			}
+		}
+		FreeSpectrumAnalyzer(preview->m_analyzer);
+		free(preview);
 	}
-	buffer = & configuration->m_activeRxChannel;
-	return OK;
 }
 
-VirtualSdrError ChangeTxChannel(struct SdrConfig* configuration, SdrChannel channel)
+/*Saves the entries not complete of every level, from the bottom so each one reaches the level above*/
+static void close_preview(struct SdrPreview* preview)
 {
-		if(configuration == NULL)
+	if(preview->m_levels[0].m_samples > 0)
 	{
-		return NULLPOINTER;
+		preview_block(preview);
 	}
-	bool found = false;
-	struct ChannelList* iterator = configuration->m_channels;
-	while(!found && iterator != NULL)
+	for(int iter = 1; iter < PREVIEWLEVELS; iter++)
 	{
-		if(iterator->m_type == TX && iterator->m_channel == channel)
-		{
-			found = true;
-		}
-		else
+		if(preview->m_levels[iter].m_children > 0)
 		{
-			iterator = iterator->m_next;
+			preview_emit(preview, iter);
 		}
 	}
-	if(!found)
+}
+
+static VirtualSdrError create_preview(struct SdrPreview** preview, char* baseName)
+{
+	struct SdrPreview* aux = (struct SdrPreview*) calloc(1, sizeof(struct SdrPreview));
+	if(aux == NULL)
 	{
-		return NOCHANNEL;
+		return NOMEMORY;
 	}
-	configuration->m_activeTxChannel = channel;
+	VirtualSdrError error = CreateSpectrumAnalyzer(&aux->m_analyzer, PREVIEWBINS, 0, AVERAGELINEAR, 0);
+	if(error != OK)
+	{
+		free_preview(aux);
+		return error;
+	}
+	for(int iter = 0; iter < PREVIEWLEVELS; iter++)
+	{
+		char fileName[300];
+		snprintf(fileName, sizeof(fileName), "%s.preview%d", baseName, iter);
+		aux->m_levels[iter].m_file = fopen(fileName, "wb");
+		if(aux->m_levels[iter].m_file == NULL)
+		{
+			free_preview(aux);
+			return FILENOTOPEN;
+		}
+		preview_reset(&aux->m_levels[iter]);
+	}
+	*preview = aux;
 	return OK;
 }
 
-VirtualSdrError GetTxChannel(struct SdrConfig* configuration, SdrChannel* buffer)
+struct SdrRecorder{
+	char m_baseName[256];
+	struct RecorderOptions m_options;
+	struct RecorderSlot* m_slots;
+	int m_head;
+	int m_count;
+	int m_claimed;
+	pthread_mutex_t m_lock;
+	pthread_cond_t m_filled;
+	bool m_stop;
+	pthread_t m_thread;
+	pthread_t* m_codecThreads;
+	int m_codecRunning;
+	
+	/*Only used by the writer thread*/
+	int m_fd;
+	bool m_direct;
+	long long m_fileBytes;
+	unsigned long long m_fileStart;
+	char* m_chunk;
+	int m_chunkUsed;
+	FILE* m_indexFile;
+	struct IndexEntry* m_index;
+	int m_indexLength;
+	int m_indexCapacity;
+	unsigned long long m_offset;
+	unsigned long long m_position;
+	unsigned long long m_expected;
+	unsigned long long m_endTime;
+	struct SdrPreview* m_preview;
+	
+	/*Virtual SDR and port recorded, set by AttachRecorder and cleared by DetachRecorder*/
+	struct VirtualSdr* m_virtual;
+	SdrPort m_port;
+	long m_FS;
+	long m_frec;
+	float m_gain;
+	long long m_realtime;
+	
+	atomic_int m_files;
+	atomic_ullong m_bytes;
+	atomic_ullong m_samples;
+	atomic_ullong m_dropped;
+	atomic_ullong m_errors;
+	unsigned long long m_start;
+};
+
+static void recorder_close(struct SdrRecorder* recorder)
 {
-	if(configuration == NULL || buffer == NULL)
+	if(recorder->m_fd >= 0)
 	{
-		return NULLPOINTER;
+		if(recorder->m_options.m_rotateBytes > 0)
+		{
+			if(ftruncate(recorder->m_fd, recorder->m_fileBytes) < 0)
+			{
+				atomic_fetch_add(&recorder->m_errors, 1);
+			}
+		}
+		close(recorder->m_fd);
+		recorder->m_fd = -1;
 	}
-	buffer = & configuration->m_activeTxChannel;
-	return OK;
 }
 
-VirtualSdrError SetRxFrec(struct SdrConfig* configuration, SdrPort port, long f)
+/*Metadata of a file, which starts with the block of the slot*/
+static void recorder_meta(struct SdrRecorder* recorder, int file, struct RecorderSlot* slot)
 {
-	if(configuration == NULL)
+	char fileName[300];
+	char date[64];
+	snprintf(fileName, sizeof(fileName), "%s_%04d.sigmf-meta", recorder->m_baseName, file);
+	FILE* stream = fopen(fileName, "w");
+	if(stream == NULL)
 	{
-		return NULLPOINTER;
+		atomic_fetch_add(&recorder->m_errors, 1);
+		return;
 	}
-	if(configuration->m_activeRxChannel == 0)
+	
+	unsigned long long time = slot->m_time + recorder->m_realtime;
+	time_t seconds = time/1000000000ULL;
+	struct tm utc;
+	gmtime_r(&seconds, &utc);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &utc);
+	
+	fprintf(stream, "{\n\t\"global\": {\n");
+	if(recorder->m_options.m_codecThreads > 0)
 	{
-		return CHANNELNOTDEFINED;
+		fprintf(stream, "\t\t\"sdrapi:datatype\": \"sdrapi-lossless\",\n");
 	}
-		struct ChannelList* iterChannelList = configuration->m_channels;
-	while (iterChannelList != NULL)
+	else
 	{
-		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
-		{
-			struct PortList * aux = configuration->m_ports;
-			while(aux != NULL)
-			{
-				if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
-				{
-					if(f > iterChannelList->m_maxFrec)
-					{
-						aux->m_Frec = iterChannelList->m_maxFrec;
-						return VALUEAPROXMAX;
-					}
-					if(f < iterChannelList->m_minFrec)
-					{
-						aux->m_Frec = iterChannelList->m_minFrec;
-						return VALUEAPROXMIN;
-					}
-					aux->m_Frec = f;
-					return OK;
-				}
-				aux = aux->m_next;
-			}
-			return NOPORT;
-		}
-		iterChannelList = iterChannelList->m_next;
+		fprintf(stream, "\t\t\"core:datatype\": \"cf32_le\",\n");
 	}
-	return CHANNELNOTDEFINED;
+	fprintf(stream, "\t\t\"core:sample_rate\": %ld,\n", recorder->m_FS);
+	fprintf(stream, "\t\t\"core:version\": \"1.0.0\",\n");
+	fprintf(stream, "\t\t\"core:hw\": \"AD9361\",\n");
+	fprintf(stream, "\t\t\"sdrapi:codec\": \"%s\",\n", recorder->m_options.m_codecThreads > 0 ? "sdrapi-lossless" : "none");
+	fprintf(stream, "\t\t\"sdrapi:port\": %d,\n", recorder->m_port);
+	fprintf(stream, "\t\t\"sdrapi:gain\": %f\n", recorder->m_gain);
+	fprintf(stream, "\t},\n\t\"captures\": [\n\t\t{\n");
+	fprintf(stream, "\t\t\t\"core:sample_start\": 0,\n");
+	fprintf(stream, "\t\t\t\"core:global_index\": %llu,\n", recorder->m_position);
+	fprintf(stream, "\t\t\t\"core:frequency\": %ld,\n", recorder->m_frec);
+	fprintf(stream, "\t\t\t\"core:datetime\": \"%s.%09lluZ\"\n", date, time%1000000000ULL);
+	fprintf(stream, "\t\t}\n\t],\n\t\"annotations\": []\n}\n");
+	fclose(stream);
 }
 
-VirtualSdrError GetRxFrec(struct SdrConfig* configuration, SdrPort port, long* f)
+/*Opens the next file of the recording, preallocated to the rotation size so the writes don't extend it*/
+static bool recorder_open(struct SdrRecorder* recorder, struct RecorderSlot* slot)
 {
-	if(configuration == NULL)
+	char fileName[300];
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	
+	recorder_close(recorder);
+	recorder_meta(recorder, atomic_load(&recorder->m_files), slot);
+	recording_data_name(fileName, sizeof(fileName), recorder->m_baseName, atomic_load(&recorder->m_files), recorder->m_options.m_codecThreads > 0);
+	recorder->m_direct = recorder->m_options.m_direct != 0;
+	recorder->m_fd = open(fileName, flags | (recorder->m_direct ? O_DIRECT : 0), 0644);
+	if(recorder->m_fd < 0 && recorder->m_direct)
 	{
-		return NULLPOINTER;
+		recorder->m_direct = false;
+		recorder->m_fd = open(fileName, flags, 0644);
 	}
-	if(configuration->m_activeRxChannel == 0)
+	if(recorder->m_fd < 0)
 	{
-		return CHANNELNOTDEFINED;
+		return false;
 	}
-	struct PortList * aux = configuration->m_ports;
-	while(aux != NULL)
+	if(recorder->m_options.m_rotateBytes > 0)
 	{
-		if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+		posix_fallocate(recorder->m_fd, 0, recorder->m_options.m_rotateBytes);
+	}
+	recorder->m_fileBytes = 0;
+	recorder->m_fileStart = now_ns();
+	atomic_fetch_add(&recorder->m_files, 1);
+	return true;
+}
+
+static void recorder_write(struct SdrRecorder* recorder, char* data, int len)
+{
+	METRIC_BEGIN(fileWrite);
+	int written = 0;
+	while(written < len)
+	{
+		ssize_t res = write(recorder->m_fd, data + written, len - written);
+		if(res < 0 && errno == EINTR)
 		{
-			f[0] = aux->m_Frec;
-			return OK;
+			continue;
 		}
-		aux = aux->m_next;
+		if(res <= 0)
+		{
+			atomic_fetch_add(&recorder->m_errors, 1);
+			break;
+		}
+		written += res;
 	}
-	f[0] = -1;
-	return NOPORT;
+	recorder->m_fileBytes += written;
+	atomic_fetch_add(&recorder->m_bytes, written);
+	METRIC_END(METRICFILE, fileWrite, written);
 }
 
-VirtualSdrError SetTxFrec(struct SdrConfig* configuration, SdrPort port, long f)
+static void recorder_flush(struct SdrRecorder* recorder, bool last)
 {
-	if(configuration == NULL)
+	if(recorder->m_chunkUsed == 0)
 	{
-		return NULLPOINTER;
+		return;
 	}
-	if(configuration->m_activeTxChannel == 0)
+	if(recorder->m_fd < 0)
 	{
-		return CHANNELNOTDEFINED;
+		atomic_fetch_add(&recorder->m_errors, 1);
+		recorder->m_chunkUsed = 0;
+		return;
 	}
-	struct ChannelList* iterChannelList = configuration->m_channels;
-	while (iterChannelList != NULL)
+	if(last && recorder->m_direct && recorder->m_chunkUsed%RECORDERALIGN != 0)
 	{
-		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
-		{
-			struct PortList * aux = configuration->m_ports;
-			while(aux != NULL)
-			{
-				if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
-				{
-					if(f > iterChannelList->m_maxFrec)
-					{
-						aux->m_Frec = iterChannelList->m_maxFrec;
-						return VALUEAPROXMAX;
-					}
-					if(f < iterChannelList->m_minFrec)
-					{
-						aux->m_Frec = iterChannelList->m_minFrec;
-						return VALUEAPROXMIN;
-					}
-					aux->m_Frec = f;
-					return OK;
-				}
-				aux = aux->m_next;
-			}
-			return NOPORT;
-		}
-		iterChannelList = iterChannelList->m_next;
+		/*The tail isn't aligned, it's written without O_DIRECT*/
+		fcntl(recorder->m_fd, F_SETFL, fcntl(recorder->m_fd, F_GETFL) & ~O_DIRECT);
+		recorder->m_direct = false;
 	}
-	return CHANNELNOTDEFINED;
+	recorder_write(recorder, recorder->m_chunk, recorder->m_chunkUsed);
+	recorder->m_chunkUsed = 0;
 }
 
-VirtualSdrError GetTxFrec(struct SdrConfig* configuration, SdrPort port, long* f)
+/*Starts a new file before a block that doesn't fit in the current one or if it's too old, so every file starts with a block*/
+static void recorder_rotate(struct SdrRecorder* recorder, struct RecorderSlot* slot, int len)
 {
-	if(configuration == NULL)
+	long long fileBytes = recorder->m_fileBytes + recorder->m_chunkUsed;
+	bool rotateSize = recorder->m_options.m_rotateBytes > 0 && fileBytes > 0 && fileBytes + len > recorder->m_options.m_rotateBytes;
+	bool rotateTime = recorder->m_options.m_rotateSeconds > 0 && now_ns() - recorder->m_fileStart >= recorder->m_options.m_rotateSeconds*1000000000ULL;
+	if(recorder->m_fd >= 0 && !rotateSize && !rotateTime)
 	{
-		return NULLPOINTER;
+		return;
 	}
-	if(configuration->m_activeTxChannel == 0)
+	recorder_flush(recorder, true);
+	if(!recorder_open(recorder, slot))
 	{
-		return CHANNELNOTDEFINED;
+		atomic_fetch_add(&recorder->m_errors, 1);
 	}
-	struct PortList * aux = configuration->m_ports;
-	while(aux != NULL)
+}
+
+static void recorder_entry(struct SdrRecorder* recorder, unsigned long long sample, unsigned long long time)
+{
+	if(recorder->m_indexLength == recorder->m_indexCapacity)
 	{
-		if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+		int capacity = recorder->m_indexCapacity > 0 ? 2*recorder->m_indexCapacity : 1024;
+		struct IndexEntry* index = (struct IndexEntry*) realloc(recorder->m_index, capacity*sizeof(struct IndexEntry));
+		if(index == NULL)
 		{
-			f[0] = aux->m_Frec;
-			return OK;
+			atomic_fetch_add(&recorder->m_errors, 1);
+			return;
 		}
-		aux = aux->m_next;
+		recorder->m_index = index;
+		recorder->m_indexCapacity = capacity;
+	}
+	struct IndexEntry* entry = &recorder->m_index[recorder->m_indexLength];
+	entry->m_sample = sample;
+	entry->m_position = recorder->m_position;
+	entry->m_offset = recorder->m_offset;
+	entry->m_time = time;
+	recorder->m_indexLength++;
+	if(fwrite(entry, sizeof(struct IndexEntry), 1, recorder->m_indexFile) != 1)
+	{
+		atomic_fetch_add(&recorder->m_errors, 1);
 	}
-	f[0] = -1;
-	return NOPORT;
 }
 
-VirtualSdrError SetRxBw(struct SdrConfig* configuration, SdrPort port, int bw) 
+/*Adds an entry to the index for the first block, every RECORDERINDEXSTEP samples and after a gap*/
+static void recorder_index(struct SdrRecorder* recorder, struct RecorderSlot* slot)
 {
-	if(configuration == NULL)
-	{
-		return NULLPOINTER;
-	}
-	if(configuration->m_activeRxChannel == 0)
+	struct IndexEntry* last = recorder->m_indexLength > 0 ? &recorder->m_index[recorder->m_indexLength - 1] : NULL;
+	bool add = last == NULL || slot->m_sample != recorder->m_expected || slot->m_sample - last->m_sample >= RECORDERINDEXSTEP;
+	recorder->m_expected = slot->m_sample + slot->m_length;
+	recorder->m_endTime = slot->m_time + recorder->m_realtime + (unsigned long long)(slot->m_length*1e9/recorder->m_FS);
+	if(add)
 	{
-		return CHANNELNOTDEFINED;
+		recorder_entry(recorder, slot->m_sample, slot->m_time + recorder->m_realtime);
 	}
-		struct ChannelList* iterChannelList = configuration->m_channels;
-	while (iterChannelList != NULL)
+}
+
+static void* recorder_writer(void* arg)
+{
+	struct SdrRecorder* recorder = (struct SdrRecorder*) arg;
+	bool codec = recorder->m_options.m_codecThreads > 0;
+	
+	pthread_mutex_lock(&recorder->m_lock);
+	while(true)
 	{
-		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		while((recorder->m_count == 0 && !recorder->m_stop) || (recorder->m_count > 0 && codec && !recorder->m_slots[recorder->m_head].m_ready))
 		{
-			struct PortList * aux = configuration->m_ports;
-			while(aux != NULL)
+			pthread_cond_wait(&recorder->m_filled, &recorder->m_lock);
+		}
+		if(recorder->m_count == 0)
+		{
+			break;
+		}
+		struct RecorderSlot* slot = &recorder->m_slots[recorder->m_head];
+		pthread_mutex_unlock(&recorder->m_lock);
+		
+		char* data = codec ? (char*) slot->m_packed : (char*) slot->m_data;
+		int len = codec ? slot->m_packedBytes : (int)(slot->m_length*2*sizeof(float));
+		if(len <= 0)
+		{
+			atomic_fetch_add(&recorder->m_dropped, slot->m_length);
+		}
+		else
+		{
+			recorder_rotate(recorder, slot, len);
+			recorder_index(recorder, slot);
+			if(recorder->m_preview != NULL)
 			{
-				if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+				METRIC_BEGIN(begin);
+				preview_push(recorder->m_preview, slot->m_data, slot->m_length);
+				METRIC_END(METRICANALYSIS, begin, slot->m_length*2*sizeof(float));
+			}
+			recorder->m_position += slot->m_length;
+			recorder->m_offset += len;
+			atomic_fetch_add(&recorder->m_samples, slot->m_length);
+			while(len > 0)
+			{
+				int part = RECORDERCHUNK - recorder->m_chunkUsed < len ? RECORDERCHUNK - recorder->m_chunkUsed : len;
+				memcpy(recorder->m_chunk + recorder->m_chunkUsed, data, part);
+				recorder->m_chunkUsed += part;
+				data += part;
+				len -= part;
+				if(recorder->m_chunkUsed == RECORDERCHUNK)
 				{
-					if(bw > iterChannelList->m_maxBw)
-					{
-						aux->m_Bw = iterChannelList->m_maxBw;
-						return VALUEAPROXMAX;
-					}
-					if(bw < iterChannelList->m_minBw)
-					{
-						aux->m_Bw = iterChannelList->m_minBw;
-						return VALUEAPROXMIN;
-					}
-					aux->m_Bw = bw;
-					return OK;
+					recorder_flush(recorder, false);
 				}
-				aux = aux->m_next;
 			}
-			return NOPORT;
 		}
-		iterChannelList = iterChannelList->m_next;
+		
+		pthread_mutex_lock(&recorder->m_lock);
+		slot->m_ready = false;
+		recorder->m_head = (recorder->m_head + 1)%recorder->m_options.m_slots;
+		recorder->m_count--;
+		if(codec)
+		{
+			recorder->m_claimed--;
+		}
 	}
-	return CHANNELNOTDEFINED;
-}
-
-VirtualSdrError GetRxBw(struct SdrConfig* configuration, SdrPort port, int* bw)
-{
-	if(configuration == NULL)
+	pthread_mutex_unlock(&recorder->m_lock);
+	recorder_flush(recorder, true);
+	recorder_close(recorder);
+	if(recorder->m_indexLength > 0)
 	{
-		return NULLPOINTER;
+		/*The last entry marks the end of the recording*/
+		recorder_entry(recorder, recorder->m_expected, recorder->m_endTime);
 	}
-	if(configuration->m_activeRxChannel == 0)
+	fflush(recorder->m_indexFile);
+	if(recorder->m_preview != NULL)
 	{
-		return CHANNELNOTDEFINED;
+		close_preview(recorder->m_preview);
 	}
-	struct PortList * aux = configuration->m_ports;
-	while(aux != NULL)
+	return NULL;
+}
+
+/*Compresses the slots in the order they are filled, the writer takes each one when it's ready*/
+static void* recorder_codec(void* arg)
+{
+	struct SdrRecorder* recorder = (struct SdrRecorder*) arg;
+	int32_t* values = NULL;
+	int capacity = 0;
+	
+	pthread_mutex_lock(&recorder->m_lock);
+	while(true)
 	{
-		if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
+		while(recorder->m_claimed == recorder->m_count && !recorder->m_stop)
 		{
-			bw[0] = aux->m_Bw;
-			return OK;
+			pthread_cond_wait(&recorder->m_filled, &recorder->m_lock);
 		}
-		aux = aux->m_next;
+		if(recorder->m_claimed == recorder->m_count)
+		{
+			break;
+		}
+		struct RecorderSlot* slot = &recorder->m_slots[(recorder->m_head + recorder->m_claimed)%recorder->m_options.m_slots];
+		recorder->m_claimed++;
+		pthread_mutex_unlock(&recorder->m_lock);
+		
+		METRIC_BEGIN(begin);
+		if(capacity < slot->m_length)
+		{
+			free(values);
+			values = (int32_t*) malloc(2*slot->m_length*sizeof(int32_t));
+			capacity = values == NULL ? 0 : slot->m_length;
+		}
+		if(slot->m_packedCapacity < slot->m_length)
+		{
+			free(slot->m_packed);
+			slot->m_packed = (uint8_t*) malloc(CODECHEADER + 2*slot->m_length*sizeof(float));
+			slot->m_packedCapacity = slot->m_packed == NULL ? 0 : slot->m_length;
+		}
+		slot->m_packedBytes = 0;
+		if(values != NULL && slot->m_packed != NULL)
+		{
+			slot->m_packedBytes = codec_encode(slot->m_data, slot->m_length, values, slot->m_packed);
+		}
+		METRIC_END(METRICCODEC, begin, slot->m_length*2*sizeof(float));
+		
+		pthread_mutex_lock(&recorder->m_lock);
+		slot->m_ready = true;
+		pthread_cond_broadcast(&recorder->m_filled);
 	}
-	bw[0] = -1;
-	return NOPORT;
+	pthread_mutex_unlock(&recorder->m_lock);
+	free(values);
+	return NULL;
 }
 
-VirtualSdrError SetTxBw(struct SdrConfig* configuration, SdrPort port, int bw)
+static void recorder_stage(struct SdrBlock* block, void* data)
 {
-	if(configuration == NULL)
-	{
-		return NULLPOINTER;
-	}
-	if(configuration->m_activeTxChannel == 0)
+	struct SdrRecorder* recorder = (struct SdrRecorder*) data;
+	
+	pthread_mutex_lock(&recorder->m_lock);
+	if(recorder->m_count == recorder->m_options.m_slots || recorder->m_stop)
 	{
-		return CHANNELNOTDEFINED;
+		pthread_mutex_unlock(&recorder->m_lock);
+		atomic_fetch_add(&recorder->m_dropped, block->m_length);
+		return;
 	}
-	struct ChannelList* iterChannelList = configuration->m_channels;
-	while (iterChannelList != NULL)
+	struct RecorderSlot* slot = &recorder->m_slots[(recorder->m_head + recorder->m_count)%recorder->m_options.m_slots];
+	pthread_mutex_unlock(&recorder->m_lock);
+	
+	if(slot->m_capacity < block->m_length)
 	{
-		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		free(slot->m_data);
+		slot->m_data = (float*) malloc(2*block->m_length*sizeof(float));
+		slot->m_capacity = slot->m_data == NULL ? 0 : block->m_length;
+		if(slot->m_data == NULL)
 		{
-			struct PortList * aux = configuration->m_ports;
-			while(aux != NULL)
-			{
-				if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
-				{
-					if(bw > iterChannelList->m_maxBw)
-					{
-						aux->m_Bw = iterChannelList->m_maxBw;
-						return VALUEAPROXMAX;
-					}
-					if(bw < iterChannelList->m_minBw)
-					{
-						aux->m_Bw = iterChannelList->m_minBw;
-						return VALUEAPROXMIN;
-					}
-					aux->m_Bw = bw;
-					return OK;
-				}
-				aux = aux->m_next;
-			}
-			return NOPORT;
+			atomic_fetch_add(&recorder->m_dropped, block->m_length);
+			return;
 		}
-		iterChannelList = iterChannelList->m_next;
 	}
-	return CHANNELNOTDEFINED;
+	for(int i = 0; i < block->m_length; i++)
+	{
+		slot->m_data[2*i] = block->m_I[i];
+		slot->m_data[2*i+1] = block->m_Q[i];
+	}
+	slot->m_length = block->m_length;
+	slot->m_sample = block->m_sample;
+	slot->m_time = block->m_time;
+	
+	pthread_mutex_lock(&recorder->m_lock);
+	recorder->m_count++;
+	pthread_cond_broadcast(&recorder->m_filled);
+	pthread_mutex_unlock(&recorder->m_lock);
 }
 
-VirtualSdrError GetTxBw(struct SdrConfig* configuration, SdrPort port, int* bw)
+VirtualSdrError DefaultRecorderOptions(struct RecorderOptions* options)
 {
-	if(configuration == NULL)
+	if(options == NULL)
 	{
 		return NULLPOINTER;
 	}
-	if(configuration->m_activeTxChannel == 0)
+	options->m_rotateBytes = 0;
+	options->m_rotateSeconds = 0;
+	options->m_slots = 64;
+	options->m_direct = 1;
+	options->m_preview = 1;
+	options->m_codecThreads = 0;
+	return OK;
+}
+
+VirtualSdrError CreateRecorder(struct SdrRecorder** recorder, char* baseName, struct RecorderOptions* options)
+{
+	if(recorder == NULL || baseName == NULL)
 	{
-		return CHANNELNOTDEFINED;
+		return NULLPOINTER;
 	}
-	struct PortList * aux = configuration->m_ports;
-	while(aux != NULL)
+	struct RecorderOptions defaults;
+	if(options == NULL)
 	{
-		if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+		DefaultRecorderOptions(&defaults);
+		options = &defaults;
+	}
+	if(options->m_slots <= 0 || options->m_rotateBytes < 0 || options->m_rotateSeconds < 0 || options->m_codecThreads < 0 || strlen(baseName) >= 256)
+	{
+		return INVALIDVALUE;
+	}
+	
+	struct SdrRecorder* aux = (struct SdrRecorder*) calloc(1, sizeof(struct SdrRecorder));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	strcpy(aux->m_baseName, baseName);
+	aux->m_options = *options;
+	aux->m_fd = -1;
+	pthread_mutex_init(&aux->m_lock, NULL);
+	pthread_cond_init(&aux->m_filled, NULL);
+	aux->m_slots = (struct RecorderSlot*) calloc(options->m_slots, sizeof(struct RecorderSlot));
+	aux->m_codecThreads = (pthread_t*) calloc(options->m_codecThreads + 1, sizeof(pthread_t));
+	if(aux->m_slots == NULL || aux->m_codecThreads == NULL || posix_memalign((void**) &aux->m_chunk, RECORDERALIGN, RECORDERCHUNK) != 0)
+	{
+		aux->m_chunk = NULL;
+		FreeRecorder(aux);
+		return NOMEMORY;
+	}
+	char fileName[300];
+	snprintf(fileName, sizeof(fileName), "%s.sigmf-idx", baseName);
+	aux->m_indexFile = fopen(fileName, "wb");
+	if(aux->m_indexFile == NULL)
+	{
+		FreeRecorder(aux);
+		return FILENOTOPEN;
+	}
+	if(options->m_preview)
+	{
+		VirtualSdrError error = create_preview(&aux->m_preview, baseName);
+		if(error != OK)
 		{
-			bw[0] = aux->m_Bw;
-			return OK;
+			FreeRecorder(aux);
+			return error;
 		}
-		aux = aux->m_next;
 	}
-	bw[0] = -1;
-	return NOPORT;
+	fwrite(RECORDERINDEXMAGIC, 1, 4, aux->m_indexFile);
+	unsigned char header[2] = {RECORDERINDEXVERSION, options->m_codecThreads > 0 ? RECORDERCOMPRESSED : 0};
+	fwrite(header, 1, 2, aux->m_indexFile);
+	
+	struct timespec real;
+	clock_gettime(CLOCK_REALTIME, &real);
+	aux->m_realtime = (long long)real.tv_sec*1000000000LL + real.tv_nsec - (long long)now_ns();
+	aux->m_start = now_ns();
+	if(pthread_create(&aux->m_thread, NULL, recorder_writer, aux) != 0)
+	{
+		aux->m_start = 0;
+		FreeRecorder(aux);
+		return NOMEMORY;
+	}
+	while(aux->m_codecRunning < options->m_codecThreads)
+	{
+		if(pthread_create(&aux->m_codecThreads[aux->m_codecRunning], NULL, recorder_codec, aux) != 0)
+		{
+			FreeRecorder(aux);
+			return NOMEMORY;
+		}
+		aux->m_codecRunning++;
+	}
+	*recorder = aux;
+	return OK;
 }
-VirtualSdrError SetGain(struct SdrConfig* configuration, SdrPort port, float* gain)
+
+VirtualSdrError AttachRecorder(struct VirtualSdr* virtual, SdrPort port, struct SdrRecorder* recorder)
 {
-	if(configuration == NULL)
+	if(recorder == NULL || virtual == NULL)
 	{
 		return NULLPOINTER;
 	}
-	if(configuration->m_activeRxChannel == 0)
+	if(recorder->m_virtual != NULL)
 	{
-		return CHANNELNOTDEFINED;
+		return PORTBUSY;
 	}
-		struct ChannelList* iterChannelList = configuration->m_channels;
-	while (iterChannelList != NULL)
+	struct PortList* rxPort = find_port(virtual, RX, port);
+	if(rxPort == NULL)
 	{
-		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
-		{
-			struct PortList * aux = configuration->m_ports;
-			while(aux != NULL)
-			{
-				if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
-				{
-					if(gain[0] > iterChannelList->m_maxAmp)
-					{
-						aux->m_Amp = iterChannelList->m_maxAmp;
-						return VALUEAPROXMAX;
-					}
-					if(gain[0] < iterChannelList->m_minAmp)
-					{
-						aux->m_Amp = iterChannelList->m_minAmp;
-						return VALUEAPROXMIN;
-					}
-					aux->m_Amp = gain[0];
-					return OK;
-				}
-				aux = aux->m_next;
-			}
-			return NOPORT;
-		}
-		iterChannelList = iterChannelList->m_next;
+		return NOPORT;
 	}
-	return CHANNELNOTDEFINED;
+	VirtualSdrError error = AddRxStage(virtual, port, recorder_stage, recorder);
+	if(error != OK)
+	{
+		return error;
+	}
+	recorder->m_virtual = virtual;
+	recorder->m_port = port;
+	recorder->m_FS = virtual->m_FS;
+	recorder->m_frec = rxPort->m_Frec;
+	recorder->m_gain = rxPort->m_Amp;
+	return OK;
 }
 
-VirtualSdrError GetGain(struct SdrConfig* configuration, SdrPort port, float* gain)
+VirtualSdrError DetachRecorder(struct SdrRecorder* recorder)
 {
-	if(configuration == NULL)
+	if(recorder == NULL)
 	{
 		return NULLPOINTER;
 	}
-	if(configuration->m_activeRxChannel == 0)
+	if(recorder->m_virtual == NULL)
 	{
-		return CHANNELNOTDEFINED;
+		return OK;
 	}
-	struct PortList * aux = configuration->m_ports;
-	while(aux != NULL)
+	VirtualSdrError error = stream_remove_stage(recorder->m_virtual, RX, recorder->m_port, recorder_stage, recorder);
+	if(error != OK && error != NOPORT)
 	{
-		if(aux->m_type == RX && aux->m_channel==configuration->m_activeRxChannel && aux->m_port == port)
-		{
-			gain[0] = aux->m_Amp;
-			return OK;
-		}
-		aux = aux->m_next;
+		return error;
 	}
-	gain[0] = -1;
-	return NOPORT;
+	recorder->m_virtual = NULL;
+	return OK;
 }
 
-VirtualSdrError SetAttenuation(struct SdrConfig* configuration, SdrPort port, float* Att)
+VirtualSdrError GetRecorderStats(struct SdrRecorder* recorder, struct RecorderStats* stats)
 {
-	if(configuration == NULL)
+	if(recorder == NULL || stats == NULL)
 	{
 		return NULLPOINTER;
 	}
-	if(configuration->m_activeTxChannel == 0)
+	stats->m_bytes = atomic_load(&recorder->m_bytes);
+	stats->m_droppedSamples = atomic_load(&recorder->m_dropped);
+	stats->m_errors = atomic_load(&recorder->m_errors);
+	stats->m_files = atomic_load(&recorder->m_files);
+	double seconds = (now_ns() - recorder->m_start)*1e-9;
+	stats->m_rate = seconds > 0 ? stats->m_bytes/seconds/1e6 : 0;
+	unsigned long long samples = atomic_load(&recorder->m_samples);
+	stats->m_ratio = samples > 0 ? (double) stats->m_bytes/(samples*2*sizeof(float)) : 1;
+	return OK;
+}
+
+struct SdrRecording{
+	char m_baseName[256];
+	long m_FS;
+	bool m_compressed;
+	struct IndexEntry* m_index;
+	int m_indexLength;
+	long long* m_fileBytes;
+	int m_files;
+	unsigned long long m_bytes;
+	unsigned long long m_samples;
+	int m_fd;
+	int m_openFile;
+	
+	/*Last block decoded of a compressed recording*/
+	uint8_t* m_block;
+	int m_blockCapacity;
+	float* m_decoded;
+	int m_decodedCapacity;
+	int m_decodedLength;
+	unsigned long long m_decodedOffset;
+};
+
+/*Sample rate of a recording from the metadata of its first file*/
+static long recording_rate(char* baseName)
+{
+	char fileName[300];
+	char line[256];
+	long fs = 0;
+	snprintf(fileName, sizeof(fileName), "%s_0000.sigmf-meta", baseName);
+	FILE* stream = fopen(fileName, "r");
+	if(stream == NULL)
 	{
-		return CHANNELNOTDEFINED;
+		return 0;
 	}
-		struct ChannelList* iterChannelList = configuration->m_channels;
-	while (iterChannelList != NULL)
+	while(fs == 0 && fgets(line, sizeof(line), stream) != NULL)
 	{
-		if(iterChannelList->m_channel==configuration->m_activeTxChannel)
+		char* field = strstr(line, "\"core:sample_rate\":");
+		if(field != NULL)
 		{
-			struct PortList * aux = configuration->m_ports;
-			while(aux != NULL)
-			{
-				if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
-				{
-					if(Att[0] > iterChannelList->m_maxAmp)
-					{
-						aux->m_Amp = iterChannelList->m_maxAmp;
-						return VALUEAPROXMAX;
-					}
-					if(Att[0] < iterChannelList->m_minAmp)
-					{
-						aux->m_Amp = iterChannelList->m_minAmp;
-						return VALUEAPROXMIN;
-					}
-					aux->m_Amp = Att[0];
-					return OK;
-				}
-				aux = aux->m_next;
-			}
-			return NOPORT;
+			fs = atol(field + strlen("\"core:sample_rate\":"));
 		}
-		iterChannelList = iterChannelList->m_next;
 	}
-	return CHANNELNOTDEFINED;
+	fclose(stream);
+	return fs;
 }
- 
-VirtualSdrError GetAttenuation(struct SdrConfig* configuration, SdrPort port, float* Att)
+
+VirtualSdrError OpenRecording(struct SdrRecording** recording, char* baseName)
 {
-	if(configuration == NULL)
+	if(recording == NULL || baseName == NULL)
 	{
 		return NULLPOINTER;
 	}
-	if(configuration->m_activeTxChannel == 0)
+	if(strlen(baseName) >= 256)
 	{
-		return CHANNELNOTDEFINED;
+		return INVALIDVALUE;
 	}
-	struct PortList * aux = configuration->m_ports;
-	while(aux != NULL)
+	struct SdrRecording* aux = (struct SdrRecording*) calloc(1, sizeof(struct SdrRecording));
+	if(aux == NULL)
 	{
-		if(aux->m_type == TX && aux->m_channel==configuration->m_activeTxChannel && aux->m_port == port)
+		return NOMEMORY;
+	}
+	strcpy(aux->m_baseName, baseName);
+	aux->m_fd = -1;
+	aux->m_openFile = -1;
+	aux->m_FS = recording_rate(baseName);
+	
+	char fileName[300];
+	snprintf(fileName, sizeof(fileName), "%s.sigmf-idx", baseName);
+	FILE* stream = fopen(fileName, "rb");
+	if(stream == NULL || aux->m_FS <= 0)
+	{
+		if(stream != NULL)
 		{
-			Att[0] = aux->m_Amp;
-			return OK;
+			fclose(stream);
 		}
-		aux = aux->m_next;
+		FreeRecording(aux);
+		return FILENOTOPEN;
 	}
-	Att[0] = -1;
-	return NOPORT;
-}
-
-VirtualSdrError SetFS(struct SdrConfig* configuration, int desiredValue)
-{
-	if(configuration == NULL)
+	char magic[4];
+	unsigned char header[2];
+	if(fread(magic, 1, 4, stream) != 4 || memcmp(magic, RECORDERINDEXMAGIC, 4) != 0 || fread(header, 1, 2, stream) != 2 || header[0] != RECORDERINDEXVERSION)
 	{
-		return NULLPOINTER;
+		fclose(stream);
+		FreeRecording(aux);
+		return INVALIDVALUE;
 	}
-	if(configuration->m_minFS > desiredValue)
+	aux->m_compressed = (header[1] & RECORDERCOMPRESSED) != 0;
+	fseek(stream, 0, SEEK_END);
+	aux->m_indexLength = (ftell(stream) - RECORDERINDEXHEADER)/sizeof(struct IndexEntry);
+	fseek(stream, RECORDERINDEXHEADER, SEEK_SET);
+	aux->m_index = (struct IndexEntry*) malloc((aux->m_indexLength > 0 ? aux->m_indexLength : 1)*sizeof(struct IndexEntry));
+	if(aux->m_index == NULL)
 	{
-		configuration->m_FS = configuration->m_minFS;
-		return VALUEAPROXMIN;
+		fclose(stream);
+		FreeRecording(aux);
+		return NOMEMORY;
 	}
-	else
+	if(fread(aux->m_index, sizeof(struct IndexEntry), aux->m_indexLength, stream) != (size_t) aux->m_indexLength)
 	{
-		if(configuration->m_maxFS < desiredValue)
+		fclose(stream);
+		FreeRecording(aux);
+		return INVALIDVALUE;
+	}
+	fclose(stream);
+	
+	while(true)
+	{
+		recording_data_name(fileName, sizeof(fileName), baseName, aux->m_files, aux->m_compressed);
+		int fd = open(fileName, O_RDONLY);
+		if(fd < 0)
 		{
-			configuration->m_FS = configuration->m_maxFS;
-			return VALUEAPROXMAX;
+			break;
 		}
-		else
+		long long* fileBytes = (long long*) realloc(aux->m_fileBytes, (aux->m_files + 1)*sizeof(long long));
+		if(fileBytes == NULL)
 		{
-			configuration->m_FS = desiredValue;
+			close(fd);
+			FreeRecording(aux);
+			return NOMEMORY;
 		}
+		aux->m_fileBytes = fileBytes;
+		aux->m_fileBytes[aux->m_files] = lseek(fd, 0, SEEK_END);
+		aux->m_bytes += aux->m_fileBytes[aux->m_files];
+		aux->m_files++;
+		close(fd);
+	}
+	if(aux->m_indexLength == 0 || aux->m_files == 0)
+	{
+		FreeRecording(aux);
+		return FILENOTOPEN;
 	}
+	/*The blocks of a compressed recording have to be decoded to count them, so the end entry of the index is used*/
+	aux->m_samples = aux->m_compressed ? aux->m_index[aux->m_indexLength - 1].m_position : aux->m_bytes/(2*sizeof(float));
+	aux->m_decodedOffset = ~0ULL;
+	*recording = aux;
 	return OK;
 }
 
-VirtualSdrError GetFS(struct SdrConfig* configuration, int* buffer)
+VirtualSdrError GetRecordingInfo(struct SdrRecording* recording, long* fs, unsigned long long* samples, unsigned long long* start, unsigned long long* stop)
 {
-	if(configuration == NULL || buffer == NULL)
+	if(recording == NULL || fs == NULL || samples == NULL || start == NULL || stop == NULL)
 	{
 		return NULLPOINTER;
 	}
-	buffer[0] = configuration->m_FS;
+	struct IndexEntry* last = &recording->m_index[recording->m_indexLength - 1];
+	*fs = recording->m_FS;
+	*samples = recording->m_samples;
+	*start = recording->m_index[0].m_time;
+	*stop = last->m_time + (unsigned long long)((recording->m_samples - last->m_position)*1e9/recording->m_FS);
 	return OK;
 }
 
-VirtualSdrError TransmitOnce(struct VirtualSdr* virtual, SdrPort port, int len, float* I_tx, float*Q_tx)
+/*Position in the recording of the sample at a time, the first one after it if the time falls in a gap*/
+static unsigned long long recording_seek(struct SdrRecording* recording, unsigned long long time)
 {
-	if(virtual == NULL || I_tx == NULL || Q_tx == NULL)
+	int low = 0;
+	int high = recording->m_indexLength - 1;
+	while(low < high)
 	{
-		return NULLPOINTER;
-	}
-	struct PortList* portIter = virtual->m_ports;
-	int iter = 0;
-	while(portIter != NULL){
-		if(portIter->m_type == TX && portIter->m_port == port)
+		int mid = (low + high + 1)/2;
+		if(recording->m_index[mid].m_time <= time)
 		{
-			virtual->m_IList[iter] = I_tx;
-			virtual->m_QList[iter] = Q_tx;
-			virtual->m_LengthBuffer[iter] = len;
-			virtual->m_function[iter] = TXONLYONCE;
-			return OK;
+			low = mid;
 		}
-		iter++;
-		portIter = portIter->m_next;
+		else
+		{
+			high = mid - 1;
+		}
+	}
+	struct IndexEntry* entry = &recording->m_index[low];
+	if(time <= entry->m_time)
+	{
+		return entry->m_position;
 	}
-	return NOPORT;
+	unsigned long long position = entry->m_position + (unsigned long long)((time - entry->m_time)*1e-9*recording->m_FS);
+	unsigned long long end = low + 1 < recording->m_indexLength ? recording->m_index[low + 1].m_position : recording->m_samples;
+	return position < end ? position : end;
 }
 
-VirtualSdrError TransmitAlways(struct VirtualSdr* virtual, SdrPort port, int len, float* I_tx, float* Q_tx)
+/*Last index entry at or before a position*/
+static struct IndexEntry* recording_entry(struct SdrRecording* recording, unsigned long long position)
 {
-	if(virtual == NULL || I_tx == NULL || Q_tx == NULL)
+	int low = 0;
+	int high = recording->m_indexLength - 1;
+	while(low < high)
 	{
-		return NULLPOINTER;
-	}
-	struct PortList* portIter = virtual->m_ports;
-	int iter = 0;
-	while(portIter != NULL){
-		if(portIter->m_type == TX && portIter->m_port == port)
+		int mid = (low + high + 1)/2;
+		if(recording->m_index[mid].m_position <= position)
 		{
-			virtual->m_IList[iter] = I_tx;
-			virtual->m_QList[iter] = Q_tx;
-			virtual->m_LengthBuffer[iter] = len;
-			virtual->m_function[iter] = TXCONTINUOUSLY;
-			return OK;
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
 		}
-		iter++;
-		portIter = portIter->m_next;
 	}
-	return NOPORT;
+	return &recording->m_index[low];
 }
 
-VirtualSdrError Receive(struct VirtualSdr* virtual, SdrPort port, int len, float* I_rx, float* Q_rx)
+/*Reads bytes at an offset of the data files joined, returns the bytes read or -1*/
+static long recording_pread(struct SdrRecording* recording, unsigned long long offset, void* buffer, long bytes)
 {
-	if(virtual == NULL || I_rx == NULL || Q_rx == NULL)
+	long done = 0;
+	int file = 0;
+	while(file < recording->m_files && offset >= (unsigned long long) recording->m_fileBytes[file])
 	{
-		return NULLPOINTER;
+		offset -= recording->m_fileBytes[file];
+		file++;
 	}
-	struct PortList* portIter = virtual->m_ports;
-	int iter = 0;
-	while(portIter != NULL){
-		if(portIter->m_type == RX && portIter->m_port == port)
+	while(done < bytes && file < recording->m_files)
+	{
+		if(recording->m_openFile != file)
 		{
-			virtual->m_IList[iter] = I_rx;
-			virtual->m_QList[iter] = Q_rx;
-			virtual->m_LengthBuffer[iter] = len;
-			virtual->m_function[iter] = RXONLYONCE;
-			return OK;
+			char fileName[300];
+			if(recording->m_fd >= 0)
+			{
+				close(recording->m_fd);
+			}
+			recording_data_name(fileName, sizeof(fileName), recording->m_baseName, file, recording->m_compressed);
+			recording->m_fd = open(fileName, O_RDONLY);
+			recording->m_openFile = recording->m_fd < 0 ? -1 : file;
+			if(recording->m_fd < 0)
+			{
+				return -1;
+			}
+		}
+		ssize_t res = pread(recording->m_fd, (char*) buffer + done, bytes - done, offset);
+		if(res < 0)
+		{
+			return -1;
+		}
+		done += res;
+		offset += res;
+		if(res == 0 || offset >= (unsigned long long) recording->m_fileBytes[file])
+		{
+			file++;
+			offset = 0;
 		}
-		iter++;
-		portIter = portIter->m_next;
 	}
-	return NOPORT;
+	return done;
 }
 
-VirtualSdrError SendSin(struct VirtualSdr* virtual, float amp, SdrPort port)
+/*Decodes the block at an offset if it has more than skip samples, keeping it for the next read. Returns the bytes of the block, 0 at the end or -1*/
+static long recording_block(struct SdrRecording* recording, unsigned long long offset, unsigned long long skip, int* len)
 {
-	float I_tx[2048];
-	float Q_tx[2048];
-  
-	for(int i = 0; i < 2048; i++)
+	uint8_t header[CODECHEADER];
+	int payload;
+	long res = recording_pread(recording, offset, header, CODECHEADER);
+	if(res < CODECHEADER)
 	{
-	 	I_tx[i] = amp*sin(2*3.14159265359*i/2048);
-		Q_tx[i] = amp*cos(2*3.14159265359*i/2048);
+		return res < 0 ? -1 : 0;
 	}
-
-	return TransmitAlways(virtual, port, 2048, I_tx, Q_tx);
+	if(!codec_block(header, len, &payload))
+	{
+		return -1;
+	}
+	if(recording->m_decodedOffset == offset || (unsigned long long) *len <= skip)
+	{
+		return CODECHEADER + payload;
+	}
+	if(recording->m_blockCapacity < CODECHEADER + payload)
+	{
+		free(recording->m_block);
+		recording->m_block = (uint8_t*) malloc(CODECHEADER + payload);
+		recording->m_blockCapacity = recording->m_block == NULL ? 0 : CODECHEADER + payload;
+	}
+	if(recording->m_decodedCapacity < *len)
+	{
+		free(recording->m_decoded);
+		recording->m_decoded = (float*) malloc(2*(*len)*sizeof(float));
+		recording->m_decodedCapacity = recording->m_decoded == NULL ? 0 : *len;
+	}
+	if(recording->m_block == NULL || recording->m_decoded == NULL)
+	{
+		return -1;
+	}
+	res = recording_pread(recording, offset, recording->m_block, CODECHEADER + payload);
+	if(res < CODECHEADER + payload)
+	{
+		return res < 0 ? -1 : 0;
+	}
+	recording->m_decodedOffset = ~0ULL;
+	if(codec_decode(recording->m_block, res, recording->m_decoded, recording->m_decodedCapacity) != *len)
+	{
+		return -1;
+	}
+	recording->m_decodedOffset = offset;
+	recording->m_decodedLength = *len;
+	return res;
 }
 
-/*Fast fourier transform (we need this to measure the received signal)*/
-void _fft(cplx buf[], cplx out[], int n, int step)
+VirtualSdrError ReadRecordingSamples(struct SdrRecording* recording, unsigned long long position, int len, float* I_rx, float* Q_rx, int* read)
 {
-	if (step < n) {
-		_fft(out, buf, n, step * 2);
-		_fft(out + step, buf + step, n, step * 2);
- 
-		for (int i = 0; i < n; i += 2 * step) {
-			cplx t = cexp(-I * M_PI * i / n) * out[i + step];
-			buf[i / 2]     = out[i] + t;
-			buf[(i + n)/2] = out[i] - t;
+	if(recording == NULL || I_rx == NULL || Q_rx == NULL || read == NULL)
+	{
+		return NULLPOINTER;
+	}
+	*read = 0;
+	
+	if(!recording->m_compressed)
+	{
+		float pair[2*256];
+		unsigned long long offset = position*2*sizeof(float);
+		while(*read < len)
+		{
+			int want = len - *read < 256 ? len - *read : 256;
+			long res = recording_pread(recording, offset, pair, want*2*sizeof(float));
+			if(res < 0)
+			{
+				return FILENOTOPEN;
+			}
+			int got = res/(2*sizeof(float));
+			for(int i = 0; i < got; i++)
+			{
+				I_rx[*read + i] = pair[2*i];
+				Q_rx[*read + i] = pair[2*i+1];
+			}
+			*read += got;
+			offset += got*2*sizeof(float);
+			if(got < want)
+			{
+				break;
+			}
 		}
+		return OK;
 	}
-}
- 
-void fft(cplx out[], cplx buf[], int n)
-{
-	//for (int i = 0; i < n; i++) out[i] = buf[i];
-	_fft(buf, out, n, 1);
+	
+	/*Blocks are skipped by their headers from the index entry until the one with the position*/
+	struct IndexEntry* entry = recording_entry(recording, position);
+	unsigned long long offset = entry->m_offset;
+	unsigned long long blockStart = entry->m_position;
+	while(*read < len)
+	{
+		int blockLength;
+		long bytes = recording_block(recording, offset, position - blockStart, &blockLength);
+		if(bytes < 0)
+		{
+			return FILENOTOPEN;
+		}
+		if(bytes == 0)
+		{
+			break;
+		}
+		if(blockStart + blockLength > position)
+		{
+			for(int i = position - blockStart; i < blockLength && *read < len; i++)
+			{
+				I_rx[*read] = recording->m_decoded[2*i];
+				Q_rx[*read] = recording->m_decoded[2*i+1];
+				(*read)++;
+				position++;
+			}
+		}
+		offset += bytes;
+		blockStart += blockLength;
+	}
+	return OK;
 }
 
-/*Functions to apply a window before doing the fft*/
-float hann_offset()
+VirtualSdrError ReadRecording(struct SdrRecording* recording, unsigned long long time, int len, float* I_rx, float* Q_rx, int* read)
 {
-	return 1.77f;
+	if(recording == NULL)
+	{
+		return NULLPOINTER;
+	}
+	return ReadRecordingSamples(recording, recording_seek(recording, time), len, I_rx, Q_rx, read);
 }
 
-float hann_window(int n, int l)
+VirtualSdrError GetRecordingSample(struct SdrRecording* recording, unsigned long long time, unsigned long long* sample)
 {
-	return 0.5f*(1.0f-cos(2*M_PI*n/l));
+	if(recording == NULL || sample == NULL)
+	{
+		return NULLPOINTER;
+	}
+	*sample = recording_seek(recording, time);
+	return OK;
 }
 
-
-/*Just a small function to avoid weird-looking code*/
-float calc_compression(float gain,  float attenuation, float recv)
+static FILE* open_preview_level(struct SdrRecording* recording, int level)
 {
-	return ((attenuation+gain)-recv);
+	char fileName[300];
+	snprintf(fileName, sizeof(fileName), "%s.preview%d", recording->m_baseName, level);
+	return fopen(fileName, "rb");
 }
 
-VirtualSdrError FindCompressionPoint(struct VirtualSdr* virtual, SdrPort inPort, SdrPort outPort, float* result)
+VirtualSdrError GetPreviewInfo(struct SdrRecording* recording, int level, unsigned long long* entries, unsigned long long* samplesPerEntry)
 {
-	float I_tx[2048];
-	float Q_tx[2048];
-	float I_rx[2048];
-	float Q_rx[2048];
-	float max, fourier, ref;
-	cplx iq_recv [2048];
-	cplx fourier_recv [2048];
-	bool stopScan = false;
-	for(int i = 0; i < 2048; i++)
+	if(recording == NULL || entries == NULL || samplesPerEntry == NULL)
 	{
-	 	I_tx[i] = sin(2*M_PI*i/2048);
-		Q_tx[i] = cos(2*M_PI*i/2048);
+		return NULLPOINTER;
 	}
-	VirtualSdrError funcRes;
-	
-	funcRes = TransmitAlways(virtual, inPort, 2048, I_tx, Q_tx);
-	if(funcRes != OK)
+	if(level < 0 || level >= PREVIEWLEVELS)
 	{
-		return funcRes;
+		return INVALIDVALUE;
 	}
-	funcRes = Receive(virtual, outPort, 2048, I_rx, Q_rx);
-	if(funcRes != OK)
+	FILE* stream = open_preview_level(recording, level);
+	if(stream == NULL)
 	{
-		return funcRes;
+		return FILENOTOPEN;
 	}
-	
-	funcRes = StartSdr(virtual);
-	if(funcRes != OK)
+	fseek(stream, 0, SEEK_END);
+	*entries = ftell(stream)/sizeof(struct SdrPreviewEntry);
+	fclose(stream);
+	*samplesPerEntry = PREVIEWBLOCK;
+	for(int i = 0; i < level; i++)
 	{
-		return funcRes;
+		*samplesPerEntry *= PREVIEWFACTOR;
 	}
-	
-	for(int iteratorRead = 0; iteratorRead<2048; iteratorRead++) 
+	return OK;
+}
+
+VirtualSdrError ReadPreview(struct SdrRecording* recording, int level, unsigned long long first, int count, struct SdrPreviewEntry* entries, int* read)
+{
+	if(recording == NULL || entries == NULL || read == NULL)
 	{
-		iq_recv[iteratorRead] = hann_window(iteratorRead,2048)*Q_rx[iteratorRead]+I*hann_window(iteratorRead,2048)*I_rx[iteratorRead]; 
-		// Imag (Q) + Real (I)
-		fourier_recv[iteratorRead] = iq_recv[iteratorRead];
+		return NULLPOINTER;
 	}
-	fft(fourier_recv,iq_recv,2048);
-	max = -1000;
-	for(int iter = 1; iter < 2048; iter++)
+	if(level < 0 || level >= PREVIEWLEVELS || count < 0)
 	{
-		fourier = hann_offset()+20*log10(2.0/pow(2,11))+ 10*log10((pow(creal(iq_recv[iter]),2)+pow(cimag(iq_recv[iter]),2))/pow(2048/2,2));
-		if(ref < fourier)
-		{
-			ref = fourier;
-		}
+		return INVALIDVALUE;
 	}
-	
-	int step = 256;
-	int searching = 0;
-	float hardwareGain;
-	
-	struct PortList * current = virtual->m_ports;
-	while(current->m_channel != virtual->m_RxChannel || current->m_type != RX || current->m_port != inPort)
+	FILE* stream = open_preview_level(recording, level);
+	if(stream == NULL)
 	{
-		current = current->m_next;
+		return FILENOTOPEN;
 	}
-	
-	while(!stopScan)
+	*read = 0;
+	if(fseek(stream, first*sizeof(struct SdrPreviewEntry), SEEK_SET) == 0)
 	{
-		hardwareGain = (double)(-0.25f*(searching+step)); // "attenuation" from 0 to 359 (0 to -89.75)
-		current->m_Amp = hardwareGain;
-		
-		funcRes = StartSdr(virtual);
-		if(funcRes != OK)
-		{
-			return funcRes;
-		}
-		
-		for(int iteratorRead = 0; iteratorRead<2048; iteratorRead++) 
+		*read = fread(entries, sizeof(struct SdrPreviewEntry), count, stream);
+	}
+	fclose(stream);
+	return OK;
+}
+
+void FreeRecording(struct SdrRecording* recording)
+{
+	if(recording != NULL)
+	{
+		if(recording->m_fd >= 0)
 		{
-			iq_recv[iteratorRead] = hann_window(iteratorRead,2048)*Q_rx[iteratorRead]+I*hann_window(iteratorRead,2048)*I_rx[iteratorRead]; 
-			// Imag (Q) + Real (I)
-			fourier_recv[iteratorRead] = iq_recv[iteratorRead];
+			close(recording->m_fd);
 		}
-		fft(fourier_recv,iq_recv,2048);
-		max = -1000;
-		for(int iter = 1; iter < 2048; iter++)
+		free(recording->m_index);
+		free(recording->m_fileBytes);
+		free(recording->m_block);
+		free(recording->m_decoded);
+		free(recording);
+	}
+}
+
+void FreeRecorder(struct SdrRecorder* recorder)
+{
+	if(recorder != NULL)
+	{
+		DetachRecorder(recorder);
+		if(recorder->m_start != 0)
 		{
-			fourier = hann_offset()+20*log10(2.0/pow(2,11))+ 10*log10((pow(creal(iq_recv[iter]),2)+pow(cimag(iq_recv[iter]),2))/pow(2048/2,2));
-			if(max < fourier)
+			pthread_mutex_lock(&recorder->m_lock);
+			recorder->m_stop = true;
+			pthread_cond_broadcast(&recorder->m_filled);
+			pthread_mutex_unlock(&recorder->m_lock);
+			for(int i = 0; i < recorder->m_codecRunning; i++)
 			{
-				max = fourier;
+				pthread_join(recorder->m_codecThreads[i], NULL);
 			}
+			pthread_join(recorder->m_thread, NULL);
 		}
-		
-		if(1 < calc_compression(ref,hardwareGain,max))
+		else
 		{
-			searching += step;	
+			recorder_close(recorder);
 		}
-		else
+		if(recorder->m_slots != NULL)
 		{
-			if(searching - step*2 > 0)
+			for(int i = 0; i < recorder->m_options.m_slots; i++)
 			{
-				searching -= 2*step;
-				step*=2;
+				free(recorder->m_slots[i].m_data);
+				free(recorder->m_slots[i].m_packed);
 			}
 		}
-		while (searching + step >= 360)
+		free(recorder->m_slots);
+		free(recorder->m_codecThreads);
+		free(recorder->m_chunk);
+		free(recorder->m_index);
+		free_preview(recorder->m_preview);
+		if(recorder->m_indexFile != NULL)
 		{
-			step /= 2;
+			fclose(recorder->m_indexFile);
 		}
-		if(step == 0)
-		{
-			stopScan = true;
-		}
-		step /=2;
-		result[0] = -0.25*searching;
+		pthread_cond_destroy(&recorder->m_filled);
+		pthread_mutex_destroy(&recorder->m_lock);
+		free(recorder);
 	}
+}
+
+/*
+	Triggered capture. The power of the samples is summed over windows of m_window samples and compared with the
+	levels: a window at m_onLevel opens a burst with the samples of the pre-trigger ring before it, and m_holdOff
+	samples of windows under m_offLevel close it. Samples wait in a window until it's decided, then they go to the
+	ring or to the burst, so the output only depends on the samples and not on how they are split in blocks.
+*/
+struct SdrTrigger{
+	struct TriggerOptions m_options;
+	float m_on;
+	float m_off;
+	SdrBlockCallback m_callback;
+	void* m_data;
+	struct SdrRecorder* m_recorder;
 	
+	/*Virtual SDR and port watched, set by AttachTrigger and cleared by DetachTrigger*/
+	struct VirtualSdr* m_virtual;
+	SdrPort m_port;
+	long m_FS;
+	long m_frec;
+	float m_gain;
 	
-	return StopSdr(virtual);
+	/*Window being summed, with the sample and time of its first sample*/
+	float* m_windowI;
+	float* m_windowQ;
+	int m_windowUsed;
+	float m_energy;
+	unsigned long long m_windowSample;
+	unsigned long long m_windowTime;
+	unsigned long long m_expected;
+	
+	/*Samples before the window, the oldest at m_ringHead*/
+	float* m_ringI;
+	float* m_ringQ;
+	int m_ringHead;
+	int m_ringUsed;
+	
+	/*Burst open*/
+	bool m_open;
+	int m_quiet;
+	float* m_burstI;
+	float* m_burstQ;
+	int m_burstUsed;
+	unsigned long long m_burstSample;
+	unsigned long long m_burstTime;
+	
+	atomic_ullong m_bursts;
+	atomic_ullong m_samples;
+	atomic_ullong m_kept;
+};
+
+static unsigned long long trigger_time(struct SdrTrigger* trigger, unsigned long long time, long long samples)
+{
+	return time + (long long)(samples*1e9/(trigger->m_FS > 0 ? trigger->m_FS : 1));
 }
 
-VirtualSdrError FindIIP3(struct VirtualSdr* virtual, SdrPort inPort, SdrPort outPort, float* result)
+/*Gives the samples of the burst, the next part starts after them*/
+static void trigger_emit(struct SdrTrigger* trigger)
 {
-	float I_tx[2048];
-	float Q_tx[2048];
-	float I_rx[2048];
-	float Q_rx[2048];
-	float poutMax, poutIIP3Max, fourier, ref;
-	cplx iq_recv [2048];
-	cplx fourier_recv [2048];
-	bool stopScan = false;
-	for(int i = 0; i < 2048; i++)
+	if(trigger->m_burstUsed == 0)
 	{
-	 	I_tx[i] = 0.5*sin(2*M_PI*i/2048)+0.5*sin(1000000*2*M_PI*i/virtual->m_FS);
-		Q_tx[i] = 0.5*cos(2*M_PI*i/2048)+0.5*sin(0500000*2*M_PI*i/virtual->m_FS);
+		return;
 	}
-	VirtualSdrError funcRes;
-	
-	funcRes = TransmitAlways(virtual, inPort, 2048, I_tx, Q_tx);
-	if(funcRes != OK)
+	struct SdrBlock block;
+	block.m_port = trigger->m_port;
+	block.m_length = trigger->m_burstUsed;
+	block.m_I = trigger->m_burstI;
+	block.m_Q = trigger->m_burstQ;
+	block.m_sample = trigger->m_burstSample;
+	block.m_time = trigger->m_burstTime;
+	if(trigger->m_recorder != NULL)
 	{
-		return funcRes;
+		recorder_stage(&block, trigger->m_recorder);
 	}
-	funcRes = Receive(virtual, outPort, 2048, I_rx, Q_rx);
-	if(funcRes != OK)
+	if(trigger->m_callback != NULL)
 	{
-		return funcRes;
+		trigger->m_callback(&block, trigger->m_data);
 	}
-	
-	funcRes = StartSdr(virtual);
-	if(funcRes != OK)
+	atomic_fetch_add(&trigger->m_kept, trigger->m_burstUsed);
+	trigger->m_burstSample += trigger->m_burstUsed;
+	trigger->m_burstTime = trigger_time(trigger, trigger->m_burstTime, trigger->m_burstUsed);
+	trigger->m_burstUsed = 0;
+}
+
+static void trigger_append(struct SdrTrigger* trigger, float* I_rx, float* Q_rx, int len)
+{
+	while(len > 0)
 	{
-		return funcRes;
+		int part = trigger->m_options.m_maxBurst - trigger->m_burstUsed < len ? trigger->m_options.m_maxBurst - trigger->m_burstUsed : len;
+		memcpy(trigger->m_burstI + trigger->m_burstUsed, I_rx, part*sizeof(float));
+		memcpy(trigger->m_burstQ + trigger->m_burstUsed, Q_rx, part*sizeof(float));
+		trigger->m_burstUsed += part;
+		I_rx += part;
+		Q_rx += part;
+		len -= part;
+		if(trigger->m_burstUsed == trigger->m_options.m_maxBurst)
+		{
+			trigger_emit(trigger);
+		}
 	}
-	
-	for(int iteratorRead = 0; iteratorRead<2048; iteratorRead++) 
+}
+
+static void trigger_ring_push(struct SdrTrigger* trigger, float* I_rx, float* Q_rx, int len)
+{
+	int size = trigger->m_options.m_preTrigger;
+	if(len >= size)
 	{
-		iq_recv[iteratorRead] = hann_window(iteratorRead,2048)*Q_rx[iteratorRead]+I*hann_window(iteratorRead,2048)*I_rx[iteratorRead]; 
-		// Imag (Q) + Real (I)
-		fourier_recv[iteratorRead] = iq_recv[iteratorRead];
+		memcpy(trigger->m_ringI, I_rx + len - size, size*sizeof(float));
+		memcpy(trigger->m_ringQ, Q_rx + len - size, size*sizeof(float));
+		trigger->m_ringHead = 0;
+		trigger->m_ringUsed = size;
+		return;
 	}
-	fft(fourier_recv,iq_recv,2048);
-	poutMax = -1000;
-	poutIIP3Max = -1000;
-	
-	for(int i = (long)500000*2048/virtual->m_FS-10; i < (long)500000*2048/virtual->m_FS+10;i++)
+	for(int i = 0; i < len; i++)
+	{
+		int pos = (trigger->m_ringHead + trigger->m_ringUsed)%size;
+		trigger->m_ringI[pos] = I_rx[i];
+		trigger->m_ringQ[pos] = Q_rx[i];
+		if(trigger->m_ringUsed < size)
+		{
+			trigger->m_ringUsed++;
+		}
+		else
+		{
+			trigger->m_ringHead = (trigger->m_ringHead + 1)%size;
+		}
+	}
+}
+
+/*Opens a burst with the ring, which holds the samples just before the window*/
+static void trigger_open(struct SdrTrigger* trigger)
+{
+	trigger->m_open = true;
+	trigger->m_quiet = 0;
+	trigger->m_burstUsed = 0;
+	trigger->m_burstSample = trigger->m_windowSample - trigger->m_ringUsed;
+	trigger->m_burstTime = trigger_time(trigger, trigger->m_windowTime, -(long long)trigger->m_ringUsed);
+	atomic_fetch_add(&trigger->m_bursts, 1);
+	int first = trigger->m_options.m_preTrigger - trigger->m_ringHead;
+	first = first < trigger->m_ringUsed ? first : trigger->m_ringUsed;
+	trigger_append(trigger, trigger->m_ringI + trigger->m_ringHead, trigger->m_ringQ + trigger->m_ringHead, first);
+	trigger_append(trigger, trigger->m_ringI, trigger->m_ringQ, trigger->m_ringUsed - first);
+	trigger->m_ringHead = 0;
+	trigger->m_ringUsed = 0;
+}
+
+static void trigger_close(struct SdrTrigger* trigger)
+{
+	if(trigger->m_open)
 	{
-		float auxModule = hann_offset()+20*log10(2.0/pow(2,11))+ 10*log10((pow(creal(iq_recv[i]),2)+pow(cimag(iq_recv[i]),2))/pow(2048/2,2));
-		if(auxModule > poutMax)
-			poutMax = auxModule;
+		trigger_emit(trigger);
+		trigger->m_open = false;
 	}
-	for(int i = (long)1500000*2048/virtual->m_FS-10; i < (long)1500000*2048/virtual->m_FS+10;i++)
+}
+
+/*Decides the window which is full or cut by a gap, and moves its samples to the burst or to the ring*/
+static void trigger_window(struct SdrTrigger* trigger)
+{
+	int len = trigger->m_windowUsed;
+	float mean = trigger->m_energy/len;
+	if(!trigger->m_open && mean >= trigger->m_on)
 	{
-		float auxModule = hann_offset()+20*log10(2.0/pow(2,11))+ 10*log10((pow(creal(iq_recv[i]),2)+pow(cimag(iq_recv[i]),2))/pow(2048/2,2));
-		if(auxModule > poutMax)
-			poutMax = auxModule;
+		trigger_open(trigger);
 	}
-	for(int i = 2048-(long)500000*2048/virtual->m_FS-10; i < 2048-(long)500000*2048/virtual->m_FS+10;i++)
+	if(trigger->m_open)
 	{
-		float auxModule = hann_offset()+20*log10(2.0/pow(2,11))+ 10*log10((pow(creal(iq_recv[i]),2)+pow(cimag(iq_recv[i]),2))/pow(2048/2,2));
-		if(auxModule > poutIIP3Max)
-			poutIIP3Max = auxModule;
+		trigger_append(trigger, trigger->m_windowI, trigger->m_windowQ, len);
+		trigger->m_quiet = mean < trigger->m_off ? trigger->m_quiet + len : 0;
+		if(trigger->m_quiet >= trigger->m_options.m_holdOff)
+		{
+			trigger_close(trigger);
+		}
 	}
-	for(int i = 2048-(long)1500000*2048/virtual->m_FS-10; i < 2048-(long)1500000*2048/virtual->m_FS+10;i++)
+	else
 	{
-		float auxModule = hann_offset()+20*log10(2.0/pow(2,11))+ 10*log10((pow(creal(iq_recv[i]),2)+pow(cimag(iq_recv[i]),2))/pow(2048/2,2));
-		if(auxModule > poutIIP3Max)
-			poutIIP3Max = auxModule;
+		trigger_ring_push(trigger, trigger->m_windowI, trigger->m_windowQ, len);
 	}
-	result[0] = poutMax+(poutMax/poutIIP3Max)/2;
-	return StopSdr(virtual);
+	trigger->m_windowSample += len;
+	trigger->m_windowTime = trigger_time(trigger, trigger->m_windowTime, len);
+	trigger->m_windowUsed = 0;
+	trigger->m_energy = 0;
 }
 
-VirtualSdrError SaveConfiguration(struct SdrConfig* confFile, char* fileName)
+static void trigger_stage(struct SdrBlock* block, void* data)
 {
-	if(confFile == NULL)
-	{
-		return NULLPOINTER;
-	}
+	struct SdrTrigger* trigger = (struct SdrTrigger*) data;
 	
-	FILE* stream = fopen(fileName, "w");
-	if(stream == NULL)
+	if(block->m_sample != trigger->m_expected && (trigger->m_windowUsed > 0 || trigger->m_open || trigger->m_ringUsed > 0))
 	{
-		return FILENOTOPEN;
+		/*Samples were lost, the burst and the ring can't go on through the gap*/
+		if(trigger->m_windowUsed > 0)
+		{
+			trigger_window(trigger);
+		}
+		trigger_close(trigger);
+		trigger->m_ringHead = 0;
+		trigger->m_ringUsed = 0;
 	}
-	fprintf(stream, "A,%s,%i,%i,%i,%ld,%ld,%ld\n", confFile->m_location, confFile->m_connectionType, confFile->m_activeRxChannel, confFile->m_activeTxChannel, confFile->m_minFS, confFile->m_maxFS, confFile->m_FS);
-	struct ChannelList* iterCh = confFile->m_channels;
-	while(iterCh != NULL)
+	trigger->m_expected = block->m_sample + block->m_length;
+	atomic_fetch_add(&trigger->m_samples, block->m_length);
+	
+	int iter = 0;
+	while(iter < block->m_length)
 	{
-		fprintf(stream, "C,%c,%i,%ld,%ld,%ld,%ld,%f,%f,%i,%i\n", iterCh->m_channel, iterCh->m_type == TX, iterCh->m_minFS, iterCh->m_maxFS, iterCh->m_minFrec, iterCh->m_maxFrec, iterCh->m_minAmp, iterCh->m_maxAmp, iterCh->m_minBw, iterCh->m_maxBw);
-		iterCh = iterCh->m_next;
+		if(trigger->m_windowUsed == 0)
+		{
+			trigger->m_windowSample = block->m_sample + iter;
+			trigger->m_windowTime = trigger_time(trigger, block->m_time, iter);
+		}
+		int part = trigger->m_options.m_window - trigger->m_windowUsed;
+		part = part < block->m_length - iter ? part : block->m_length - iter;
+		struct SdrBlock window = *block;
+		window.m_I = block->m_I + iter;
+		window.m_Q = block->m_Q + iter;
+		window.m_length = part;
+		struct SignalMeasure measure;
+		signal_measure(&window, &measure);
+		memcpy(trigger->m_windowI + trigger->m_windowUsed, window.m_I, part*sizeof(float));
+		memcpy(trigger->m_windowQ + trigger->m_windowUsed, window.m_Q, part*sizeof(float));
+		trigger->m_energy += measure.m_power;
+		trigger->m_windowUsed += part;
+		iter += part;
+		if(trigger->m_windowUsed == trigger->m_options.m_window)
+		{
+			trigger_window(trigger);
+		}
 	}
-	
-	struct PortList* iterP = confFile->m_ports;
-	while(iterP != NULL)
+}
+
+VirtualSdrError DefaultTriggerOptions(struct TriggerOptions* options)
+{
+	if(options == NULL)
 	{
-		fprintf(stream, "P,%c,%i,%i,%ld,%f,%i\n", iterP->m_channel, iterP->m_type == TX, iterP->m_port, iterP->m_Frec, iterP->m_Amp, iterP->m_Bw);
-		iterP = iterP->m_next;
+		return NULLPOINTER;
 	}
-	fclose(stream);
+	options->m_onLevel = -30;
+	options->m_offLevel = -33;
+	options->m_window = 64;
+	options->m_preTrigger = 4096;
+	options->m_holdOff = 1024;
+	options->m_maxBurst = 1 << 20;
 	return OK;
 }
 
-VirtualSdrError LoadConfiguration(struct SdrConfig* confFile, char* fileName)
+VirtualSdrError CreateTrigger(struct SdrTrigger** trigger, struct TriggerOptions* options, SdrBlockCallback callback, void* data)
 {
-	if(confFile == NULL)
+	if(trigger == NULL)
 	{
 		return NULLPOINTER;
 	}
-	FILE* stream = fopen(fileName, "r");
-	if(stream == NULL)
+	struct TriggerOptions defaults;
+	if(options == NULL)
 	{
-		return FILENOTOPEN;
+		DefaultTriggerOptions(&defaults);
+		options = &defaults;
 	}
-	
-	char* csvParam;
-	char line[1024];
-	char* tok;
-	bool firstCh = true;
-	bool firstP = true;
-	while(NULL != fgets(line, 1024, stream))
+	if(options->m_window <= 0 || options->m_preTrigger < 0 || options->m_holdOff < 0 || options->m_maxBurst <= 0 || options->m_offLevel > options->m_onLevel)
 	{
-		csvParam = strdup(line);
-    		tok = strtok(line, ",");
-    		switch (tok[0])
-    		{
-    			case 'A': 
-    				tok = strtok(NULL, ",\n");
-    				strcpy(confFile->m_location, tok);
-    				tok = strtok(NULL, ",\n");
-    				confFile->m_connectionType = atoi(tok);
-    				tok = strtok(NULL, ",\n");
-    				confFile->m_activeRxChannel = atoi(tok);
-    				tok = strtok(NULL, ",\n");
-    				confFile->m_activeTxChannel = atoi(tok);
-    				tok = strtok(NULL, ",\n");
-    				confFile->m_minFS = atol(tok);
-    				tok = strtok(NULL, ",\n");
-    				confFile->m_maxFS = atol(tok);
-    				tok = strtok(NULL, ",\n");
-    				confFile->m_FS = atol(tok);
-    				break;
-    			case 'C': 
-    				struct ChannelList* iterCh = (struct ChannelList*)malloc(sizeof(struct ChannelList));
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_channel = tok[0];
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_type = atoi(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_minFS = atol(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_maxFS = atol(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_minFrec = atol(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_maxFrec = atol(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_minAmp = atof(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_maxAmp = atof(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_minBw = atoi(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterCh->m_maxBw = atoi(tok);
-    				
-    				if(firstCh)
-    				{
-    					iterCh->m_next = NULL;
-    					confFile->m_channels = iterCh;
-    					firstCh = false;
-    				}
-    				else
-    				{
-	    				struct ChannelList* auxCh;
-	    				auxCh = confFile->m_channels;
-	    				confFile->m_channels = iterCh;
-	    				iterCh->m_next = auxCh;
-    				}
-    				break;
-    			case 'P': 
-    				struct PortList* iterP = (struct PortList*)malloc(sizeof(struct PortList));
-    				tok = strtok(NULL, ",\n");
-    				iterP->m_channel = tok[0];
-    				tok = strtok(NULL, ",\n");
-    				iterP->m_type = atoi(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterP->m_port = atoi(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterP->m_Frec = atol(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterP->m_Amp = atof(tok);
-    				tok = strtok(NULL, ",\n");
-    				iterP->m_Bw = atoi(tok);
-    				
-    				if(firstP)
-    				{
-    					iterP->m_next = NULL;
-    					confFile->m_ports = iterP;
-    					firstP = false;
-    				}
-    				else
-    				{
-	    				struct PortList* auxP;
-	    				auxP = confFile->m_ports;
-	    				confFile->m_ports = iterP;
-	    				iterP->m_next = auxP;
-    				}
-    				break;
-    		}
+		return INVALIDVALUE;
+	}
+	struct SdrTrigger* aux = (struct SdrTrigger*) calloc(1, sizeof(struct SdrTrigger));
+	if(aux == NULL)
+	{
+		return NOMEMORY;
+	}
+	aux->m_options = *options;
+	aux->m_on = powf(10, options->m_onLevel/10);
+	aux->m_off = powf(10, options->m_offLevel/10);
+	aux->m_callback = callback;
+	aux->m_data = data;
+	aux->m_windowI = (float*) malloc(2*options->m_window*sizeof(float));
+	aux->m_ringI = (float*) malloc((2*options->m_preTrigger + 1)*sizeof(float));
+	aux->m_burstI = (float*) malloc(2*options->m_maxBurst*sizeof(float));
+	if(aux->m_windowI == NULL || aux->m_ringI == NULL || aux->m_burstI == NULL)
+	{
+		FreeTrigger(aux);
+		return NOMEMORY;
+	}
+	aux->m_windowQ = aux->m_windowI + options->m_window;
+	aux->m_ringQ = aux->m_ringI + options->m_preTrigger;
+	aux->m_burstQ = aux->m_burstI + options->m_maxBurst;
+	*trigger = aux;
+	return OK;
+}
+
+/*The recorder of the bursts takes the description of the port from the trigger*/
+static void trigger_describe(struct SdrTrigger* trigger)
+{
+	if(trigger->m_recorder != NULL && trigger->m_FS > 0)
+	{
+		trigger->m_recorder->m_port = trigger->m_port;
+		trigger->m_recorder->m_FS = trigger->m_FS;
+		trigger->m_recorder->m_frec = trigger->m_frec;
+		trigger->m_recorder->m_gain = trigger->m_gain;
+	}
+}
 
+VirtualSdrError TriggerRecorder(struct SdrTrigger* trigger, struct SdrRecorder* recorder)
+{
+	if(trigger == NULL)
+	{
+		return NULLPOINTER;
 	}
-	
-	fclose(stream);
+	trigger->m_recorder = recorder;
+	trigger_describe(trigger);
 	return OK;
 }
 
-VirtualSdrError TransmitFromFileOnce(struct VirtualSdr* virtual ,SdrPort port ,char* dataFile)
+VirtualSdrError AttachTrigger(struct VirtualSdr* virtual, SdrPort port, struct SdrTrigger* trigger)
 {
-	if(virtual == NULL)
+	if(trigger == NULL || virtual == NULL)
 	{
 		return NULLPOINTER;
 	}
-	
-	FILE* stream = fopen(dataFile, "r");
-	if(stream == NULL)
+	if(trigger->m_virtual != NULL)
 	{
-		return FILENOTOPEN;
+		return PORTBUSY;
 	}
-	int counterLines = 0;
-	char line [64];
-	while(NULL != fgets(line, 64, stream))
+	struct PortList* rxPort = find_port(virtual, RX, port);
+	if(rxPort == NULL)
 	{
-		counterLines++;
+		return NOPORT;
 	}
-	fclose(stream);
-	
-	struct PortList* portIter = virtual->m_ports;
-	int iter = 0;
-	while(portIter != NULL){
-		if(portIter->m_type == TX && portIter->m_port == port)
-		{
-			virtual->m_function[iter] = TXFILEONCE;
-			virtual->m_fileName[iter] = (char*) malloc(sizeof(char)*strlen(dataFile));
-			strcpy(virtual->m_fileName[iter], dataFile);
-			virtual->m_IList[iter] = (float*) malloc(counterLines*sizeof(float));
-			virtual->m_QList[iter] = (float*) malloc(counterLines*sizeof(float));
-			
-			stream = fopen(dataFile, "r");
-			if(stream == NULL)
-			{
-				return FILENOTOPEN;
-			}
-			
-			for(int i = 0; i < counterLines; i++)
-			{
-				char* tok;
-				char* param;
-
-				param = strdup(line);
-		    		tok = strtok(line, ",");				
-				virtual->m_IList[iter][i] = atof(tok);
-				tok = strtok(NULL, ",\n");
-				virtual->m_QList[iter][i] = atof(tok);
-			}
-			fclose(stream);
-			return OK;
-		}
-		iter++;
-		portIter = portIter->m_next;
+	VirtualSdrError error = AddRxStage(virtual, port, trigger_stage, trigger);
+	if(error != OK)
+	{
+		return error;
 	}
-	
-	return NOPORT;
+	trigger->m_virtual = virtual;
+	trigger->m_port = port;
+	trigger->m_FS = virtual->m_FS;
+	trigger->m_frec = rxPort->m_Frec;
+	trigger->m_gain = rxPort->m_Amp;
+	trigger_describe(trigger);
+	return OK;
 }
 
-VirtualSdrError TransmitFromFile(struct VirtualSdr* virtual,SdrPort port, char* dataFile)
+VirtualSdrError DetachTrigger(struct SdrTrigger* trigger)
 {
-	if(virtual == NULL)
+	if(trigger == NULL)
 	{
 		return NULLPOINTER;
 	}
-	
-	FILE* stream = fopen(dataFile, "r");
-	if(stream == NULL)
+	if(trigger->m_virtual == NULL)
 	{
-		return FILENOTOPEN;
+		return OK;
 	}
-	int counterLines = 0;
-	char line [64];
-	while(NULL != fgets(line, 64, stream))
+	VirtualSdrError error = stream_remove_stage(trigger->m_virtual, RX, trigger->m_port, trigger_stage, trigger);
+	if(error != OK && error != NOPORT)
 	{
-		counterLines++;
-	}
-	fclose(stream);
-	
-	struct PortList* portIter = virtual->m_ports;
-	int iter = 0;
-	while(portIter != NULL){
-		if(portIter->m_type == TX && portIter->m_port == port)
-		{
-			virtual->m_function[iter] = TXFILECONTINUOUSLY;
-			virtual->m_fileName[iter] = (char*) malloc(sizeof(char)*strlen(dataFile));
-			strcpy(virtual->m_fileName[iter], dataFile);
-			virtual->m_IList[iter] = (float*) malloc(counterLines*sizeof(float));
-			virtual->m_QList[iter] = (float*) malloc(counterLines*sizeof(float));
-			
-			stream = fopen(dataFile, "r");
-			if(stream == NULL)
-			{
-				return FILENOTOPEN;
-			}
-			
-			for(int i = 0; i < counterLines; i++)
-			{
-				char* tok;
-				char* param;
-
-				param = strdup(line);
-		    		tok = strtok(line, ",");				
-				virtual->m_IList[iter][i] = atof(tok);
-				tok = strtok(NULL, ",\n");
-				virtual->m_QList[iter][i] = atof(tok);
-			}
-			fclose(stream);
-			return OK;
-		}
-		iter++;
-		portIter = portIter->m_next;
+		return error;
 	}
-	
-	return NOPORT;
+	trigger->m_virtual = NULL;
+	return OK;
 }
 
-VirtualSdrError ReceiveToFile(struct VirtualSdr* virtual, SdrPort port, int dataLen, char* dataFile)
+VirtualSdrError GetTriggerStats(struct SdrTrigger* trigger, struct TriggerStats* stats)
 {
-	if(virtual == NULL)
+	if(trigger == NULL || stats == NULL)
 	{
 		return NULLPOINTER;
 	}
-	
-	struct PortList* portIter = virtual->m_ports;
-	int iter = 0;
-	while(portIter != NULL){
-		if(portIter->m_type == RX && portIter->m_port == port)
+	stats->m_bursts = atomic_load(&trigger->m_bursts);
+	stats->m_samples = atomic_load(&trigger->m_samples);
+	stats->m_kept = atomic_load(&trigger->m_kept);
+	return OK;
+}
+
+void FreeTrigger(struct SdrTrigger* trigger)
+{
+	if(trigger != NULL)
+	{
+		DetachTrigger(trigger);
+		if(trigger->m_burstI != NULL)
 		{
-			virtual->m_function[iter] = RXFILE;
-			virtual->m_fileName[iter] = (char*) malloc(sizeof(char)*strlen(dataFile));
-			strcpy(virtual->m_fileName[iter], dataFile);
-			virtual->m_LengthBuffer[iter] = dataLen;
-			virtual->m_IList[iter] = (float*)malloc(dataLen*sizeof(float));
-			virtual->m_QList[iter] = (float*)malloc(dataLen*sizeof(float));
-			return OK;
+			trigger_close(trigger);
 		}
-		iter++;
-		portIter = portIter->m_next;
+		free(trigger->m_windowI);
+		free(trigger->m_ringI);
+		free(trigger->m_burstI);
+		free(trigger);
 	}
-	
-	return NOPORT;
 }
 
 VirtualSdrError CheckPortState(struct VirtualSdr* virtual, SdrPort port, ChannelType type, SdrPortState* buffer)
@@ -1575,13 +8588,20 @@ VirtualSdrError CheckPortState(struct VirtualSdr* virtual, SdrPort port, Channel
 	}
 	
 	struct PortList* iterPort = virtual->m_ports;
+	int iter = 0;
 	while(iterPort != NULL)
 	{
 		if(iterPort->m_type == type && iterPort->m_port == port)
 		{
-			buffer[0] = iterPort->m_state;
+			buffer[0] = __atomic_load_n(&iterPort->m_state, __ATOMIC_ACQUIRE);
+			if((virtual->m_function[iter] == RXSTREAM || virtual->m_function[iter] == TXSTREAM) && !atomic_load(&virtual->m_streams[iter].m_running))
+			{
+				/*The thread of the port ended by an error or the end of a replay*/
+				buffer[0] = OFF;
+			}
 			return OK;
 		}
+		iter++;
 		iterPort = iterPort->m_next;
 	}
 	return NOPORT;
@@ -1616,45 +8636,46 @@ VirtualSdrError LoadBSP(struct SdrConfig* configuration, char* csvChannelFile)
 		
 		ListBuffer = (struct ChannelList*) malloc(sizeof(struct ChannelList));
 		char* tok;
+		char* savePtr;
 
     		ListBuffer->m_next = NULL;
-    		tok = strtok(line, ",");
+    		tok = strtok_r(line, ",", &savePtr);
     		
     		ListBuffer->m_channel = (int) *tok;
     		
-    		tok = strtok(NULL, ",\n");
+    		tok = strtok_r(NULL, ",\n", &savePtr);
     		ListBuffer->m_type = atoi(tok);
-		tok = strtok(NULL, ",\n");
+		tok = strtok_r(NULL, ",\n", &savePtr);
 		if(atol(tok) < minFS)
 		{
 			minFS = atol(tok);
 		}
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		if(atol(tok) > maxFS)
 		{
 			maxFS = atol(tok);
 		}	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_minFrec = atol(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_maxFrec = atol(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_minAmp = atof(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_maxAmp = atof(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_minBw = atoi(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_maxBw = atoi(tok);
     		
-    		tok = strtok(NULL, ",\n");
+    		tok = strtok_r(NULL, ",\n", &savePtr);
     		for(int i = 1; i < atoi(tok)+1; i++)
     		{	
     			struct PortList* portIterator = configuration->m_ports;
@@ -1690,46 +8711,48 @@ VirtualSdrError LoadBSP(struct SdrConfig* configuration, char* csvChannelFile)
 		ListBuffer = (struct ChannelList*) malloc(sizeof(struct ChannelList));
 		
 		char* tok;
+		
+		char* savePtr;
 
     		ListBuffer->m_next = NULL;
-    		tok = strtok(line, ",");
+    		tok = strtok_r(line, ",", &savePtr);
     		
     		ListBuffer->m_channel = (int) *tok;
     		
-    		tok = strtok(NULL, ",\n");
+    		tok = strtok_r(NULL, ",\n", &savePtr);
     		ListBuffer->m_type = atoi(tok);
     		
-		tok = strtok(NULL, ",\n");
+		tok = strtok_r(NULL, ",\n", &savePtr);
 		if(atol(tok) < minFS)
 		{
 			minFS = atol(tok);
 		}
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		if(atol(tok) > maxFS)
 		{
 			maxFS = atol(tok);
 		}	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_minFrec = atol(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_maxFrec = atol(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_minAmp = atof(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_maxAmp = atof(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_minBw = atoi(tok);	
     		
-    		tok = strtok(NULL, ",\n");		
+    		tok = strtok_r(NULL, ",\n", &savePtr);		
     		ListBuffer->m_maxBw = atoi(tok);
     		
-    		tok = strtok(NULL, ",\n");
+    		tok = strtok_r(NULL, ",\n", &savePtr);
     		for(int i = 1; i < atoi(tok)+1; i++)
     		{
     			struct PortList* portIterator = configuration->m_ports;
@@ -1780,6 +8803,70 @@ VirtualSdrError GetFilter (struct SdrConfig*, FilterType*)
 {
 	return 1;
 }
+VirtualSdrError GetMetrics(SdrMetric metric, struct SdrMetricStats* stats)
+{
+	if(stats == NULL)
+	{
+		return NULLPOINTER;
+	}
+	if(metric < 0 || metric >= METRICCOUNT)
+	{
+		return INVALIDVALUE;
+	}
+#ifdef SDRAPI_METRICS
+	struct MetricCounters* counters = &metrics[metric];
+	stats->m_count = atomic_load_explicit(&counters->m_count, memory_order_relaxed);
+	stats->m_totalNs = atomic_load_explicit(&counters->m_totalNs, memory_order_relaxed);
+	stats->m_maxNs = atomic_load_explicit(&counters->m_maxNs, memory_order_relaxed);
+	stats->m_bytes = atomic_load_explicit(&counters->m_bytes, memory_order_relaxed);
+	for(int i = 0; i < SDRMETRICBINS; i++)
+	{
+		stats->m_histogram[i] = atomic_load_explicit(&counters->m_histogram[i], memory_order_relaxed);
+	}
+	return OK;
+#else
+	return NOTIMPLEMENTED;
+#endif
+}
+
+VirtualSdrError ResetMetrics(void)
+{
+#ifdef SDRAPI_METRICS
+	for(int m = 0; m < METRICCOUNT; m++)
+	{
+		atomic_store_explicit(&metrics[m].m_count, 0, memory_order_relaxed);
+		atomic_store_explicit(&metrics[m].m_totalNs, 0, memory_order_relaxed);
+		atomic_store_explicit(&metrics[m].m_maxNs, 0, memory_order_relaxed);
+		atomic_store_explicit(&metrics[m].m_bytes, 0, memory_order_relaxed);
+		for(int i = 0; i < SDRMETRICBINS; i++)
+		{
+			atomic_store_explicit(&metrics[m].m_histogram[i], 0, memory_order_relaxed);
+		}
+	}
+	return OK;
+#else
+	return NOTIMPLEMENTED;
+#endif
+}
+
+void PrintMetrics (void)
+{
+	const char* names [] = {"Context creation", "Attribute write", "Buffer creation", "Buffer push", "Buffer refill", "Conversion", "File", "Analysis", "Stream stages", "Recording codec"};
+	struct SdrMetricStats stats;
+	for(int m = 0; m < METRICCOUNT; m++)
+	{
+		if(GetMetrics(m, &stats) != OK)
+		{
+			printf("Metrics not compiled, build with SDRAPI_METRICS\n");
+			return;
+		}
+		if(stats.m_count > 0)
+		{
+			printf("%s: %llu times, mean %.1f us, max %.1f us, %.2f MB/s\n", names[m], stats.m_count, stats.m_totalNs/1000.0/stats.m_count, stats.m_maxNs/1000.0, stats.m_totalNs > 0 ? stats.m_bytes*1000.0/stats.m_totalNs : 0);
+		}
+	}
+}
+
 void PrintSdrConfig (struct SdrConfig* configuration)
 {
 	struct ChannelList* auxChannel = configuration->m_channels;
@@ -1820,6 +8907,10 @@ void PrintSdrConfig (struct SdrConfig* configuration)
 		{
 			printf("Connected to the usb %s\n", configuration->m_location);
 		}
+		else if(configuration->m_connectionType == REPLAY || configuration->m_connectionType == REPLAYFAST)
+		{
+			printf("Replaying the file %s\n", configuration->m_location);
+		}
 		else
 		{
 			printf("Connection not defined yet\n");
@@ -1863,6 +8954,10 @@ void PrintVirtualSdr (struct VirtualSdr* virtual)
 		{
 			printf("Real SDR connected through USB at %s\n", virtual->m_location);
 		}
+		if(is_replay(virtual))
+		{
+			printf("Replaying the file %s\n", virtual->m_location);
+		}
 		printf("Receiving channel %c and transmitting channel %c working with a sampling frecuency of %ld\n",virtual->m_RxChannel, virtual->m_TxChannel, virtual->m_FS);
 		struct PortList* portIter = virtual->m_ports;
 		while(portIter != NULL)
@@ -1892,7 +8987,17 @@ void FreeVirtualSdr (struct VirtualSdr* virtual)
 			virtual->m_ports = virtual->m_ports->m_next;
 			free(auxPortList);
 			
-			if(virtual->m_function[i] == TXFILEONCE || virtual->m_function[i] == TXFILECONTINUOUSLY)
+			struct StageList* auxStage;
+			while(virtual->m_streams[i].m_stages != NULL)
+			{
+				auxStage = virtual->m_streams[i].m_stages;
+				virtual->m_streams[i].m_stages = auxStage->m_next;
+				free(auxStage);
+			}
+			pthread_mutex_destroy(&virtual->m_streams[i].m_lock);
+			free_replay(virtual->m_streams[i].m_replay);
+			
+			if(virtual->m_function[i] == TXFILEONCE || virtual->m_function[i] == TXFILECONTINUOUSLY || virtual->m_function[i] == RXFILE)
 			{
 				free(virtual->m_IList[i]);
 				free(virtual->m_QList[i]);
@@ -1903,6 +9008,7 @@ void FreeVirtualSdr (struct VirtualSdr* virtual)
 		free(virtual->m_IList);
 		free(virtual->m_QList);
 		free(virtual->m_function);
+		free(virtual->m_streams);
 		free(virtual->m_RealSdr);
 		free(virtual->m_LengthBuffer);
 	}
@@ -1942,6 +9048,24 @@ void PrintSdrErrorCode (VirtualSdrError error)
 		case REALSDRNOTFOUND: 
 			printf("Real Sdr cannot be found\n");
 			break; 
+		case INVALIDVALUE: 
+			printf("Value given is not valid\n");
+			break; 
+		case NOMEMORY: 
+			printf("Not enough memory\n");
+			break; 
+		case NOCALIBRATION: 
+			printf("There is no valid calibration for this configuration\n");
+			break; 
+		case BUFFERERROR: 
+			printf("The data couldn't be moved to or from the device\n");
+			break; 
+		case NOTSTREAMING: 
+			printf("The port isn't streaming\n");
+			break; 
+		case PORTBUSY: 
+			printf("The port can't take more data now\n");
+			break; 
 		default:
 			printf("Error code doesn't exist, check if everything is OK with your program\n");
 			break; 
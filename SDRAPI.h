@@ -41,6 +41,12 @@ typedef enum{
 	VALUEAPROXMAX = 7,
 	CHANNELNOTDEFINED = 8,
 	REALSDRNOTFOUND,
+	INVALIDVALUE,
+	NOMEMORY,
+	NOCALIBRATION,
+	BUFFERERROR,
+	NOTSTREAMING,
+	PORTBUSY,
 	NEXTERROR 
 } VirtualSdrError;
 
@@ -70,11 +76,15 @@ typedef enum
 } SdrPort;
 /**
   *@brief How the SDR is connected, through ip, usb... 
+  *REPLAY and REPLAYFAST read the RX ports from a file instead of a device: the location is a file saved by ReceiveToFile, which has the full scale of the stream, or the base name of a recording.
+  *REPLAY gives the samples at the sampling frecuency and REPLAYFAST as fast as they can be read
   */
 typedef enum
 {
 	IP = 1,
-	USB
+	USB,
+	REPLAY,
+	REPLAYFAST
 } SdrConnectionType;
 
 typedef enum
@@ -97,14 +107,326 @@ typedef enum
 	TXCONTINUOUSLY,
 	RXFILE,
 	TXFILEONCE,
-	TXFILECONTINUOUSLY
+	TXFILECONTINUOUSLY,
+	RXSTREAM,
+	TXSTREAM
 } SdrFunction;
 
+/**
+  *@brief Block of samples delivered by a streaming port, the buffers belong to the API and are only valid during the callback.
+  *m_sample is the index of the first sample since the port started, counting the samples lost by the device, and m_time its host time in ns of CLOCK_MONOTONIC
+  */
+struct SdrBlock{
+	SdrPort m_port;
+	int m_length;
+	float* m_I;
+	float* m_Q;
+	unsigned long long m_sample;
+	unsigned long long m_time;
+};
+
+/**
+  *@brief Function called with every block of a streaming port, the second parameter is the pointer given when it was registered
+  */
+typedef void (*SdrBlockCallback)(struct SdrBlock*, void*);
+
+/**
+  *@brief Accounting of a port: blocks moved, samples lost by the device and errors of the push/refill, m_lastError is the negative code of the last error.
+  *m_cpu is the core of the last block, m_realtime tells if SCHED_FIFO was applied and m_migrations counts the changes of core between blocks
+  */
+struct SdrPortStatus{
+	unsigned long long m_blocks;
+	unsigned long long m_overflows;
+	unsigned long long m_underflows;
+	unsigned long long m_lostSamples;
+	unsigned long long m_errors;
+	int m_lastError;
+	int m_cpu;
+	int m_realtime;
+	unsigned long long m_migrations;
+};
+
+/**
+  *@brief Statistics of the signal of a port: DC of I and Q, RMS and peak power in dBFS and crest factor in dB of the last block, with the samples of the last block
+  *with I or Q near the full scale of the converter. The totals count the blocks measured, the samples near full scale and the highest peak since they were enabled
+  */
+struct SdrSignalStats{
+	float m_dcI;
+	float m_dcQ;
+	float m_rms;
+	float m_peak;
+	float m_crest;
+	int m_clipped;
+	unsigned long long m_blocks;
+	unsigned long long m_totalClipped;
+	float m_maxPeak;
+};
+
+/**
+  *@brief Options of the software AGC: the mean power of m_average blocks is kept at m_target dBFS, the gain isn't touched while it's within m_hysteresis dB.
+  *Every change moves the gain at most m_maxStep dB between m_minGain and m_maxGain, in steps of 1dB, and a block near the full scale lowers it at once
+  */
+struct AgcOptions{
+	float m_target;
+	float m_hysteresis;
+	float m_minGain;
+	float m_maxGain;
+	float m_maxStep;
+	int m_average;
+};
+
+/**
+  *@brief Change of gain made by the AGC: samples from m_sample may have the new gain and the ones from m_settled have it for sure
+  */
+struct SdrGainChange{
+	unsigned long long m_sample;
+	unsigned long long m_settled;
+	float m_previous;
+	float m_gain;
+};
+
+/**
+  *@brief State of the AGC: gain in dB, last level measured in dBFS, changes decided, attributes written and failed writes
+  */
+struct AgcStatus{
+	float m_gain;
+	float m_level;
+	unsigned long long m_changes;
+	unsigned long long m_writes;
+	unsigned long long m_errors;
+};
+
+/**
+  *@brief Function called from the thread of the port with every change of gain of the AGC, the last parameter is the pointer given with it
+  */
+typedef void (*SdrGainCallback)(SdrPort, struct SdrGainChange*, void*);
+
+/**
+  *@brief Imbalance of the I/Q of a port: DC offset of I and Q in full scale units, gain of Q over I in dB and phase error of Q in degrees
+  */
+struct SdrIqCoefficients{
+	float m_dcI;
+	float m_dcQ;
+	float m_gain;
+	float m_phase;
+};
+
+/**
+  *@brief Options of the I/Q correction: weight of every block in the estimation of a receiving port and which corrections are done
+  */
+struct IqCorrectionOptions{
+	float m_rate;
+	int m_dc;
+	int m_imbalance;
+};
+
+/**
+  *@brief Options of the channelizer: number of channels as a power of 2, taps of the filter of every channel and threads which help the one of the port
+  */
+struct ChannelizerOptions{
+	int m_channels;
+	int m_taps;
+	int m_threads;
+};
+
+/**
+  *@brief Function called with the decimated block of every channel of a channelizer, the first parameter is the channel and the last the pointer given with it
+  */
+typedef void (*SdrChannelCallback)(int, struct SdrBlock*, void*);
+
+/**
+  *@brief Delay between two signals: delay in samples of the second one with sub-sample precision, phase of the second one in degrees, correlation peak from 0 to 1,
+  *sample index where the first segment started and number of segments averaged
+  */
+struct SdrDelay{
+	double m_delay;
+	float m_phase;
+	float m_peak;
+	unsigned long long m_sample;
+	int m_segments;
+};
+
+/**
+  *@brief Options of the correlator: samples of every segment as a power of 2, segments averaged for every result and threads which do the ffts
+  */
+struct CorrelatorOptions{
+	int m_size;
+	int m_average;
+	int m_threads;
+};
+
+/**
+  *@brief Function called from a thread of the correlator with every result, the last parameter is the pointer given with it
+  */
+typedef void (*SdrDelayCallback)(struct SdrDelay*, void*);
+
+/**
+  *@brief Function called when a port has an overflow, an underflow or an error, the last parameter is the pointer given when it was registered
+  */
+typedef void (*SdrXflowCallback)(SdrPort, ChannelType, struct SdrPortStatus*, void*);
+
+/**
+  *@brief Function called when a burst of a streaming TX port has been given to the device, with its starting sample index. The second parameter is the pointer given when it was registered
+  */
+typedef void (*SdrBurstCallback)(SdrPort, unsigned long long, void*);
+
+/**
+  *@brief Placement of the thread of a streaming port: m_cpu is the core to pin it (-1 for any) and m_priority its SCHED_FIFO priority (0 for the normal scheduler).
+  *The samples of the port are allocated from the thread, so they are in the NUMA node of its core.
+  *Only the thread which moves the samples of the port is placed: the pool of a manager, the writer and codec threads of a recorder, the workers of a channelizer or a correlator and the threads of the sweeps and the scanner are created with the default attributes, so they inherit the affinity and scheduler of the thread which creates them
+  */
+struct SdrThreadOptions{
+	int m_cpu;
+	int m_priority;
+};
+
+/**
+  *@brief Buffering of a port: m_blockLength is the samples of every block, m_kernelBuffers the blocks queued in the kernel and m_latency the target time in s of the data queued.
+  *Fields at 0 are chosen from the others and the sample rate, with all of them at 0 the block is the length given with the function of the port and the kernel buffers the 4 of libiio
+  */
+struct SdrBuffering{
+	int m_blockLength;
+	int m_kernelBuffers;
+	float m_latency;
+};
+
+/**
+  *@brief Options of a recorder: files are rotated after m_rotateBytes or m_rotateSeconds (0 to never rotate), m_slots is the number of blocks waiting for the disk, m_direct uses O_DIRECT when the file system allows it, m_preview builds the preview pyramid and m_codecThreads
+  *are the threads compressing the blocks without losses (0 saves them as cf32)
+  */
+struct RecorderOptions{
+	long long m_rotateBytes;
+	long m_rotateSeconds;
+	int m_slots;
+	int m_direct;
+	int m_preview;
+	int m_codecThreads;
+};
+
+/**
+  *@brief Results of a recorder: bytes written, samples dropped because the disk was behind, write errors, files created, sustained rate in MB/s since it was created
+  *and size of the data written over the size of the samples as cf32
+  */
+struct RecorderStats{
+	unsigned long long m_bytes;
+	unsigned long long m_droppedSamples;
+	unsigned long long m_errors;
+	int m_files;
+	double m_rate;
+	double m_ratio;
+};
+
+#define PREVIEWLEVELS 5
+#define PREVIEWBINS 32
+
+/**
+  *@brief Entry of the preview of a recording: minimum, maximum and RMS power of the samples in dBFS and their spectrum in dBFS from -FS/2 to FS/2.
+  *Level 0 has an entry every 65536 samples and every level joins 16 entries of the level below
+  */
+struct SdrPreviewEntry{
+	float m_min;
+	float m_max;
+	float m_rms;
+	float m_spectrum[PREVIEWBINS];
+};
+
+/**
+  *@brief Options of a triggered capture: a burst starts when the mean power of m_window samples reaches m_onLevel dBFS and ends after m_holdOff samples under m_offLevel dBFS,
+  *the m_preTrigger samples before it are kept and bursts longer than m_maxBurst samples are given in parts
+  */
+struct TriggerOptions{
+	float m_onLevel;
+	float m_offLevel;
+	int m_window;
+	int m_preTrigger;
+	int m_holdOff;
+	int m_maxBurst;
+};
+
+/**
+  *@brief Results of a triggered capture: bursts found, samples watched and samples given as bursts
+  */
+struct TriggerStats{
+	unsigned long long m_bursts;
+	unsigned long long m_samples;
+	unsigned long long m_kept;
+};
+
+struct SdrStream;
+struct SdrRecorder;
+struct SdrRecording;
+struct SdrReactor;
+struct SdrManager;
+struct SdrShared;
+struct SdrTrigger;
+struct SdrAgc;
+struct SdrIqCorrection;
+struct SdrChannelizer;
+struct SdrCorrelator;
+
+/**
+  *@brief Work given to the pool of a manager, the parameter is the pointer given with it
+  */
+typedef void (*SdrTask)(void*);
+
+/**
+  *@brief How the spectrum analyzer averages the transforms
+  */
+typedef enum
+{
+	AVERAGELINEAR,
+	AVERAGEEXPONENTIAL
+} SpectrumAveraging;
+
+struct SpectrumAnalyzer;
+struct SpectrumScanner;
+
+/**
+  *@brief How the measurement sweeps look for the point they are measuring
+  */
+typedef enum
+{
+	SWEEPBISECTION,
+	SWEEPBRACKETED,
+	SWEEPMODEL
+} SweepSearch;
+
+/**
+  *@brief Parts of the hot path measured when the library is compiled with SDRAPI_METRICS
+  */
+typedef enum
+{
+	METRICCONTEXT,
+	METRICATTRIBUTE,
+	METRICBUFFERCREATE,
+	METRICPUSH,
+	METRICREFILL,
+	METRICCONVERSION,
+	METRICFILE,
+	METRICANALYSIS,
+	METRICSTAGE,
+	METRICCODEC,
+	METRICCOUNT
+} SdrMetric;
+
+#define SDRMETRICBINS 32
+
+/**
+  *@brief Counters of a metric, m_histogram[i] counts the times which took from 2^i to 2^(i+1) nanoseconds
+  */
+struct SdrMetricStats{
+	unsigned long long m_count;
+	unsigned long long m_totalNs;
+	unsigned long long m_maxNs;
+	unsigned long long m_bytes;
+	unsigned long long m_histogram[SDRMETRICBINS];
+};
+
 /** 
   *@brief Handler of the API 
 */
 struct VirtualSdr{
-	char m_location[20];
+	char m_location[256];
 	char m_RxChannel;
 	char m_TxChannel;
 	SdrConnectionType m_connectionType;
@@ -115,6 +437,7 @@ struct VirtualSdr{
 	int* m_LengthBuffer;
 	SdrFunction* m_function;
 	char** m_fileName;
+	struct SdrStream* m_streams;
 	
 	void* m_RealSdr;
 };
@@ -126,7 +449,7 @@ struct SdrConfig{
 	struct ChannelList* m_channels;
 	struct PortList* m_ports;
 	SdrConnectionType m_connectionType;
-	char m_location[20];
+	char m_location[256];
 	SdrChannel m_activeRxChannel;
 	SdrChannel m_activeTxChannel;
 	long m_minFS;
@@ -151,6 +474,42 @@ struct ChannelList{
 	int m_maxBw;
 };
 
+/**
+  *@brief Options of the sweeps done by the measurement functions, the gains are the manual hardwaregain written to the receiving port and can't be negative
+  */
+struct SweepOptions{
+	SweepSearch m_search;
+	int m_averages;
+	int m_points;
+	float m_minGain;
+	float m_maxGain;
+	float m_resolution;
+};
+
+/**
+  *@brief List of the points measured by the calibrated measurements, the value not measured yet is NAN. Each value has the time it was measured
+  */
+struct CalibrationList{
+	struct CalibrationList* m_next;
+	SdrPort m_port;
+	long m_Frec;
+	int m_Bw;
+	float m_gain;
+	float m_compressionPoint;
+	float m_IIP3;
+	long long m_compressionTime;
+	long long m_IIP3Time;
+};
+
+/**
+  *@brief Handler of the calibration store, points older than m_maxAge seconds are ignored (0 keeps them forever) and points further than m_maxSpan Hz are not interpolated
+  */
+struct SdrCalibration{
+	struct CalibrationList* m_points;
+	long m_maxAge;
+	long m_maxSpan;
+};
+
 struct PortList{
 	struct PortList* m_next;
 	SdrChannel m_channel;
@@ -188,7 +547,7 @@ VirtualSdrError ChargeConfig(struct VirtualSdr*, struct SdrConfig*);
   *@brief SetConnection Specifyes the connection between the computer and the real SDR
   *@param[in] SdrConfig* Pointer to the handler of the configuration
   *@param[in] SdrConnectionType How is the SDR connected to the PC
-  *@param[in] char* String which has the direction of the SDR
+  *@param[in] char* String which has the direction of the SDR, or the file to replay
   *@return Error code with 0 as succes
 */
 VirtualSdrError SetConnection(struct SdrConfig*, SdrConnectionType, char*);
@@ -389,136 +748,1134 @@ VirtualSdrError TransmitAlways(struct VirtualSdr*, SdrPort, int, float*, float*)
   */
 VirtualSdrError Receive(struct VirtualSdr*, SdrPort, int, float*, float*);
 
+/**
+  *@brief ReceiveStream Function to receive continuously from a port, StartSdr starts the stream and StopSdr stops it
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] int Number of data of every block
+  *@param[in] SdrBlockCallback Function called with every block, it can be NULL if only the stages are used
+  *@param[in] void* Pointer given to the function with every block
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ReceiveStream(struct VirtualSdr*, SdrPort, int, SdrBlockCallback, void*);
 
 /**
-  *@brief SendSin Test function that sends a sinus from a port and checks if it's received correctly
+  *@brief TransmitStream Function to transmit continuously from a port, zeros are sent until a burst is given with TransmitAt. StartSdr starts the stream and StopSdr stops it
   *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
-  *@param[in] float Amplitude of the sinus wanted to send, its range can be from 0 to 1
-  *@param[in] SdrPort Port from where the test transmits
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] int Number of data of every block
   *@return Error code with 0 as succes
   */
-VirtualSdrError SendSin(struct VirtualSdr*, float, SdrPort);
+VirtualSdrError TransmitStream(struct VirtualSdr*, SdrPort, int);
 
 /**
-  *@brief FindCompressionPoint Finds the compression point of the receiver by using another port to transmit
+  *@brief TransmitAt Queues a burst starting at a sample index of a streaming TX port, the buffers must be valid until the burst is sent
   *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
-  *@param[in] SdrPort Port from where the test transmits
-  *@param[in] SdrPort Port from where the test receives
-  *@param[out] float* Buffer for the attenuation where we find the 1dB compression point of the receiver
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] int Length of the burst
+  *@param[in] float* Buffer of the I data
+  *@param[in] float* Buffer of the Q data
+  *@param[in] unsigned long long Sample index where the burst starts, it must not be already given to the device nor before the end of the bursts queued
   *@return Error code with 0 as succes
   */
-VirtualSdrError FindCompressionPoint(struct VirtualSdr*, SdrPort, SdrPort, float*);
+VirtualSdrError TransmitAt(struct VirtualSdr*, SdrPort, int, float*, float*, unsigned long long);
 
 /**
-  *@brief FindIIP3 Finds the third order interception point of the receiver by using another port to transmit
+  *@brief QueueBurst Queues a burst on a streaming TX port just after the previous one plus the gap of the port, or as soon as possible if the queue is empty. The buffers must be valid until the burst is sent
   *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
-  *@param[in] SdrPort Port from where the test transmits
-  *@param[in] SdrPort Port from where the test receives
-  *@param[out] float* Buffer for the attenuation where we find the IIP3 of the receiver
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] int Length of the burst
+  *@param[in] float* Buffer of the I data
+  *@param[in] float* Buffer of the Q data
+  *@return Error code with 0 as succes, PORTBUSY if the queue is full
+  */
+VirtualSdrError QueueBurst(struct VirtualSdr*, SdrPort, int, float*, float*);
+
+/**
+  *@brief SetBurstGap Sets the number of zero samples between the bursts queued with QueueBurst
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] int Samples of the gap, 0 for back-to-back bursts
   *@return Error code with 0 as succes
   */
-VirtualSdrError FindIIP3(struct VirtualSdr*, SdrPort, SdrPort, float*);
+VirtualSdrError SetBurstGap(struct VirtualSdr*, SdrPort, int);
 
 /**
-  *@brief SaveConfiguration Saves the configuration created by the user to a file
-  *@param[in] SdrConfig* Pointer to the handler of the configuration
-  *@param[out] char* String of the name of the file where the configuration will be stored
+  *@brief SetBurstCallback Sets a function to be called from the thread of the port every time a burst is completed
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] SdrBurstCallback Function to call, NULL to remove it
+  *@param[in] void* Pointer given to the function
   *@return Error code with 0 as succes
   */
-VirtualSdrError SaveConfiguration(struct SdrConfig*, char*);
+VirtualSdrError SetBurstCallback(struct VirtualSdr*, SdrPort, SdrBurstCallback, void*);
 
 /**
-  *@brief LoadConfiguration Loads the configuration descripted in a file
-  *@param[in] SdrConfig* Pointer to the handler of the configuration
-  *@param[in] char* String of the name of the file where the configuration is stored
+  *@brief GetBurstQueue Gets the number of bursts of a streaming TX port not completed yet
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to check
+  *@param[out] int* Buffer to store the number of bursts
   *@return Error code with 0 as succes
   */
-VirtualSdrError LoadConfiguration(struct SdrConfig*, char*);
+VirtualSdrError GetBurstQueue(struct VirtualSdr*, SdrPort, int*);
 
 /**
-  *@brief TransmitFromFileOnce Reads a file and transmits only one time its data
+  *@brief SetPortPolled Makes a streaming port be driven by the user instead of its own thread. StartSdr puts its buffer in non-blocking mode and the blocks are moved with ServicePort or a reactor
   *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
-  *@param[in] SdrPort Port to transmit
-  *@param[in] char* String of the name of the file to read the data from 
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] ChannelType RX or TX port
+  *@param[in] int 1 to drive the port by the user, 0 to use a thread
   *@return Error code with 0 as succes
   */
-VirtualSdrError TransmitFromFileOnce(struct VirtualSdr*,SdrPort,char*);
+VirtualSdrError SetPortPolled(struct VirtualSdr*, SdrPort, ChannelType, int);
 
 /**
-  *@brief TransmitFromFile Reads a file and transmits continuously its data
+  *@brief GetPortPollFd Gets the file descriptor of a started port driven by the user, it's readable (RX) or writable (TX) when a block can be moved
   *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
-  *@param[in] SdrPort Port to transmit
-  *@param[in] char* String of the name of the file to read the data from 
+  *@param[in] SdrPort Port to check
+  *@param[in] ChannelType RX or TX port
+  *@param[out] int* Buffer to store the file descriptor
+  *@return Error code with 0 as succes, NOTIMPLEMENTED if the connection can't be polled
+  */
+VirtualSdrError GetPortPollFd(struct VirtualSdr*, SdrPort, ChannelType, int*);
+
+/**
+  *@brief ServicePort Moves one block of a started port driven by the user without blocking
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to service
+  *@param[in] ChannelType RX or TX port
+  *@return Error code with 0 as succes, PORTBUSY if the device isn't ready
+  */
+VirtualSdrError ServicePort(struct VirtualSdr*, SdrPort, ChannelType);
+
+/**
+  *@brief CreateReactor Creates an epoll loop to service the ports driven by the user of many Virtual SDRs from one thread
+  *@param[out] SdrReactor** Pointer to store the new reactor
   *@return Error code with 0 as succes
   */
-VirtualSdrError TransmitFromFile(struct VirtualSdr*,SdrPort, char*);
+VirtualSdrError CreateReactor(struct SdrReactor**);
 
 /**
-  *@brief ReceiveToFile Reads a RX port and saves its data to a file
-  *@param[in] VirtualSdr* Pointer to the Sdr from we want to read
-  *@param[in] SdrPort Port to read from
-  *@param[in] int Number of points to read
-  *@param[out] char* String of the name of the file where we save the data
+  *@brief ReactorAdd Adds all the started ports driven by the user of a Virtual SDR to a reactor, a replay port can't be added and gives NOTIMPLEMENTED. If a port fails none of them is left in the reactor
+  *@param[in] SdrReactor* Reactor to use
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to add
   *@return Error code with 0 as succes
   */
-VirtualSdrError ReceiveToFile(struct VirtualSdr*, SdrPort, int, char*);
+VirtualSdrError ReactorAdd(struct SdrReactor*, struct VirtualSdr*);
 
+/**
+  *@brief ReactorRun Waits for ports ready and moves one block of each
+  *@param[in] SdrReactor* Reactor to use
+  *@param[in] int Maximum time to wait in ms, -1 to wait forever
+  *@param[out] int* Buffer to store the number of blocks moved, it can be NULL
+  *@return Error code with 0 as succes, INVALIDVALUE if the wait fails
+  */
+VirtualSdrError ReactorRun(struct SdrReactor*, int, int*);
 
 /**
-  *@brief CheckPortState Function to know if a port is transmitting/receiving or not
+  *@brief FreeReactor Frees a reactor, the Virtual SDRs aren't changed
+  *@param[in] SdrReactor* Reactor to free
+  */
+void FreeReactor(struct SdrReactor*);
+
+/**
+  *@brief DefaultThreadOptions Fills the options with a thread not pinned and with the normal scheduler
+  *@param[out] SdrThreadOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultThreadOptions(struct SdrThreadOptions*);
+
+/**
+  *@brief SetThreadOptions Sets the placement of the thread of a streaming port, it's applied by StartSdr to that thread only and not to the threads of the stages. SCHED_FIFO needs privileges, GetPortStatus tells if it was applied
   *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
-  *@param[in] SdrPort Port to heck the state
-  *@param[in] ChannelType Check RX or TX ports
-  *@param[out] SdrPortState* It can be ON if the port is trnasmitting/receiving or OFF if the port is inactive
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] ChannelType RX or TX port
+  *@param[in] SdrThreadOptions* Options of the thread
   *@return Error code with 0 as succes
   */
-VirtualSdrError CheckPortState(struct VirtualSdr*, SdrPort, ChannelType, SdrPortState*);
+VirtualSdrError SetThreadOptions(struct VirtualSdr*, SdrPort, ChannelType, struct SdrThreadOptions*);
 
 /**
-  *@brief LoadBSP Loades a board support package which has the relevant information about your device
-  *@param[in] SdrConfig* Pointer to the handler of the configuration
-  *@param[in] char* File that has the information about the Real Sdr data in csv format
+  *@brief DefaultBuffering Fills the buffering with the length given with the function of the port and the kernel buffers of the driver
+  *@param[out] SdrBuffering* Buffering to fill
   *@return Error code with 0 as succes
   */
-VirtualSdrError LoadBSP(struct SdrConfig*, char*);
+VirtualSdrError DefaultBuffering(struct SdrBuffering*);
 
 /**
-  *@brief GetPLLParam Returns to the user the parameters of the pll
-  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use, it must be connected to the real SDR
-  *@param[out] float* M parameter of the pll
-  *@param[out] float* N parameter of the pll
-  *@param[out] float* P parameter of the pll
+  *@brief SetBuffering Sets the buffering of a port, it's applied by StartSdr. Only streaming ports change their block, the kernel buffers are shared by the ports of the same direction
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] ChannelType RX or TX port
+  *@param[in] SdrBuffering* Buffering of the port
   *@return Error code with 0 as succes
   */
-VirtualSdrError GetPLLParam(struct VirtualSdr*, float*, float*, float*);
+VirtualSdrError SetBuffering(struct VirtualSdr*, SdrPort, ChannelType, struct SdrBuffering*);
 
 /**
-  *@brief SetFilter 
-  *@param[in] SdrConfig* Pointer to the handler of the configuration
-  *@param[in] FilterType* Which type of filter is going to be used
+  *@brief GetBuffering Gets the block and kernel buffers of a port, the ones used if it's started or the ones it would use otherwise (4 kernel buffers without any setting, 0 if the device didn't take the count)
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to check
+  *@param[in] ChannelType RX or TX port
+  *@param[out] int* Buffer to store the samples of every block
+  *@param[out] int* Buffer to store the number of kernel buffers
   *@return Error code with 0 as succes
   */
-VirtualSdrError SetFilter (struct SdrConfig*, FilterType*);
+VirtualSdrError GetBuffering(struct VirtualSdr*, SdrPort, ChannelType, int*, int*);
 
 /**
-  *@brief GetFilter 
-  *@param[in] SdrConfig* Pointer to the handler of the configuration
-  *@param[out] FilterType* Which type of filter is using
+  *@brief GetPortTime Gets the sample index and the host time in ns of the first sample of the last block moved by a port
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to check
+  *@param[in] ChannelType Check RX or TX ports
+  *@param[out] unsigned long long* Buffer to store the sample index
+  *@param[out] unsigned long long* Buffer to store the time
   *@return Error code with 0 as succes
   */
-VirtualSdrError GetFilter (struct SdrConfig*, FilterType*);
+VirtualSdrError GetPortTime(struct VirtualSdr*, SdrPort, ChannelType, unsigned long long*, unsigned long long*);
 
 /**
-  *@brief PrintSdrConfig Function to print configuration
-  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  *@brief GetPortStatus Gets the accounting of a port, it can be called while the port is streaming
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to check
+  *@param[in] ChannelType Check RX or TX ports
+  *@param[out] SdrPortStatus* Buffer to store the accounting
+  *@return Error code with 0 as succes
   */
-void PrintSdrConfig (struct SdrConfig*);
+VirtualSdrError GetPortStatus(struct VirtualSdr*, SdrPort, ChannelType, struct SdrPortStatus*);
 
 /**
-  *@brief FreeSdrConfig Function to free all the memory allocated in the configuration handler
-  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  *@brief SetXflowCallback Sets a function to be called from the thread of the port when it loses samples or gets an error
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to watch
+  *@param[in] ChannelType Watch RX or TX ports
+  *@param[in] SdrXflowCallback Function to call, NULL to remove it
+  *@param[in] void* Pointer given to the function
+  *@return Error code with 0 as succes
   */
-void FreeSdrConfig (struct SdrConfig*);
+VirtualSdrError SetXflowCallback(struct VirtualSdr*, SdrPort, ChannelType, SdrXflowCallback, void*);
+
+/**
+  *@brief EnableSignalStats Adds the measure of the signal statistics as a stage of a streaming port, every block is measured in one pass
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to measure
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError EnableSignalStats(struct VirtualSdr*, SdrPort);
+
+/**
+  *@brief GetSignalStats Gets the signal statistics of a port, it can be called while the port is streaming
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to check
+  *@param[out] SdrSignalStats* Buffer to store the statistics
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetSignalStats(struct VirtualSdr*, SdrPort, struct SdrSignalStats*);
+
+/**
+  *@brief DefaultAgcOptions Fills the options of the AGC: -20dBFS with 3dB of hysteresis, gain from 0 to 71dB in steps up to 6dB and 4 blocks averaged
+  *@param[out] AgcOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultAgcOptions(struct AgcOptions*);
+
+/**
+  *@brief CreateAgc Creates a software AGC which writes the hardwaregain of a streaming port from the power of its blocks, the port is set to manual gain with the first change
+  *@param[out] SdrAgc** Pointer to store the new AGC
+  *@param[in] AgcOptions* Options of the AGC, NULL for the default ones
+  *@param[in] SdrGainCallback Function called with every change, NULL if not needed
+  *@param[in] void* Pointer given to the function
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateAgc(struct SdrAgc**, struct AgcOptions*, SdrGainCallback, void*);
+
+/**
+  *@brief AttachAgc Adds the AGC as a stage of a streaming port, every start of the port it takes the gain mode and the gain from the device (a replay starts from the gain of the port or the middle of the range). An AGC controls only one port, PORTBUSY if it's already attached
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to control
+  *@param[in] SdrAgc* AGC to use
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AttachAgc(struct VirtualSdr*, SdrPort, struct SdrAgc*);
+
+/**
+  *@brief DetachAgc Removes the AGC from the port it was attached to, PORTBUSY if the port is streaming
+  *@param[in] SdrAgc* AGC to detach
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DetachAgc(struct SdrAgc*);
+
+/**
+  *@brief GetAgcStatus Gets the state of an AGC, it can be called while the port is streaming
+  *@param[in] SdrAgc* AGC to check
+  *@param[out] AgcStatus* Buffer to store the state
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetAgcStatus(struct SdrAgc*, struct AgcStatus*);
+
+/**
+  *@brief FreeAgc Detaches and frees an AGC, the port must be stopped before and the Virtual SDR freed after
+  *@param[in] SdrAgc* AGC to free
+  */
+void FreeAgc(struct SdrAgc*);
+
+/**
+  *@brief DefaultIqCorrectionOptions Fills the options of the I/Q correction: 5% of weight for every block, DC and imbalance corrected
+  *@param[out] IqCorrectionOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultIqCorrectionOptions(struct IqCorrectionOptions*);
+
+/**
+  *@brief CreateIqCorrection Creates a correction of the DC offset and the I/Q imbalance of a streaming port, it starts with no imbalance
+  *@param[out] SdrIqCorrection** Pointer to store the new correction
+  *@param[in] IqCorrectionOptions* Options of the correction, NULL for the default ones
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateIqCorrection(struct SdrIqCorrection**, struct IqCorrectionOptions*);
+
+/**
+  *@brief AttachIqCorrection Adds the correction as a stage of a streaming port. On RX the imbalance is estimated with the blocks while they are corrected,
+  *assuming I and Q of the signal have the same power and are uncorrelated. On TX the blocks are predistorted with the coefficients given, so the imbalance of the port gives the wanted signal
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] ChannelType RX or TX
+  *@param[in] SdrIqCorrection* Correction to attach, only to one port: PORTBUSY if it's already attached
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AttachIqCorrection(struct VirtualSdr*, SdrPort, ChannelType, struct SdrIqCorrection*);
+
+/**
+  *@brief DetachIqCorrection Removes the correction from the port it was attached to, PORTBUSY if the port is streaming
+  *@param[in] SdrIqCorrection* Correction to detach
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DetachIqCorrection(struct SdrIqCorrection*);
+
+/**
+  *@brief SetIqCoefficients Sets the imbalance to correct, the one used by a TX port or the starting point of the estimation of a RX port
+  *@param[in] SdrIqCorrection* Correction to change
+  *@param[in] SdrIqCoefficients* Imbalance of the port, the phase must be within +-45 degrees
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError SetIqCoefficients(struct SdrIqCorrection*, struct SdrIqCoefficients*);
+
+/**
+  *@brief GetIqCoefficients Gets the imbalance the correction is using
+  *@param[in] SdrIqCorrection* Correction to read
+  *@param[out] SdrIqCoefficients* Imbalance of the port
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetIqCoefficients(struct SdrIqCorrection*, struct SdrIqCoefficients*);
+
+/**
+  *@brief FreeIqCorrection Detaches and frees a correction, the port must be stopped before and the Virtual SDR freed after
+  *@param[in] SdrIqCorrection* Correction to free
+  */
+void FreeIqCorrection(struct SdrIqCorrection*);
+
+/**
+  *@brief AddRxStage Adds a processing stage to a streaming port, stages are called in the order they were added and before the function of ReceiveStream
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] SdrBlockCallback Function of the stage, it can change the block in place
+  *@param[in] void* Pointer given to the function with every block
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AddRxStage(struct VirtualSdr*, SdrPort, SdrBlockCallback, void*);
+
+/**
+  *@brief AddTxStage Adds a processing stage to a streaming TX port, stages are called in the order they were added with every block just before it is converted and pushed
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to use
+  *@param[in] SdrBlockCallback Function of the stage, it can change the block in place
+  *@param[in] void* Pointer given to the function with every block
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AddTxStage(struct VirtualSdr*, SdrPort, SdrBlockCallback, void*);
+
+/**
+  *@brief CreateSdrManager Creates a manager for many Virtual SDRs with a pool of workers shared by all of them
+  *@param[out] SdrManager** Pointer to store the new manager
+  *@param[in] int Number of workers of the pool
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateSdrManager(struct SdrManager**, int);
+
+/**
+  *@brief ManagerAdd Adds a Virtual SDR to a manager, it must have its configuration charged
+  *@param[in] SdrManager* Manager to use
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to add
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ManagerAdd(struct SdrManager*, struct VirtualSdr*);
+
+/**
+  *@brief ManagerStart Calls StartSdr of all the Virtual SDRs of a manager in parallel and waits for them
+  *@param[in] SdrManager* Manager to use
+  *@param[out] VirtualSdrError* Buffer to store the result of every Virtual SDR in the order they were added, it can be NULL
+  *@return Error code with 0 as succes, otherwise the first error in the order they were added
+  */
+VirtualSdrError ManagerStart(struct SdrManager*, VirtualSdrError*);
+
+/**
+  *@brief ManagerStop Calls StopSdr of all the Virtual SDRs of a manager in parallel and waits for them
+  *@param[in] SdrManager* Manager to use
+  *@param[out] VirtualSdrError* Buffer to store the result of every Virtual SDR in the order they were added, it can be NULL
+  *@return Error code with 0 as succes, otherwise the first error in the order they were added
+  */
+VirtualSdrError ManagerStop(struct SdrManager*, VirtualSdrError*);
+
+/**
+  *@brief ManagerSubmit Gives a work to the pool of a manager, like the processing or saving of blocks
+  *@param[in] SdrManager* Manager to use
+  *@param[in] SdrTask Function to run in a worker
+  *@param[in] void* Pointer given to the function
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ManagerSubmit(struct SdrManager*, SdrTask, void*);
+
+/**
+  *@brief ManagerWait Waits until all the works given to the pool of a manager are done
+  *@param[in] SdrManager* Manager to use
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ManagerWait(struct SdrManager*);
+
+/**
+  *@brief FreeSdrManager Waits for the works given and frees a manager, the Virtual SDRs aren't stopped nor freed
+  *@param[in] SdrManager* Manager to free
+  */
+void FreeSdrManager(struct SdrManager*);
+
+
+/**
+  *@brief SendSin Test function that sends a sinus from a port and checks if it's received correctly
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] float Amplitude of the sinus wanted to send, its range can be from 0 to 1
+  *@param[in] SdrPort Port from where the test transmits
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError SendSin(struct VirtualSdr*, float, SdrPort);
+
+/**
+  *@brief MeasureTonePower Measures the power of some tones of a received signal with goertzel filters, without doing the whole fft
+  *@param[in] float* Buffer of the I data
+  *@param[in] float* Buffer of the Q data
+  *@param[in] int Length of the buffers
+  *@param[in] long Sampling frecuency of the data
+  *@param[in] double* Frecuencies of the tones relative to the LO, negative if they are below it
+  *@param[in] int Number of tones
+  *@param[out] float* Buffer to store the power of each tone in dBFS
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError MeasureTonePower(float*, float*, int, long, double*, int, float*);
+
+/**
+  *@brief CreateSpectrumAnalyzer Creates a spectrum analyzer which averages overlapped windowed ffts as the blocks arrive
+  *@param[out] SpectrumAnalyzer** Buffer to store the new analyzer
+  *@param[in] int Size of the fft, it must be a power of 2
+  *@param[in] int Number of samples shared by two consecutive ffts
+  *@param[in] SpectrumAveraging How the ffts are averaged
+  *@param[in] float Weight of every new fft in the exponential average, from 0 to 1
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateSpectrumAnalyzer(struct SpectrumAnalyzer**, int, int, SpectrumAveraging, float);
+
+/**
+  *@brief SpectrumAnalyzerPush Gives a block of samples to the analyzer
+  *@param[in] SpectrumAnalyzer* Pointer to the analyzer
+  *@param[in] float* Buffer of the I data
+  *@param[in] float* Buffer of the Q data
+  *@param[in] int Length of the buffers
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError SpectrumAnalyzerPush(struct SpectrumAnalyzer*, float*, float*, int);
+
+/**
+  *@brief AttachSpectrumAnalyzer Adds the analyzer as a stage of a streaming port. An analyzer watches only one port, PORTBUSY if it's already attached
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Receiving port
+  *@param[in] SpectrumAnalyzer* Pointer to the analyzer
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AttachSpectrumAnalyzer(struct VirtualSdr*, SdrPort, struct SpectrumAnalyzer*);
+
+/**
+  *@brief DetachSpectrumAnalyzer Removes the analyzer from the port it was attached to, PORTBUSY if the port is streaming
+  *@param[in] SpectrumAnalyzer* Pointer to the analyzer
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DetachSpectrumAnalyzer(struct SpectrumAnalyzer*);
+
+/**
+  *@brief GetSpectrum Reads the spectrum from -FS/2 to FS/2, a full scale tone is 0dBFS. It can be called while the port is streaming
+  *@param[in] SpectrumAnalyzer* Pointer to the analyzer
+  *@param[out] float* Buffer to store the averaged power in dBFS, as long as the fft
+  *@param[out] float* Buffer to store the max hold in dBFS, it can be NULL
+  *@param[out] long* Buffer to store the number of ffts averaged, it can be NULL
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetSpectrum(struct SpectrumAnalyzer*, float*, float*, long*);
+
+/**
+  *@brief ResetSpectrum Clears the average and the max hold of the analyzer
+  *@param[in] SpectrumAnalyzer* Pointer to the analyzer
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ResetSpectrum(struct SpectrumAnalyzer*);
+
+/**
+  *@brief FreeSpectrumAnalyzer Function to detach the analyzer and free all its memory, the port must be stopped before and the Virtual SDR freed after
+  *@param[in] SpectrumAnalyzer* Pointer to the analyzer
+  */
+void FreeSpectrumAnalyzer(struct SpectrumAnalyzer*);
+
+/**
+  *@brief CreateScanner Creates a scanner which moves the LO of a receiving port across a range and joins the spectrum of every segment
+  *@param[out] SpectrumScanner** Buffer to store the new scanner
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR, the scanner uses the configuration of the port and its own connection
+  *@param[in] SdrPort Receiving port
+  *@param[in] long First frecuency of the range
+  *@param[in] long Last frecuency of the range
+  *@param[in] int Size of the fft of every segment, it must be a power of 2
+  *@param[in] float Part of every segment which is kept, the edges of the band are discarded
+  *@param[in] int Number of ffts averaged in every segment
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateScanner(struct SpectrumScanner**, struct VirtualSdr*, SdrPort, long, long, int, float, int);
+
+/**
+  *@brief GetScanLength Gets how many bins has the spectrum of the scanner
+  *@param[in] SpectrumScanner* Pointer to the scanner
+  *@param[out] int* Buffer to store the number of bins
+  *@param[out] double* Buffer to store the frecuency of the first bin, it can be NULL
+  *@param[out] double* Buffer to store the width of every bin, it can be NULL
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetScanLength(struct SpectrumScanner*, int*, double*, double*);
+
+/**
+  *@brief RunScan Does a whole sweep of the range
+  *@param[in] SpectrumScanner* Pointer to the scanner
+  *@param[out] float* Buffer to store the spectrum in dBFS, with the length given by GetScanLength
+  *@param[out] double* Buffer to store the speed of the sweep in GHz/s, it can be NULL
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError RunScan(struct SpectrumScanner*, float*, double*);
+
+/**
+  *@brief FreeScanner Function to free the scanner and close its connection
+  *@param[in] SpectrumScanner* Pointer to the scanner
+  */
+void FreeScanner(struct SpectrumScanner*);
+
+/**
+  *@brief DefaultChannelizerOptions Fills the options of the channelizer: 16 channels, 12 taps per channel and no extra threads
+  *@param[out] ChannelizerOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultChannelizerOptions(struct ChannelizerOptions*);
+
+/**
+  *@brief CreateChannelizer Creates a polyphase filter bank which splits a stream in M channels of FS/M decimated by M. Channel c is centered at c*FS/M,
+  *the ones from M/2 are the negative frecuencies. The samples of a channel are numbered as the input ones divided by M
+  *@param[out] SdrChannelizer** Pointer to store the new channelizer
+  *@param[in] ChannelizerOptions* Options of the channelizer, NULL for the default ones
+  *@param[in] SdrChannelCallback Function called with the block of every channel
+  *@param[in] void* Pointer given to the function
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateChannelizer(struct SdrChannelizer**, struct ChannelizerOptions*, SdrChannelCallback, void*);
+
+/**
+  *@brief ChannelizerPush Gives a block of samples to the channelizer, they follow the ones given before
+  *@param[in] SdrChannelizer* Pointer to the channelizer
+  *@param[in] float* Buffer of the I data
+  *@param[in] float* Buffer of the Q data
+  *@param[in] int Length of the buffers
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ChannelizerPush(struct SdrChannelizer*, float*, float*, int);
+
+/**
+  *@brief AttachChannelizer Adds the channelizer as a stage of a streaming port, a gap in the samples of the port clears its filters. A channelizer filters only one port, PORTBUSY if it's already attached
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Receiving port
+  *@param[in] SdrChannelizer* Pointer to the channelizer
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AttachChannelizer(struct VirtualSdr*, SdrPort, struct SdrChannelizer*);
+
+/**
+  *@brief DetachChannelizer Removes the channelizer from the port it was attached to, PORTBUSY if the port is streaming
+  *@param[in] SdrChannelizer* Pointer to the channelizer
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DetachChannelizer(struct SdrChannelizer*);
+
+/**
+  *@brief FreeChannelizer Detaches the channelizer, stops the threads and frees it. The port must be stopped before and the Virtual SDR freed after
+  *@param[in] SdrChannelizer* Pointer to the channelizer
+  */
+void FreeChannelizer(struct SdrChannelizer*);
+
+/**
+  *@brief MeasureDelay Measures the delay and phase of a signal against another one with the same length using the cross correlation
+  *@param[in] float* Buffer of the I data of the first signal
+  *@param[in] float* Buffer of the Q data of the first signal
+  *@param[in] float* Buffer of the I data of the second signal
+  *@param[in] float* Buffer of the Q data of the second signal
+  *@param[in] int Length of the buffers
+  *@param[out] SdrDelay* Buffer to store the result, the delay is positive if the second signal comes later
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError MeasureDelay(float*, float*, float*, float*, int, struct SdrDelay*);
+
+/**
+  *@brief DefaultCorrelatorOptions Fills the options of the correlator: segments of 4096 samples, 8 averaged and 1 thread
+  *@param[out] CorrelatorOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultCorrelatorOptions(struct CorrelatorOptions*);
+
+/**
+  *@brief CreateCorrelator Creates a correlator which measures the delay between the segments of two signals with the same sample index, the cross spectra of the segments are averaged
+  *@param[out] SdrCorrelator** Pointer to store the new correlator
+  *@param[in] CorrelatorOptions* Options of the correlator, NULL for the default ones
+  *@param[in] SdrDelayCallback Function called with every result, NULL if only GetDelay is used
+  *@param[in] void* Pointer given to the function
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateCorrelator(struct SdrCorrelator**, struct CorrelatorOptions*, SdrDelayCallback, void*);
+
+/**
+  *@brief SetCorrelatorReference Sets a known signal, like the one transmitted by a TX port, which is used instead of the first signal and is needed to attach the correlator. The delay is where it starts in the segment
+  *@param[in] SdrCorrelator* Pointer to the correlator, it must not be attached
+  *@param[in] float* Buffer of the I data, it is copied
+  *@param[in] float* Buffer of the Q data, it is copied
+  *@param[in] int Length of the reference, up to the size of the segments
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError SetCorrelatorReference(struct SdrCorrelator*, float*, float*, int);
+
+/**
+  *@brief CorrelatorPush Gives coherent blocks of both signals to the correlator, they follow the ones given before
+  *@param[in] SdrCorrelator* Pointer to the correlator
+  *@param[in] float* Buffer of the I data of the first signal, ignored if there is a reference
+  *@param[in] float* Buffer of the Q data of the first signal, ignored if there is a reference
+  *@param[in] float* Buffer of the I data of the second signal
+  *@param[in] float* Buffer of the Q data of the second signal
+  *@param[in] int Length of the buffers
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CorrelatorPush(struct SdrCorrelator*, float*, float*, float*, float*, int);
+
+/**
+  *@brief AttachCorrelator Adds the correlator as a stage of a receiving port, which is the second signal compared with the reference. Two ports aren't coherent when streamed separately, so they are given with CorrelatorPush. PORTBUSY if it's already attached
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Receiving port
+  *@param[in] SdrCorrelator* Pointer to the correlator
+  *@return Error code with 0 as succes, INVALIDVALUE if the correlator has no reference
+  */
+VirtualSdrError AttachCorrelator(struct VirtualSdr*, SdrPort, struct SdrCorrelator*);
+
+/**
+  *@brief DetachCorrelator Removes the correlator from the port it was attached to, PORTBUSY if the port is streaming
+  *@param[in] SdrCorrelator* Pointer to the correlator
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DetachCorrelator(struct SdrCorrelator*);
+
+/**
+  *@brief GetDelay Gets the last result of the correlator
+  *@param[in] SdrCorrelator* Pointer to the correlator
+  *@param[out] SdrDelay* Buffer to store the result
+  *@param[out] unsigned long long* Buffer to store the segments lost because a port went ahead of the other one or the threads were busy, it can be NULL
+  *@return Error code with 0 as succes, NOTSTREAMING if there is no result yet
+  */
+VirtualSdrError GetDelay(struct SdrCorrelator*, struct SdrDelay*, unsigned long long*);
+
+/**
+  *@brief FreeCorrelator Detaches the correlator, stops the threads and frees it. The ports must be stopped before and the Virtual SDR freed after
+  *@param[in] SdrCorrelator* Pointer to the correlator
+  */
+void FreeCorrelator(struct SdrCorrelator*);
+
+/**
+  *@brief FindCompressionPoint Finds the compression point of the receiver by using another port to transmit
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port from where the test transmits
+  *@param[in] SdrPort Port from where the test receives
+  *@param[out] float* Buffer for the gain where we find the 1dB compression point of the receiver
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError FindCompressionPoint(struct VirtualSdr*, SdrPort, SdrPort, float*);
+
+/**
+  *@brief DefaultSweepOptions Fills the options with the sweep used by FindCompressionPoint and FindIIP3: bracketed search of 8 points from 0 to 71dB with 0.25dB of resolution
+  *@param[out] SweepOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultSweepOptions(struct SweepOptions*);
+
+/**
+  *@brief FindCompressionPointSweep Finds the compression point of the receiver capturing the next step while the previous one is analyzed. The sweep uses its own connection,
+  *the receiving port is left in manual gain and the reference is taken at its gain, or at the bottom of the range if it was in automatic gain
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port from where the test transmits
+  *@param[in] SdrPort Port from where the test receives
+  *@param[in] SweepOptions* Search, averages and range of the sweep, NULL to use the default ones
+  *@param[out] float* Buffer for the gain where we find the 1dB compression point of the receiver
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError FindCompressionPointSweep(struct VirtualSdr*, SdrPort, SdrPort, struct SweepOptions*, float*);
+
+/**
+  *@brief FindIIP3 Finds the third order interception point of the receiver by using another port to transmit
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port from where the test transmits
+  *@param[in] SdrPort Port from where the test receives
+  *@param[out] float* Buffer for the attenuation where we find the IIP3 of the receiver
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError FindIIP3(struct VirtualSdr*, SdrPort, SdrPort, float*);
+
+/**
+  *@brief FindIIP3Sweep Finds the third order interception point of the receiver averaging several captures, which are taken while the previous ones are analyzed
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port from where the test transmits
+  *@param[in] SdrPort Port from where the test receives
+  *@param[in] SweepOptions* Options of the sweep, only the averages are used, NULL to use the default ones
+  *@param[out] float* Buffer for the attenuation where we find the IIP3 of the receiver
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError FindIIP3Sweep(struct VirtualSdr*, SdrPort, SdrPort, struct SweepOptions*, float*);
+
+/**
+  *@brief InitCalibration Initializes an empty calibration store
+  *@param[out] SdrCalibration* Pointer to the handler of the calibration
+  *@param[in] long Age in seconds after which a point is not valid anymore, 0 if they never expire
+  *@param[in] long Maximum distance in Hz between two points to interpolate between them
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError InitCalibration(struct SdrCalibration*, long, long);
+
+/**
+  *@brief QueryCalibration Gets the linearity limits of a configuration from the store without using the hardware
+  *@param[in] SdrCalibration* Pointer to the handler of the calibration
+  *@param[in] SdrPort Receiving port
+  *@param[in] long Frecuency of the LO
+  *@param[in] int Bandwidth of the port
+  *@param[in] float Gain of the port
+  *@param[out] float* Buffer to store the compression point, NAN if there is no valid calibration
+  *@param[out] float* Buffer to store the IIP3, NAN if there is no valid calibration
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError QueryCalibration(struct SdrCalibration*, SdrPort, long, int, float, float*, float*);
+
+/**
+  *@brief CalibratedCompressionPoint Gets the compression point from the store, it's only measured with FindCompressionPoint if there is no valid calibration
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrCalibration* Pointer to the handler of the calibration
+  *@param[in] SdrPort Port from where the test transmits
+  *@param[in] SdrPort Port from where the test receives
+  *@param[out] float* Buffer for the attenuation where we find the 1dB compression point of the receiver
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CalibratedCompressionPoint(struct VirtualSdr*, struct SdrCalibration*, SdrPort, SdrPort, float*);
+
+/**
+  *@brief CalibratedIIP3 Gets the IIP3 from the store, it's only measured with FindIIP3 if there is no valid calibration
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrCalibration* Pointer to the handler of the calibration
+  *@param[in] SdrPort Port from where the test transmits
+  *@param[in] SdrPort Port from where the test receives
+  *@param[out] float* Buffer for the attenuation where we find the IIP3 of the receiver
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CalibratedIIP3(struct VirtualSdr*, struct SdrCalibration*, SdrPort, SdrPort, float*);
+
+/**
+  *@brief InvalidateCalibration Removes the points of a port from the store
+  *@param[in] SdrCalibration* Pointer to the handler of the calibration
+  *@param[in] SdrPort Port to invalidate, 0 removes every point
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError InvalidateCalibration(struct SdrCalibration*, SdrPort);
+
+/**
+  *@brief SaveCalibration Saves the points which haven't expired to a binary file
+  *@param[in] SdrCalibration* Pointer to the handler of the calibration
+  *@param[in] char* String of the name of the file
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError SaveCalibration(struct SdrCalibration*, char*);
+
+/**
+  *@brief LoadCalibration Adds the points saved in a file to the store
+  *@param[in] SdrCalibration* Pointer to the handler of the calibration
+  *@param[in] char* String of the name of the file
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError LoadCalibration(struct SdrCalibration*, char*);
+
+/**
+  *@brief CopySdrConfig Makes a deep copy of a configuration, the destination must be empty or freed
+  *@param[out] SdrConfig* Configuration where the copy is stored
+  *@param[in] SdrConfig* Configuration to copy
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CopySdrConfig(struct SdrConfig*, struct SdrConfig*);
+
+/**
+  *@brief CreateSharedConfig Creates a configuration shared between threads with a copy of the one given as the first version.
+  *Readers never block: AcquireConfig gives the current version, which isn't changed nor freed until ReleaseConfig.
+  *Writers change their own SdrConfig with the setters and publish it with PublishConfig
+  *@param[out] SdrShared** Pointer to store the new shared configuration
+  *@param[in] SdrConfig* First version
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateSharedConfig(struct SdrShared**, struct SdrConfig*);
+
+/**
+  *@brief PublishConfig Publishes a copy of a configuration as the new version, the readers of the previous one keep using it
+  *@param[in] SdrShared* Shared configuration to use
+  *@param[in] SdrConfig* Configuration to publish, it stays owned by the writer
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError PublishConfig(struct SdrShared*, struct SdrConfig*);
+
+/**
+  *@brief AcquireConfig Gets the current version of a shared configuration, it must only be read and given back with ReleaseConfig
+  *@param[in] SdrShared* Shared configuration to use
+  *@param[out] SdrConfig** Pointer to store the version
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AcquireConfig(struct SdrShared*, struct SdrConfig**);
+
+/**
+  *@brief ReleaseConfig Gives back a version taken with AcquireConfig
+  *@param[in] SdrShared* Shared configuration to use
+  *@param[in] SdrConfig* Version to give back
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ReleaseConfig(struct SdrShared*, struct SdrConfig*);
+
+/**
+  *@brief FreeSharedConfig Frees a shared configuration, no reader can have a version
+  *@param[in] SdrShared* Shared configuration to free
+  */
+void FreeSharedConfig(struct SdrShared*);
+
+/**
+  *@brief SaveConfiguration Saves the configuration created by the user to a file
+  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  *@param[out] char* String of the name of the file where the configuration will be stored
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError SaveConfiguration(struct SdrConfig*, char*);
+
+/**
+  *@brief LoadConfiguration Loads the configuration descripted in a file
+  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  *@param[in] char* String of the name of the file where the configuration is stored
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError LoadConfiguration(struct SdrConfig*, char*);
+
+/**
+  *@brief TransmitFromFileOnce Reads a file and transmits only one time its data
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to transmit
+  *@param[in] char* String of the name of the file to read the data from 
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError TransmitFromFileOnce(struct VirtualSdr*,SdrPort,char*);
+
+/**
+  *@brief TransmitFromFile Reads a file and transmits continuously its data
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to transmit
+  *@param[in] char* String of the name of the file to read the data from 
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError TransmitFromFile(struct VirtualSdr*,SdrPort, char*);
+
+/**
+  *@brief ReceiveToFile Reads a RX port and saves its data to a file, with the same scale as Receive and ReceiveStream
+  *@param[in] VirtualSdr* Pointer to the Sdr from we want to read
+  *@param[in] SdrPort Port to read from
+  *@param[in] int Number of points to read
+  *@param[out] char* String of the name of the file where we save the data
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ReceiveToFile(struct VirtualSdr*, SdrPort, int, char*);
+
+/**
+  *@brief DefaultRecorderOptions Fills the options of a recorder with no rotation, 64 blocks, O_DIRECT and no compression
+  *@param[out] RecorderOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultRecorderOptions(struct RecorderOptions*);
+
+/**
+  *@brief CreateRecorder Creates a recorder which saves the blocks of a streaming port from its own thread. The data files are SigMF (base_0000.sigmf-data with base_0000.sigmf-meta...) and base.sigmf-idx is the time index of the recording.
+  *Compressed data files are a sequence of blocks which only OpenRecording can read, so they are base_0000.sdrapi-data and their metadata has sdrapi:datatype instead of core:datatype
+  *@param[out] SdrRecorder** Pointer to store the new recorder
+  *@param[in] char* Base name of the files
+  *@param[in] RecorderOptions* Options of the recorder, NULL for the default ones
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateRecorder(struct SdrRecorder**, char*, struct RecorderOptions*);
+
+/**
+  *@brief AttachRecorder Adds the recorder as a stage of a streaming port, the sample rate, frequency and gain for the metadata are taken from the Virtual SDR
+  *A recorder records only one port, PORTBUSY if it's already attached
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port which we want to record
+  *@param[in] SdrRecorder* Recorder to use
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AttachRecorder(struct VirtualSdr*, SdrPort, struct SdrRecorder*);
+
+/**
+  *@brief DetachRecorder Removes the recorder from the port it was attached to, PORTBUSY if the port is streaming
+  *@param[in] SdrRecorder* Recorder to detach
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DetachRecorder(struct SdrRecorder*);
+
+/**
+  *@brief GetRecorderStats Gets the results of a recorder, it can be called while it's recording
+  *@param[in] SdrRecorder* Recorder to check
+  *@param[out] RecorderStats* Buffer to store the results
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetRecorderStats(struct SdrRecorder*, struct RecorderStats*);
+
+/**
+  *@brief FreeRecorder Detaches the recorder, writes the blocks waiting, closes the files and frees it, the port must be stopped before and the Virtual SDR freed after
+  *@param[in] SdrRecorder* Recorder to free
+  */
+void FreeRecorder(struct SdrRecorder*);
+
+/**
+  *@brief OpenRecording Opens a recording made by a recorder to read parts of it by time
+  *@param[out] SdrRecording** Pointer to store the recording
+  *@param[in] char* Base name given to the recorder
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError OpenRecording(struct SdrRecording**, char*);
+
+/**
+  *@brief GetRecordingInfo Gets the sample rate, the samples and the UTC times in ns of the first and last sample of a recording
+  *@param[in] SdrRecording* Recording to check
+  *@param[out] long* Buffer to store the sample rate
+  *@param[out] unsigned long long* Buffer to store the number of samples
+  *@param[out] unsigned long long* Buffer to store the time of the first sample
+  *@param[out] unsigned long long* Buffer to store the time of the last sample
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetRecordingInfo(struct SdrRecording*, long*, unsigned long long*, unsigned long long*, unsigned long long*);
+
+/**
+  *@brief ReadRecording Reads the samples of a recording from a UTC time in ns, it seeks with the index without reading the data before
+  *@param[in] SdrRecording* Recording to read
+  *@param[in] unsigned long long Time of the first sample wanted
+  *@param[in] int Number of samples wanted
+  *@param[out] float* Buffer of the I data
+  *@param[out] float* Buffer of the Q data
+  *@param[out] int* Buffer to store the number of samples read, less than wanted at the end of the recording
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ReadRecording(struct SdrRecording*, unsigned long long, int, float*, float*, int*);
+
+/**
+  *@brief ReadRecordingSamples Reads samples of a recording from a position, counted from its first sample without the gaps
+  *@param[in] SdrRecording* Recording to read
+  *@param[in] unsigned long long Position of the first sample
+  *@param[in] int Number of samples to read
+  *@param[out] float* Buffer of the I data
+  *@param[out] float* Buffer of the Q data
+  *@param[out] int* Buffer to store the number of samples read, less than asked at the end of the recording
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ReadRecordingSamples(struct SdrRecording*, unsigned long long, int, float*, float*, int*);
+
+/**
+  *@brief GetRecordingSample Gets the position in the recording of the sample at a UTC time in ns, to find the entries of the preview
+  *@param[in] SdrRecording* Recording to check
+  *@param[in] unsigned long long Time wanted
+  *@param[out] unsigned long long* Buffer to store the position of the sample
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetRecordingSample(struct SdrRecording*, unsigned long long, unsigned long long*);
+
+/**
+  *@brief GetPreviewInfo Gets the number of entries of a level of the preview and the samples of every entry
+  *@param[in] SdrRecording* Recording to check
+  *@param[in] int Level, from 0 to PREVIEWLEVELS-1
+  *@param[out] unsigned long long* Buffer to store the number of entries
+  *@param[out] unsigned long long* Buffer to store the samples of every entry
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetPreviewInfo(struct SdrRecording*, int, unsigned long long*, unsigned long long*);
+
+/**
+  *@brief ReadPreview Reads entries of a level of the preview, entry n covers the samples from n*samplesPerEntry of the recording
+  *@param[in] SdrRecording* Recording to read
+  *@param[in] int Level, from 0 to PREVIEWLEVELS-1
+  *@param[in] unsigned long long First entry wanted
+  *@param[in] int Number of entries wanted
+  *@param[out] SdrPreviewEntry* Buffer to store the entries
+  *@param[out] int* Buffer to store the number of entries read
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError ReadPreview(struct SdrRecording*, int, unsigned long long, int, struct SdrPreviewEntry*, int*);
+
+/**
+  *@brief FreeRecording Closes and frees a recording
+  *@param[in] SdrRecording* Recording to free
+  */
+void FreeRecording(struct SdrRecording*);
+
+/**
+  *@brief DefaultTriggerOptions Fills the options of a triggered capture: on at -30dBFS, off at -33dBFS, windows of 64 samples, 4096 samples before the trigger, 1024 samples of hold off and parts of 1M samples
+  *@param[out] TriggerOptions* Options to fill
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DefaultTriggerOptions(struct TriggerOptions*);
+
+/**
+  *@brief CreateTrigger Creates a triggered capture which only gives the bursts of a streaming port. Every burst is given as a block with the sample and time of its first sample
+  *@param[out] SdrTrigger** Pointer to store the new trigger
+  *@param[in] TriggerOptions* Options of the trigger, NULL for the default ones
+  *@param[in] SdrBlockCallback Function called with every burst, NULL to only save them
+  *@param[in] void* Pointer given to the function
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CreateTrigger(struct SdrTrigger**, struct TriggerOptions*, SdrBlockCallback, void*);
+
+/**
+  *@brief TriggerRecorder Saves the bursts of a trigger with a recorder, which must not be attached to a port. The index of the recording keeps the time of every burst
+  *@param[in] SdrTrigger* Trigger to use
+  *@param[in] SdrRecorder* Recorder to save the bursts, NULL to stop saving them
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError TriggerRecorder(struct SdrTrigger*, struct SdrRecorder*);
+
+/**
+  *@brief AttachTrigger Adds the trigger as a stage of a streaming port. A trigger watches only one port, PORTBUSY if it's already attached
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to watch
+  *@param[in] SdrTrigger* Trigger to use
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError AttachTrigger(struct VirtualSdr*, SdrPort, struct SdrTrigger*);
+
+/**
+  *@brief DetachTrigger Removes the trigger from the port it was attached to, PORTBUSY if the port is streaming
+  *@param[in] SdrTrigger* Trigger to detach
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError DetachTrigger(struct SdrTrigger*);
+
+/**
+  *@brief GetTriggerStats Gets the results of a trigger, it can be called while the port is streaming
+  *@param[in] SdrTrigger* Trigger to check
+  *@param[out] TriggerStats* Buffer to store the results
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetTriggerStats(struct SdrTrigger*, struct TriggerStats*);
+
+/**
+  *@brief FreeTrigger Detaches and frees a trigger, the port must be stopped before and the Virtual SDR and the recorder of the bursts freed after. A burst still open is given before
+  *@param[in] SdrTrigger* Trigger to free
+  */
+void FreeTrigger(struct SdrTrigger*);
+
+
+/**
+  *@brief CheckPortState Function to know if a port is transmitting/receiving or not
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use
+  *@param[in] SdrPort Port to heck the state
+  *@param[in] ChannelType Check RX or TX ports
+  *@param[out] SdrPortState* It can be ON if the port is trnasmitting/receiving or OFF if the port is inactive
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError CheckPortState(struct VirtualSdr*, SdrPort, ChannelType, SdrPortState*);
+
+/**
+  *@brief LoadBSP Loades a board support package which has the relevant information about your device
+  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  *@param[in] char* File that has the information about the Real Sdr data in csv format
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError LoadBSP(struct SdrConfig*, char*);
+
+/**
+  *@brief GetPLLParam Returns to the user the parameters of the pll
+  *@param[in] VirtualSdr* Pointer to the handler of the Virtual SDR to use, it must be connected to the real SDR
+  *@param[out] float* M parameter of the pll
+  *@param[out] float* N parameter of the pll
+  *@param[out] float* P parameter of the pll
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetPLLParam(struct VirtualSdr*, float*, float*, float*);
+
+/**
+  *@brief SetFilter 
+  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  *@param[in] FilterType* Which type of filter is going to be used
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError SetFilter (struct SdrConfig*, FilterType*);
+
+/**
+  *@brief GetFilter 
+  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  *@param[out] FilterType* Which type of filter is using
+  *@return Error code with 0 as succes
+  */
+VirtualSdrError GetFilter (struct SdrConfig*, FilterType*);
+
+/**
+  *@brief GetMetrics Reads the counters of a part of the hot path
+  *@param[in] SdrMetric Part of the hot path
+  *@param[out] SdrMetricStats* Buffer to store the counters
+  *@return Error code with 0 as succes, NOTIMPLEMENTED if the library wasn't compiled with SDRAPI_METRICS
+  */
+VirtualSdrError GetMetrics(SdrMetric, struct SdrMetricStats*);
+
+/**
+  *@brief ResetMetrics Sets every counter to 0
+  *@return Error code with 0 as succes, NOTIMPLEMENTED if the library wasn't compiled with SDRAPI_METRICS
+  */
+VirtualSdrError ResetMetrics(void);
+
+/**
+  *@brief PrintMetrics Function to print the counters of every part of the hot path
+  */
+void PrintMetrics (void);
+
+/**
+  *@brief PrintSdrConfig Function to print configuration
+  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  */
+void PrintSdrConfig (struct SdrConfig*);
+
+/**
+  *@brief FreeSdrConfig Function to free all the memory allocated in the configuration handler
+  *@param[in] SdrConfig* Pointer to the handler of the configuration
+  */
+void FreeSdrConfig (struct SdrConfig*);
+
+/**
+  *@brief FreeCalibration Function to free all the memory allocated in the calibration handler
+  *@param[in] SdrCalibration* Pointer to the handler of the calibration
+  */
+void FreeCalibration (struct SdrCalibration*);
 
 /**
   *@brief PrintSdrConfig Function to print the SDR